@@ -0,0 +1,90 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include <render.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/*
+ * The fixture shared by the benchmarks, each of which is a single file that
+ * prints one JSON object with a "results" array. Everything is static
+ * inline, a benchmark only pulls in what it uses.
+ */
+
+static inline double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// resident right now, the peak is only known for the whole run
+static inline long bench_rss_kb(void) {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(statm);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static inline long bench_peak_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static bool bench_first_result = true;
+
+// separates the results, the caller prints the next object right after it
+static inline void bench_next_result(void) {
+    printf("%s\n  ", bench_first_result ? "" : ",");
+    bench_first_result = false;
+}
+
+// rects and boxes a frame would have filled, glyphs are not counted
+static unsigned long bench_rects_submitted = 0;
+
+static inline void bench_null_frame(int width, int height) { (void) width; (void) height; }
+static inline void bench_null_void(void) { }
+static inline void bench_null_rect(int x1, int y1, int x2, int y2, color32 color) {
+    (void) x1; (void) y1; (void) x2; (void) y2; (void) color;
+    bench_rects_submitted++;
+}
+static inline void bench_null_box(int x, int y, int w, int h, color32 fill, color32 border, int border_width) {
+    (void) x; (void) y; (void) w; (void) h; (void) fill; (void) border; (void) border_width;
+    bench_rects_submitted++;
+}
+static inline void bench_null_clip(int x, int y, int w, int h) { (void) x; (void) y; (void) w; (void) h; }
+static inline void bench_null_clear(color32 color) { (void) color; }
+static inline void bench_null_update_atlas(const uint8_t* alpha, int width, int height,
+                                           int x, int y, int w, int h) {
+    (void) alpha; (void) width; (void) height; (void) x; (void) y; (void) w; (void) h;
+}
+static inline void bench_null_glyph(int x, int y, int w, int h, int u, int v, color32 color) {
+    (void) x; (void) y; (void) w; (void) h; (void) u; (void) v; (void) color;
+}
+
+// takes every call and draws nothing, so what is measured is the work before the backend
+static inline const struct RenderBackend* bench_null_backend(void) {
+    static const struct RenderBackend backend = {
+        .name = "null",
+        .begin_frame = bench_null_frame,
+        .end_frame = bench_null_void,
+        .fill_rect = bench_null_rect,
+        .draw_box = bench_null_box,
+        .set_clip = bench_null_clip,
+        .disable_clip = bench_null_void,
+        .clear = bench_null_clear,
+        .flush = bench_null_void,
+        .release = bench_null_void,
+        .update_atlas = bench_null_update_atlas,
+        .draw_glyph = bench_null_glyph
+    };
+    return &backend;
+}
+
+#endif
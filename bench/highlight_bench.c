@@ -0,0 +1,115 @@
+#include <highlight.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "bench.h"
+
+/*
+ * Highlighting a 100k line C file viewed from the middle: the time until the
+ * visible lines have spans and until the lines above them are settled, then
+ * keystrokes of a few kinds on a fresh copy each, every one waited on until
+ * the worker is done. The number of lines tokenized again per keystroke is
+ * the figure that matters. Comment markers are typed and deleted again, so
+ * each one opens or closes a comment over the same few lines.
+ */
+
+#define LINES 100000
+#define VIEW_FIRST 50000
+#define VIEW_LINES 60
+#define KEYSTROKES 1000
+
+static double update_ns = 0; // spent in highlight_update, on the thread that owns the buffer
+
+static void update(Highlighter highlighter) {
+    double start = bench_now_ns();
+    highlight_update(highlighter);
+    update_ns += bench_now_ns() - start;
+}
+
+static void wait_idle(Highlighter highlighter) {
+    for (update(highlighter); !highlight_idle(highlighter); update(highlighter))
+        sched_yield();
+}
+
+static TextBuffer make_source(void) {
+    static const char* const lines[] = {
+        "static int value_%d = 0x1F + 3.5e2; // a counter\n",
+        "    if (count > %d && flags & 4) return \"done\";\n",
+        "/* a block comment that opens on line %d\n",
+        "   and closes on the next */ struct item items[%d];\n",
+        "#define LIMIT_%d 64\n",
+        "    for (int i = 0; i < %d; i++) total += i * 'a';\n"
+    };
+    char* text = malloc((size_t) LINES * 64);
+    size_t length = 0;
+    for (int i = 0; i < LINES; i++)
+        length += sprintf(text + length, lines[i % 6], i);
+    TextBuffer buffer = text_buffer_create(text, length);
+    free(text);
+    return buffer;
+}
+
+// each keystroke lands at the start of a visible line, then waits for the worker
+static void keystrokes(const char* name, const char* text, bool undo) {
+    TextBuffer buffer = make_source();
+    Highlighter highlighter = highlight_create(buffer, NULL, NULL);
+    highlight_set_visible(highlighter, VIEW_FIRST, VIEW_LINES);
+    struct HighlightStats before, after;
+    wait_idle(highlighter);
+    highlight_stats(highlighter, &before);
+    update_ns = 0;
+    double start = bench_now_ns();
+    for (int i = 0; i < KEYSTROKES; i++) {
+        size_t offset;
+        text_buffer_line_start(buffer, VIEW_FIRST + i % VIEW_LINES, &offset);
+        text_buffer_insert(buffer, offset, text, strlen(text));
+        wait_idle(highlighter);
+        if (undo) {
+            text_buffer_delete(buffer, offset, strlen(text));
+            wait_idle(highlighter);
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+    highlight_stats(highlighter, &after);
+    bench_next_result();
+    printf("{\"op\": \"%s\", \"keystrokes\": %d, \"us_per_keystroke\": %.2f, "
+           "\"update_us_per_keystroke\": %.2f, \"lines_tokenized_per_keystroke\": %.2f, "
+           "\"lines_reused_per_keystroke\": %.2f}",
+           name, KEYSTROKES, elapsed / KEYSTROKES / 1e3,
+           update_ns / KEYSTROKES / 1e3,
+           (double) (after.lines_tokenized - before.lines_tokenized) / KEYSTROKES,
+           (double) (after.lines_reused - before.lines_reused) / KEYSTROKES);
+    highlight_free(highlighter);
+    text_buffer_close(buffer);
+}
+
+int main(void) {
+    TextBuffer buffer = make_source();
+    Highlighter highlighter = highlight_create(buffer, NULL, NULL);
+    highlight_set_visible(highlighter, VIEW_FIRST, VIEW_LINES);
+    printf("{\"benchmark\": \"highlight_bench\", \"lines\": %d, \"results\": [", LINES);
+    double start = bench_now_ns();
+    const HighlightSpan* spans;
+    for (update(highlighter); highlight_line(highlighter, VIEW_FIRST + VIEW_LINES - 1, &spans) < 0;
+         update(highlighter))
+        sched_yield();
+    double visible = bench_now_ns() - start;
+    wait_idle(highlighter);
+    double settled = bench_now_ns() - start;
+    struct HighlightStats stats;
+    highlight_stats(highlighter, &stats);
+    bench_next_result();
+    printf("{\"op\": \"open\", \"visible_ms\": %.3f, \"settled_ms\": %.3f, \"lines_settled\": %zu, "
+           "\"lines_tokenized\": %lu}",
+           visible / 1e6, settled / 1e6, stats.lines_settled, stats.lines_tokenized);
+    highlight_free(highlighter);
+    text_buffer_close(buffer);
+    keystrokes("type_char", "x", false);
+    keystrokes("type_newline", "\n", false);
+    keystrokes("toggle_open_comment", "/*", true);
+    keystrokes("toggle_close_comment", "*/", true);
+    printf("\n]");
+    printf(", \"peak_rss_kb\": %ld}\n", bench_peak_rss_kb());
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <ui.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "bench.h"
+
+/*
+ * Laying out a tree of about a million elements, 16 children per level with
+ * a resizer next to every panel, over a growing number of layout threads:
+ * resizing the window, which lays out every element, and moving one element,
+ * which only lays out its path. The rects of every run are hashed and
+ * checked against the single threaded one.
+ */
+
+#define WINDOW_W 1920
+#define WINDOW_H 1080
+#define FANOUT 16
+#define DEPTH 5
+#define RESIZES 10
+#define EDITS 1000
+
+static UIElement* all;
+static int count = 0;
+
+static void build(UIElement parent, int depth) {
+    UIElement panel = NULL;
+    for (int i = 0; i < FANOUT; i++) {
+        panel = all[count++] = ui_canvas(WINDOW_W, WINDOW_H);
+        ui_set_d(panel, UI_X, (i % 4) / 4.0);
+        ui_set_d(panel, UI_Y, (i / 4) / 4.0 + depth / 100.0);
+        ui_set_d(panel, UI_WIDTH, 0.25 - depth / 50.0);
+        ui_set_d(panel, UI_HEIGHT, 0.25);
+        ui_set_i(panel, UI_MIN_WIDTH, depth * 4);
+        ui_set_i(panel, UI_OFFSET_X, depth);
+        ui_set_parent(panel, parent);
+        if (depth + 1 < DEPTH)
+            build(panel, depth + 1);
+    }
+    if (depth + 1 < DEPTH) {
+        UIElement resizer = all[count++] = ui_resizer(WINDOW_W, WINDOW_H, HORIZONTAL, panel, NULL, 0.5);
+        ui_set_parent(resizer, parent);
+    }
+}
+
+static unsigned long hash_rects(void) {
+    unsigned long hash = 14695981039346656037UL;
+    for (int i = 0; i < count; i++) {
+        UIRect r = ui_get_rect(all[i]);
+        int fields[] = {r.x, r.y, r.w, r.h};
+        for (int f = 0; f < 4; f++)
+            hash = (hash ^ (unsigned) fields[f]) * 1099511628211UL;
+    }
+    return hash;
+}
+
+int main(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int elements = 1;
+    for (int level = 0, width = 1; level < DEPTH; level++, width *= FANOUT)
+        elements += width * (FANOUT + 1);
+    all = malloc(sizeof(UIElement) * elements);
+    UIElement root = all[count++] = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_set_d(root, UI_WIDTH, 1);
+    ui_set_d(root, UI_HEIGHT, 1);
+    build(root, 0);
+    ui_set_layout_threads(1);
+    ui_relayout(root);
+    // the first layout is not a resize, it would count every element once more
+    ui_take_layout_count();
+    unsigned long serial_hash = 0;
+    double serial_ms = 0;
+    UIRect damage[UI_MAX_DAMAGE_RECTS];
+    printf("{\"benchmark\": \"layout_bench\", \"elements\": %d, \"cores\": %ld, \"results\": [",
+           count, cores);
+    int thread_counts[] = {1, 2, 4, 8, 16, 32};
+    for (unsigned t = 0; t < sizeof(thread_counts) / sizeof(*thread_counts); t++) {
+        int threads = thread_counts[t];
+        if (threads > 2 * cores && threads > 16)
+            break;
+        ui_set_layout_threads(threads);
+        double start = bench_now_ns();
+        for (int i = 0; i < RESIZES; i++) {
+            ui_resize(root, WINDOW_W / 2 + i * 37, WINDOW_H / 2 + i * 23);
+            ui_resize(root, WINDOW_W, WINDOW_H);
+        }
+        double resize_ms = (bench_now_ns() - start) / (2 * RESIZES) / 1e6;
+        int laid_out = ui_take_layout_count() / (2 * RESIZES);
+        srand(EDITS);
+        start = bench_now_ns();
+        for (int i = 0; i < EDITS; i++) {
+            ui_set_i(all[1 + rand() % (count - 1)], UI_OFFSET_Y, i % 7);
+            ui_relayout(root);
+        }
+        double edit_us = (bench_now_ns() - start) / EDITS / 1e3;
+        ui_take_layout_count();
+        ui_take_damage(damage);
+        // the edits leave the same offsets behind for every thread count
+        unsigned long hash = hash_rects();
+        if (threads == 1) {
+            serial_hash = hash;
+            serial_ms = resize_ms;
+        }
+        bench_next_result();
+        printf("{\"threads\": %d, \"resize_ms\": %.3f, \"speedup\": %.2f, \"laid_out_per_resize\": %d, "
+               "\"edit_us\": %.3f, \"identical\": %s}",
+               threads, resize_ms, serial_ms / resize_ms, laid_out, edit_us,
+               hash == serial_hash ? "true" : "false");
+    }
+    ui_free(root);
+    ui_release_all();
+    free(all);
+    printf("\n], \"peak_rss_kb\": %ld}\n", bench_peak_rss_kb());
+    return 0;
+}
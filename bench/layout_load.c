@@ -0,0 +1,79 @@
+#include <layout.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+/*
+ * Startup cost of building a UI from a text layout versus its compiled
+ * image, for synthetic layouts of growing size.
+ */
+
+#define RUNS 5
+#define TEXT_PATH "/tmp/nerd-studio-bench.layout"
+#define IMAGE_PATH "/tmp/nerd-studio-bench.nslb"
+
+// panels of eight buttons, each panel with a resizer bound to it
+static int write_layout(const char* path, int panels) {
+    FILE* out = fopen(path, "w");
+    if (!out)
+        return 0;
+    int elements = 0;
+    for (int p = 0; p < panels; p++) {
+        fprintf(out, "<panel_%d:canvas> {\n"
+                     "    x = %d%%;\n    y = 0;\n    width = 1%%;\n    height = 100%%;\n"
+                     "    min_width = 20px;\n    background_color = #202020C0;\n", p, p % 100);
+        fprintf(out, "    <panel_%d_resizer:resizer> {\n"
+                     "        direction = horizontal;\n        item1 = @panel_%d;\n"
+                     "        side_ratio = 1.5;\n        width = 4px;\n        height = 100%%;\n"
+                     "        offset_x = -2px;\n    }\n", p, p);
+        for (int b = 0; b < 8; b++)
+            fprintf(out, "    <panel_%d_button_%d:button> {\n"
+                         "        x = %d%%;\n        y = %d.5%%;\n        width = 32px;\n"
+                         "        height = 24px;\n        border_color = #FF8000FF;\n    }\n",
+                    p, b, p % 100, b * 10);
+        fprintf(out, "}\n");
+        elements += 10;
+    }
+    fclose(out);
+    return elements;
+}
+
+static double time_load(const char* path) {
+    double best = 1e300;
+    for (int run = 0; run < RUNS; run++) {
+        double start = bench_now_ns();
+        UILayout layout = layout_load(path, 1920, 1080);
+        double elapsed = bench_now_ns() - start;
+        if (!layout) {
+            printf("failed to load %s\n", path);
+            exit(1);
+        }
+        layout_free(layout);
+        ui_release_all();
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+int main(void) {
+    int panels[] = {100, 1000, 10000, 100000};
+    printf("{\"benchmark\": \"layout_load\", \"results\": [");
+    for (unsigned i = 0; i < sizeof(panels) / sizeof(*panels); i++) {
+        int elements = write_layout(TEXT_PATH, panels[i]);
+        double start = bench_now_ns();
+        if (!layout_compile(TEXT_PATH, IMAGE_PATH))
+            return 1;
+        double compile = bench_now_ns() - start;
+        double text = time_load(TEXT_PATH);
+        double image = time_load(IMAGE_PATH);
+        bench_next_result();
+        printf("{\"elements\": %d, \"text_load_ms\": %.3f, \"image_load_ms\": %.3f, "
+               "\"compile_ms\": %.3f, \"speedup\": %.2f}",
+               elements, text / 1e6, image / 1e6, compile / 1e6, text / image);
+    }
+    printf("\n]}\n");
+    remove(TEXT_PATH);
+    remove(IMAGE_PATH);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <layout_store.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+/*
+ * Compares the SoA layout kernel against the scalar reference on
+ * synthetic transforms and checks that both produce the same rects.
+ */
+
+#define RUNS 9
+
+static void fill(UILayoutStore store, int count) {
+    srand(count);
+    layout_store_clear(store);
+    layout_store_begin_level(store);
+    for (int i = 0; i < count; i++) {
+        int min = rand() % 400 - 200;
+        struct UITransform t = {
+            .x = (rand() % 2001 - 1000) / 1000.0,
+            .y = (rand() % 2001 - 1000) / 1000.0,
+            .w = (rand() % 2001 - 1000) / 1000.0,
+            .h = (rand() % 2001 - 1000) / 1000.0,
+            .off_x = rand() % 64 - 32,
+            .off_y = rand() % 64 - 32,
+            .min_w = min,
+            .max_w = i % 3 ? min + rand() % 400 : min - rand() % 400,
+            .min_h = 0,
+            .max_h = i % 5 ? rand() % 600 : 2147483647,
+        };
+        layout_store_push(store, NULL, &t);
+    }
+}
+
+typedef void (*Kernel)(UILayoutStore, int, int, int, int);
+
+static double best_of(Kernel kernel, UILayoutStore store) {
+    double best = 1e300;
+    for (int run = 0; run < RUNS; run++) {
+        double start = bench_now_ns();
+        kernel(store, 0, store->count, 1920, 1080);
+        double elapsed = bench_now_ns() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+int main(void) {
+    int sizes[] = {10000, 100000, 1000000};
+    UILayoutStore store = layout_store_create();
+    int failed = 0;
+    printf("{\"benchmark\": \"layout_store\", \"kernel\": \"%s\", \"results\": [",
+           layout_store_kernel_name());
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+        int count = sizes[s];
+        fill(store, count);
+        double scalar = best_of(layout_store_compute_scalar, store);
+        int* expected = malloc(sizeof(int) * count * 4);
+        for (int i = 0; i < count; i++) {
+            expected[i * 4 + 0] = store->out_x[i];
+            expected[i * 4 + 1] = store->out_y[i];
+            expected[i * 4 + 2] = store->out_w[i];
+            expected[i * 4 + 3] = store->out_h[i];
+        }
+        double vector = best_of(layout_store_compute, store);
+        int mismatches = 0;
+        for (int i = 0; i < count; i++) {
+            mismatches += expected[i * 4 + 0] != store->out_x[i] ||
+                          expected[i * 4 + 1] != store->out_y[i] ||
+                          expected[i * 4 + 2] != store->out_w[i] ||
+                          expected[i * 4 + 3] != store->out_h[i];
+        }
+        free(expected);
+        failed |= mismatches != 0;
+        bench_next_result();
+        printf("{\"elements\": %d, \"scalar_ns_per_element\": %.3f, "
+               "\"simd_ns_per_element\": %.3f, \"mismatches\": %d}",
+               count, scalar / count, vector / count, mismatches);
+    }
+    printf("\n]}\n");
+    layout_store_free(store);
+    return failed;
+}
@@ -0,0 +1,112 @@
+#include <text.h>
+#include <render.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+/*
+ * Text submission at 100k glyphs per frame: a fixed set of labels, labels
+ * that change every frame, and a zoom that brings in a new size every frame
+ * so atlas shelves keep getting evicted. Each runs against a null backend,
+ * for the cost of the glyph and shaping caches alone, and the software
+ * rasterizer.
+ */
+
+#define WINDOW_W 1920
+#define WINDOW_H 1080
+#define FRAMES 60
+#define WARMUP_FRAMES 2
+#define GLYPHS_PER_FRAME 100000
+#define LABEL_LENGTH 50
+
+#define LABELS (GLYPHS_PER_FRAME / LABEL_LENGTH)
+
+static char labels[LABELS][LABEL_LENGTH + 1];
+
+static void make_labels(void) {
+    srand(LABELS);
+    for (int i = 0; i < LABELS; i++) {
+        for (int c = 0; c < LABEL_LENGTH; c++)
+            labels[i][c] = c % 8 == 7 ? ' ' : 'a' + rand() % 26;
+        labels[i][LABEL_LENGTH] = '\0';
+    }
+}
+
+typedef void (*Scene)(int frame);
+
+// the same labels at the three sizes a UI uses
+static void scene_static(int frame) {
+    (void) frame;
+    TextFont font = text_default_font();
+    static const int sizes[] = {12, 14, 16};
+    for (int i = 0; i < LABELS; i++)
+        text_draw(font, sizes[i % 3], (i % 4) * 480, (i / 4) % WINDOW_H, labels[i],
+                  color32(0xE0, 0xE0, 0xE0, 0xFF));
+}
+
+// counters and timestamps, new strings every frame over a warm glyph cache
+static void scene_changing(int frame) {
+    TextFont font = text_default_font();
+    char line[LABEL_LENGTH + 1];
+    for (int i = 0; i < LABELS; i++) {
+        snprintf(line, sizeof(line), "row %06d frame %06d value %+12.4f end", i, frame,
+                 (i * 31 + frame) * 0.125);
+        text_draw(font, 14, (i % 4) * 480, (i / 4) % WINDOW_H, line, color32(0xE0, 0xE0, 0xE0, 0xFF));
+    }
+}
+
+// three neighbouring sizes sliding from 8 to 39 pixels, one new size a frame
+// and all of them together far more texels than the atlas holds
+static void scene_zoom(int frame) {
+    TextFont font = text_default_font();
+    for (int i = 0; i < LABELS; i++) {
+        int size = 8 + (frame + i % 3) % 32;
+        text_draw(font, size, (i % 4) * 480, (i / 4) % WINDOW_H, labels[i], color32(0xE0, 0xE0, 0xE0, 0xFF));
+    }
+}
+
+static void run(const char* scene_name, Scene scene, const struct RenderBackend* backend) {
+    render_use_backend(backend);
+    text_release();
+    for (int frame = 0; frame < WARMUP_FRAMES; frame++) {
+        render_begin_frame(WINDOW_W, WINDOW_H);
+        scene(frame);
+        render_end_frame();
+    }
+    text_reset_stats();
+    double start = bench_now_ns();
+    for (int frame = WARMUP_FRAMES; frame < WARMUP_FRAMES + FRAMES; frame++) {
+        render_begin_frame(WINDOW_W, WINDOW_H);
+        scene(frame);
+        render_end_frame();
+    }
+    double elapsed = bench_now_ns() - start;
+    struct TextStats stats;
+    text_stats(&stats);
+    unsigned long lookups = stats.glyph_hits + stats.glyph_misses;
+    unsigned long shapes = stats.shape_hits + stats.shape_misses;
+    bench_next_result();
+    printf("{\"scene\": \"%s\", \"backend\": \"%s\", \"frames\": %d, \"glyphs_per_frame\": %lu, "
+           "\"ms_per_frame\": %.3f, \"ns_per_glyph\": %.2f, \"atlas_hit_rate\": %.5f, "
+           "\"shape_hit_rate\": %.5f, \"rasterized\": %lu, \"shelf_evictions\": %lu, "
+           "\"atlas_resets\": %lu}",
+           scene_name, backend->name, FRAMES, lookups / FRAMES,
+           elapsed / FRAMES / 1e6, elapsed / lookups, (double) stats.glyph_hits / lookups,
+           (double) stats.shape_hits / shapes, stats.glyph_misses, stats.shelf_evictions,
+           stats.atlas_resets);
+}
+
+int main(void) {
+    const char* names[] = {"static", "changing", "zoom"};
+    Scene scenes[] = {scene_static, scene_changing, scene_zoom};
+    const struct RenderBackend* backends[] = {bench_null_backend(), &render_soft_backend};
+    make_labels();
+    printf("{\"benchmark\": \"text_bench\", \"results\": [");
+    for (unsigned b = 0; b < sizeof(backends) / sizeof(*backends); b++)
+        for (unsigned s = 0; s < sizeof(scenes) / sizeof(*scenes); s++)
+            run(names[s], scenes[s], backends[b]);
+    text_release();
+    render_release();
+    printf("\n], \"peak_rss_kb\": %ld}\n", bench_peak_rss_kb());
+    return 0;
+}
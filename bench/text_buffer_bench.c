@@ -0,0 +1,150 @@
+#include <text_buffer.h>
+#include <text.h>
+#include <ui.h>
+#include <render.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+
+/*
+ * A 2 GiB log file opened in a text area: the time to open it and show the
+ * first screen, to scroll, to jump into the middle and to the end, which
+ * counts every line, and the cost of random edits and of typing. The file
+ * is written to /tmp first and removed afterwards.
+ */
+
+#define WINDOW_W 1920
+#define WINDOW_H 1080
+#define FILE_BYTES (2048L << 20)
+#define SCROLL_STEPS 1000
+#define EDITS 100000
+#define TYPED 100000
+
+// log lines of 40 to 160 bytes
+static bool write_log(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    static char chunk[1 << 20];
+    long written = 0;
+    unsigned seed = 1;
+    for (long line = 0; written < FILE_BYTES; ) {
+        size_t used = 0;
+        while (used < sizeof(chunk) - 256) {
+            seed = seed * 1103515245 + 12345;
+            int n = snprintf(chunk + used, 256, "%012ld INFO worker-%02u request handled in %u us ", line++,
+                             seed >> 27, seed >> 20 & 0xFFF);
+            int pad = (seed >> 8) % 100;
+            memset(chunk + used + n, '.', pad);
+            chunk[used + n + pad] = '\n';
+            used += n + pad + 1;
+        }
+        used = MIN(used, (size_t) (FILE_BYTES - written));
+        if (fwrite(chunk, 1, used, file) != used) {
+            fclose(file);
+            return false;
+        }
+        written += used;
+    }
+    return fclose(file) == 0;
+}
+
+static void report(const char* op, long ops, double elapsed) {
+    bench_next_result();
+    printf("{\"op\": \"%s\", \"ops\": %ld, \"ms\": %.3f, \"us_per_op\": %.3f}",
+           op, ops, elapsed / 1e6, elapsed / ops / 1e3);
+}
+
+#define MEASURE(op, ops, code) do {\
+    double _start = bench_now_ns();\
+    code;\
+    report(op, ops, bench_now_ns() - _start);\
+} while (0)
+
+static void draw(UIElement root) {
+    render_begin_frame(WINDOW_W, WINDOW_H);
+    ui_draw(root);
+    render_end_frame();
+}
+
+int main(void) {
+    char path[] = "/tmp/text_buffer_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("[BENCH][ERROR] unable to create %s\n", path);
+        return 1;
+    }
+    close(fd);
+    // a partial file of up to FILE_BYTES is left behind otherwise, ENOSPC being the likely failure
+    if (!write_log(path)) {
+        printf("[BENCH][ERROR] unable to write %s\n", path);
+        unlink(path);
+        return 1;
+    }
+    render_use_backend(bench_null_backend());
+    long rss_before = bench_rss_kb();
+    printf("{\"benchmark\": \"text_buffer_bench\", \"file_bytes\": %ld, \"results\": [", FILE_BYTES);
+    TextBuffer buffer;
+    UIElement view;
+    MEASURE("open", 1, buffer = text_buffer_open(path));
+    if (!buffer) {
+        unlink(path);
+        return 1;
+    }
+    MEASURE("first_screen", 1, {
+        view = ui_text_area(WINDOW_W, WINDOW_H, buffer);
+        ui_set_d(view, UI_WIDTH, 1);
+        ui_set_d(view, UI_HEIGHT, 1);
+        ui_relayout(view);
+        draw(view);
+    });
+    long rss_open = bench_rss_kb() - rss_before;
+    MEASURE("scroll", SCROLL_STEPS,
+        for (int i = 0; i < SCROLL_STEPS; i++) {
+            ui_scroll(view, 0, -1, WINDOW_W / 2, WINDOW_H / 2);
+            draw(view);
+        });
+    bool exact;
+    size_t estimate = text_buffer_line_count(buffer, &exact);
+    MEASURE("jump_middle", 1, {
+        ui_text_area_scroll_to_line(view, estimate / 2);
+        draw(view);
+    });
+    MEASURE("jump_end", 1, {
+        ui_text_area_scroll_to_line(view, SIZE_MAX);
+        draw(view);
+    });
+    size_t lines = text_buffer_line_count(buffer, &exact);
+    srand(EDITS);
+    MEASURE("random_edit", EDITS,
+        for (int i = 0; i < EDITS; i++) {
+            size_t offset = ((size_t) rand() << 16 ^ rand()) % text_buffer_length(buffer);
+            if (i % 2)
+                text_buffer_delete(buffer, offset, rand() % 64);
+            else
+                text_buffer_insert(buffer, offset, "inserted text\n", 14);
+        });
+    size_t at = text_buffer_length(buffer) / 3;
+    MEASURE("typing", TYPED,
+        for (int i = 0; i < TYPED; i++)
+            text_buffer_insert(buffer, at + i, i % 60 == 59 ? "\n" : "x", 1));
+    MEASURE("draw_after_edits", 1, {
+        ui_text_area_refresh(view);
+        draw(view);
+    });
+    size_t pieces, added_bytes;
+    text_buffer_memory(buffer, &pieces, &added_bytes);
+    printf("\n], \"estimated_lines\": %zu, \"lines\": %zu, \"rss_after_first_screen_kb\": %ld, "
+           "\"pieces\": %zu, \"added_bytes\": %zu",
+           estimate, lines, rss_open, pieces, added_bytes);
+    ui_free(view);
+    ui_release_all();
+    text_buffer_close(buffer);
+    text_release();
+    render_release();
+    unlink(path);
+    printf(", \"peak_rss_kb\": %ld}\n", bench_peak_rss_kb());
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <ui.h>
+#include <render.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+/*
+ * Core UI operations on synthetic trees of growing size: style parsing,
+ * resize, draw submission into a null backend, pointer dispatch and
+ * teardown, plus scrolling virtualized lists of growing length. Linked with
+ * --wrap so every heap allocation is counted.
+ */
+
+#define WINDOW_W 1920
+#define WINDOW_H 1080
+#define DEEP_CHAIN 64
+#define MOUSE_EVENTS 100000
+#define SCROLL_STEPS 10000
+#define ROW_HEIGHT 20
+#define SCROLL_STEP_PX 24 // half a wheel notch of the scroll view
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static unsigned long allocations = 0;
+
+void* __wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+static void on_click(void* user_data) {
+    (void) user_data;
+}
+
+static UIElement leaf(int kind, UIElement sibling) {
+    switch (kind) {
+    case 1:
+        return ui_button(WINDOW_W, WINDOW_H, on_click, NULL);
+    case 2:
+        return ui_resizer(WINDOW_W, WINDOW_H, HORIZONTAL, sibling, NULL, 1.5);
+    default:
+        return ui_canvas(WINDOW_W, WINDOW_H);
+    }
+}
+
+// where an element sits in fractions of the window, children are placed inside their parent
+struct Frame {
+    double x, y, w, h;
+};
+
+static struct Frame* frames;
+
+static void place(UIElement* all, int i, struct Frame frame) {
+    frames[i] = frame;
+    ui_set_d(all[i], UI_X, frame.x);
+    ui_set_d(all[i], UI_Y, frame.y);
+    ui_set_d(all[i], UI_WIDTH, frame.w);
+    ui_set_d(all[i], UI_HEIGHT, frame.h);
+}
+
+// one of cols * cols cells of the parent, with a gap to its neighbours
+static struct Frame cell_of(struct Frame parent, int cell, int cols) {
+    double w = parent.w / cols, h = parent.h / cols;
+    return (struct Frame) {parent.x + (cell % cols + 0.05) * w, parent.y + (cell / cols % cols + 0.05) * h,
+                           0.9 * w, 0.9 * h};
+}
+
+static UIElement build_root(UIElement* all) {
+    UIElement root = all[0] = ui_canvas(WINDOW_W, WINDOW_H);
+    frames[0] = (struct Frame) {0, 0, 1, 1};
+    ui_set_d(root, UI_WIDTH, 1);
+    ui_set_d(root, UI_HEIGHT, 1);
+    return root;
+}
+
+// every node directly under the root
+static UIElement build_wide(int nodes, UIElement* all) {
+    UIElement root = build_root(all);
+    for (int i = 1; i < nodes; i++) {
+        all[i] = leaf(i % 10 == 9 ? 1 : 0, NULL);
+        place(all, i, cell_of(frames[0], i, 100));
+        ui_set_parent(all[i], root);
+    }
+    return root;
+}
+
+// chains of nested canvases side by side, each one inset into its parent
+static UIElement build_deep(int nodes, UIElement* all) {
+    UIElement root = build_root(all);
+    int chains = (nodes - 2) / DEEP_CHAIN + 1;
+    int cols = 1;
+    while (cols * cols < chains)
+        cols++;
+    int parent = 0;
+    struct Frame chain = frames[0];
+    for (int i = 1; i < nodes; i++) {
+        int depth = (i - 1) % DEEP_CHAIN;
+        if (depth == 0) {
+            parent = 0;
+            chain = cell_of(frames[0], (i - 1) / DEEP_CHAIN, cols);
+        }
+        // every level takes the same margin off the chain, so the innermost is still a quarter of it
+        double dx = chain.w / (4 * DEEP_CHAIN), dy = chain.h / (4 * DEEP_CHAIN);
+        all[i] = ui_canvas(WINDOW_W, WINDOW_H);
+        place(all, i, (struct Frame) {chain.x + depth * dx, chain.y + depth * dy,
+                                      chain.w - 2 * depth * dx, chain.h - 2 * depth * dy});
+        ui_set_parent(all[i], all[parent]);
+        parent = i;
+    }
+    return root;
+}
+
+// random parents with canvases, buttons and resizers bound to their parent
+static UIElement build_mixed(int nodes, UIElement* all) {
+    UIElement root = build_root(all);
+    bool* resizer = calloc(nodes, sizeof(bool));
+    srand(nodes);
+    for (int i = 1; i < nodes; i++) {
+        int parent = rand() % i;
+        // a resizer is a thin bar at the edge of what it resizes, anything under it would be clipped away
+        while (resizer[parent])
+            parent = rand() % i;
+        int roll = rand() % 10;
+        int kind = roll < 7 ? 0 : roll < 9 ? 1 : 2;
+        resizer[i] = kind == 2;
+        all[i] = leaf(kind, all[parent]);
+        // children stack on each other, a little inside their parent so deep ones still cover pixels
+        if (kind != 2)
+            place(all, i, cell_of(frames[parent], 0, 1));
+        ui_set_parent(all[i], all[parent]);
+    }
+    free(resizer);
+    return root;
+}
+
+typedef UIElement (*Builder)(int nodes, UIElement* all);
+
+static void report(const char* tree, int nodes, const char* op, long ops,
+                   double elapsed, unsigned long allocs) {
+    bench_next_result();
+    printf("{\"tree\": \"%s\", \"nodes\": %d, \"op\": \"%s\", \"ops\": %ld, "
+           "\"ns_per_op\": %.3f, \"allocs\": %lu, \"allocs_per_op\": %.4f}",
+           tree, nodes, op, ops, elapsed / ops, allocs,
+           (double) allocs / ops);
+}
+
+#define MEASURE(tree, nodes, op, ops, code) do {\
+    unsigned long _allocs = allocations;\
+    double _start = bench_now_ns();\
+    code;\
+    double _elapsed = bench_now_ns() - _start;\
+    report(tree, nodes, op, ops, _elapsed, allocations - _allocs);\
+} while (0)
+
+static void run(const char* tree, Builder build, int nodes) {
+    UIElement* all = malloc(sizeof(UIElement) * nodes);
+    frames = malloc(sizeof(struct Frame) * nodes);
+    UIElement root;
+    UIRect damage[UI_MAX_DAMAGE_RECTS];
+    MEASURE(tree, nodes, "build", nodes, root = build(nodes, all));
+    ui_relayout(root);
+    MEASURE(tree, nodes, "parse_style", nodes,
+        for (int i = 0; i < nodes; i++)
+            ui_parse_style(all[i], "background_color = #202020C0; border_color = #FF8000FF; "
+                                   "border_strengh = 2; off_x = 1; off_y = 1"));
+    MEASURE(tree, nodes, "resize", nodes, {
+        ui_resize(root, WINDOW_W / 2, WINDOW_H / 2);
+        ui_resize(root, WINDOW_W, WINDOW_H);
+    });
+    ui_take_damage(damage);
+    bench_rects_submitted = 0;
+    MEASURE(tree, nodes, "draw", nodes, ui_draw(root));
+    // parents clip their children, so this shows how much of the tree was actually drawn
+    bench_next_result();
+    printf("{\"tree\": \"%s\", \"nodes\": %d, \"op\": \"rects_submitted\", \"rects\": %lu}",
+           tree, nodes, bench_rects_submitted);
+    // the first hit test after a resize rebuilds the grid, the events after it only read it
+    MEASURE(tree, nodes, "hit_grid", nodes, ui_hit_test(root, 0, 0));
+    int x = 0, y = 0;
+    MEASURE(tree, nodes, "mouse_moved", MOUSE_EVENTS,
+        for (int i = 0; i < MOUSE_EVENTS; i++) {
+            x = (x + 7919) % WINDOW_W;
+            y = (y + 104729) % WINDOW_H;
+            ui_mouse_moved(root, x, y);
+        });
+    MEASURE(tree, nodes, "free", nodes, ui_free(root));
+    ui_release_all();
+    ui_take_damage(damage);
+    free(frames);
+    free(all);
+}
+
+static void bind_row(void* user_data, UIElement row, long index) {
+    (void) user_data;
+    ui_set_i(row, UI_MIN_HEIGHT, index % 2);
+}
+
+// the cost of a scroll step should not depend on the number of items
+static void run_scroll(long items) {
+    UIRect damage[UI_MAX_DAMAGE_RECTS];
+    UIElement root = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_set_d(root, UI_WIDTH, 1);
+    ui_set_d(root, UI_HEIGHT, 1);
+    UIElement view;
+    MEASURE("scroll_view", (int) items, "build", 1, {
+        view = ui_scroll_view(WINDOW_W, WINDOW_H, ROW_HEIGHT, (UIListSource) {bind_row, NULL, NULL});
+        ui_set_d(view, UI_WIDTH, 1);
+        ui_set_d(view, UI_HEIGHT, 1);
+        ui_set_parent(view, root);
+        ui_scroll_view_set_count(view, items);
+        ui_relayout(root);
+    });
+    // sweeps up and down inside the list, a step past either end would not move any row
+    long sweep = (items * ROW_HEIGHT - WINDOW_H) / SCROLL_STEP_PX;
+    sweep = MIN(MAX(sweep, 1L), (long) SCROLL_STEPS);
+    MEASURE("scroll_view", (int) items, "scroll", SCROLL_STEPS,
+        for (int i = 0; i < SCROLL_STEPS; i++) {
+            ui_scroll(root, 0, i / sweep % 2 ? 0.5 : -0.5, WINDOW_W / 2, WINDOW_H / 2);
+            ui_relayout(root);
+        });
+    ui_take_damage(damage);
+    MEASURE("scroll_view", (int) items, "draw", 1, ui_draw(root));
+    size_t live;
+    ui_memory_stats(&live, NULL, NULL);
+    bench_next_result();
+    printf("{\"tree\": \"scroll_view\", \"nodes\": %ld, \"op\": \"live_bytes\", \"bytes\": %zu}",
+           items, live);
+    ui_free(root);
+    ui_release_all();
+    ui_take_damage(damage);
+}
+
+int main(void) {
+    const char* names[] = {"wide", "deep", "mixed"};
+    Builder builders[] = {build_wide, build_deep, build_mixed};
+    int sizes[] = {100, 1000, 10000, 100000, 1000000};
+    render_use_backend(bench_null_backend());
+    printf("{\"benchmark\": \"ui_bench\", \"results\": [");
+    for (unsigned b = 0; b < sizeof(builders) / sizeof(*builders); b++)
+        for (unsigned s = 0; s < sizeof(sizes) / sizeof(*sizes); s++)
+            run(names[b], builders[b], sizes[s]);
+    for (long items = 100; items <= 10000000; items *= 10)
+        run_scroll(items);
+    printf("\n], \"peak_rss_kb\": %ld}\n", bench_peak_rss_kb());
+    return 0;
+}
@@ -4,35 +4,64 @@
 #include <types.h>
 #include <stdlib.h>
 #include <ui.h>
+#include <render.h>
+#include <layout.h>
+#include <frame.h>
+#include <input.h>
+#include <latency.h>
+#include <text.h>
+#include <text_buffer.h>
+#include <highlight.h>
+#include <profile.h>
 #include <stdio.h>
+#include <string.h>
 
 struct program_state {
     GLFWwindow* window;
+    bool core_profile;
+    bool latency_report;
+    bool latency_overlay;
     struct user_config {
         color32 background_color;
     } user_config;
+    UILayout layout;
     UIElement left_ui;
     UIElement right_ui;
     UIElement resizer_left;
     UIElement resizer_right;
     UIElement* toolbox_buttons;
-    GLFWcursor* standart_cur;
-    GLFWcursor* resize_ew_cur;
-    GLFWcursor* resize_ns_cur;
+    TextBuffer document; // from --open, NULL without one
+    UIElement editor; // fills the space between the panels
+    Highlighter highlighter; // for C sources only
+    bool dragging; // a resizer holds the pointer, counted as an animation while it does
 };
 
 static void display_func(struct program_state* program_state) {
-    glClearColor(program_state->user_config.background_color.r / 255.0,
-                 program_state->user_config.background_color.g / 255.0,
-                 program_state->user_config.background_color.b / 255.0,
-                 program_state->user_config.background_color.a / 255.0);
-    glClear(GL_COLOR_BUFFER_BIT);
+    PROFILE_SCOPE("frame");
     int w, h;
     glfwGetFramebufferSize(program_state->window, &w, &h);
-    ui_draw(program_state->left_ui);
-    ui_draw(program_state->right_ui);
+    render_begin_frame(w, h);
+    UIRect damage[UI_MAX_DAMAGE_RECTS];
+    int damage_count = ui_take_damage(damage);
+    for (int i = 0; i < damage_count; i++) {
+        render_set_clip(damage[i].x, damage[i].y, damage[i].w, damage[i].h);
+        render_clear(program_state->user_config.background_color);
+        if (program_state->editor)
+            ui_draw_region(program_state->editor, damage[i]);
+        ui_draw_region(program_state->left_ui, damage[i]);
+        ui_draw_region(program_state->right_ui, damage[i]);
+        if (program_state->latency_overlay)
+            latency_draw_overlay(w, h);
+    }
+    render_disable_clip();
+    render_end_frame();
 
     glfwSwapBuffers(program_state->window);
+    // the overlay shows the new samples on the next frame
+    if (latency_presented(glfwGetTime()) && program_state->latency_overlay) {
+        UIRect overlay = latency_overlay_rect(w, h);
+        ui_damage(overlay.x, overlay.y, overlay.w, overlay.h);
+    }
 }
 
 static void close_func(GLFWwindow* window) {
@@ -40,49 +69,78 @@ static void close_func(GLFWwindow* window) {
     // glfwSetWindowShouldClose(window, GLFW_FALSE);
 }
 
-static void set_gl_coordinates(int w, int h) {
-    gluOrtho2D(0, w, 0, h);
+static void set_gl_coordinates(struct program_state* program_state, int w, int h) {
+    // the core renderer builds its own projection from the frame size
+    if (!program_state->core_profile) {
+        glLoadIdentity();
+        gluOrtho2D(0, w, 0, h);
+    }
     glViewport(0, 0, w, h);
 }
 
 static void resize_func(GLFWwindow* window, int x, int y) {
+    PROFILE_SCOPE("event:resize");
     struct program_state* program_state = glfwGetWindowUserPointer(window);
-    glLoadIdentity();
-    set_gl_coordinates(x, y);
+    set_gl_coordinates(program_state, x, y);
 
+    if (program_state->editor)
+        ui_resize(program_state->editor, x, y);
     ui_resize(program_state->left_ui, x, y);
     ui_resize(program_state->right_ui, x, y);
+    ui_damage(0, 0, x, y);
 }
 
-static void move_func(GLFWwindow* window, double x, double y) {
+static void refresh_func(GLFWwindow* window) {
     int w, h;
-    glfwGetWindowSize(window, &w, &h);
-    y = h - y;
-    struct program_state* program_state = glfwGetWindowUserPointer(window);
-    glfwSetCursor(window, program_state->standart_cur);
-    ui_mouse_moved(program_state->resizer_left, x, y);
-    ui_mouse_moved(program_state->resizer_right, x, y);
+    glfwGetFramebufferSize(window, &w, &h);
+    ui_damage(0, 0, w, h);
+}
+
+static void window_size_func(GLFWwindow* window, int x, int y) {
+    (void) window;
+    input_window_resized(x, y);
+}
+
+static void move_func(GLFWwindow* window, double x, double y) {
+    (void) window;
+    input_mouse_moved(x, y);
 }
 
 static void mouse_func(GLFWwindow* window, int button, int action, int mods) {
-    (void) mods;
+    (void) window; (void) mods;
+    if (action == GLFW_PRESS || action == GLFW_RELEASE)
+        input_mouse_button(button, action == GLFW_PRESS);
+}
+
+static void scroll_func(GLFWwindow* window, double dx, double dy) {
+    (void) window;
+    input_scroll(dx, dy);
+}
+
+#define PROFILE_TRACE_PATH "nerd-studio.trace.json"
+#define LATENCY_REPORT_PATH "nerd-studio.latency.json"
+
+static void key_func(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    (void) scancode; (void) mods;
     struct program_state* program_state = glfwGetWindowUserPointer(window);
-    double x, y;
-    glfwGetCursorPos(window, &x, &y);
-    int w, h;
-    glfwGetWindowSize(window, &w, &h);
-    y = h - y;
-    if (action == GLFW_PRESS) {
-        ui_mouse_down(program_state->left_ui, button + 1, x, y);
-        ui_mouse_down(program_state->right_ui, button + 1, x, y);
-    }
-    else if (action == GLFW_RELEASE) {
-        ui_mouse_up(program_state->left_ui, button + 1, x, y);
-        ui_mouse_up(program_state->right_ui, button + 1, x, y);
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+        PROFILE_DUMP(PROFILE_TRACE_PATH);
+    if (key == GLFW_KEY_F11 && action == GLFW_PRESS) {
+        program_state->latency_overlay = !program_state->latency_overlay;
+        int w, h;
+        glfwGetFramebufferSize(window, &w, &h);
+        UIRect overlay = latency_overlay_rect(w, h);
+        ui_damage(overlay.x, overlay.y, overlay.w, overlay.h);
     }
 }
 
 static void setup_window(struct program_state* program_state, int w, int h) {
+    if (program_state->core_profile) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    }
     program_state->window = glfwCreateWindow(w, h, "Nerd Studio", NULL, NULL);
     if (!program_state->window) {
         glfwTerminate();
@@ -92,47 +150,90 @@ static void setup_window(struct program_state* program_state, int w, int h) {
     glfwMakeContextCurrent(program_state->window);
     glfwSetWindowCloseCallback(program_state->window, close_func);
     glfwSetFramebufferSizeCallback(program_state->window, resize_func);
+    glfwSetWindowRefreshCallback(program_state->window, refresh_func);
+    glfwSetWindowSizeCallback(program_state->window, window_size_func);
     glfwSetCursorPosCallback(program_state->window, move_func);
     glfwSetMouseButtonCallback(program_state->window, mouse_func);
+    glfwSetScrollCallback(program_state->window, scroll_func);
+    glfwSetKeyCallback(program_state->window, key_func);
 
-    glLoadIdentity();
-    set_gl_coordinates(w, h);
+    set_gl_coordinates(program_state, w, h);
 
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  
     glEnable(GL_BLEND);
 }
 
 void set_cur(void* user_data, enum UIDirection dir) {
-    struct program_state* program_state = user_data;
-    glfwSetCursor(program_state->window, dir == HORIZONTAL ?
-        program_state->resize_ew_cur : program_state->resize_ns_cur);
-}
-
-static void setup_layout(struct program_state* program_state, int w, int h) {
-    program_state->left_ui = ui_canvas(w, h);
-    const char* style_canvas_l = "x=0; y=0; w=0.2; h=1; min_w=200; max_w=600";
-    ui_parse_style(program_state->left_ui, style_canvas_l);
-    program_state->resizer_left = ui_resizer(w, h, HORIZONTAL,
-                                             program_state->left_ui, NULL, 1.5);
-    const char* style_resizer_l = "y=0; w=1; h=1; min_w=4; max_w=4; off_x=-2";
-    ui_parse_style(program_state->resizer_left, style_resizer_l);
+    (void) user_data;
+    input_request_cursor(dir == HORIZONTAL ? INPUT_CURSOR_RESIZE_EW : INPUT_CURSOR_RESIZE_NS);
+}
+
+static UIElement find_element(struct program_state* program_state, const char* name) {
+    UIElement out = layout_find(program_state->layout, name);
+    if (!out) {
+        printf("[APP][ERROR] the layout has no element \"%s\"\n", name);
+        exit(1);
+    }
+    return out;
+}
+
+static void setup_layout(struct program_state* program_state, const char* path, int w, int h) {
+    program_state->layout = layout_load(path, w, h);
+    if (!program_state->layout)
+        exit(1);
+    program_state->left_ui = find_element(program_state, "canvas_left");
+    program_state->right_ui = find_element(program_state, "canvas_right");
+    program_state->resizer_left = find_element(program_state, "resizer_left");
+    program_state->resizer_right = find_element(program_state, "resizer_right");
     ui_resizer_set_curser_func(program_state->resizer_left, set_cur, program_state);
-    ui_set_parent(program_state->resizer_left, program_state->left_ui);
-
-    program_state->right_ui = ui_canvas(w, h);
-    const char* style_canvas_r = "x=1; y=0; w=-0.2; h=1; min_w=-600; max_w=-200";
-    ui_parse_style(program_state->right_ui, style_canvas_r);
-    program_state->resizer_right = ui_resizer(w, h, HORIZONTAL,
-                                              NULL, program_state->right_ui, 1.5);
-    const char* style_resizer_r = "y=0; w=-1; h=1; min_w=-4; max_w=-4; off_x=2";
-    ui_parse_style(program_state->resizer_right, style_resizer_r);
     ui_resizer_set_curser_func(program_state->resizer_right, set_cur, program_state);
-    ui_set_parent(program_state->resizer_right, program_state->right_ui);
-    
+    ui_set_cached(program_state->left_ui, true);
+    ui_set_cached(program_state->right_ui, true);
+
     program_state->toolbox_buttons = malloc(sizeof(UIElement) * 1);
     program_state->toolbox_buttons[0] = NULL;
 }
 
+// called on the highlighter's thread, the loop picks the results up when it wakes
+static void wake_main_loop(void* user_data) {
+    (void) user_data;
+    frame_request_redraw();
+}
+
+static bool is_c_source(const char* path) {
+    const char* extension = strrchr(path, '.');
+    return extension && (strcmp(extension, ".c") == 0 || strcmp(extension, ".h") == 0);
+}
+
+static void setup_editor(struct program_state* program_state, const char* path, int w, int h) {
+    program_state->document = text_buffer_open(path);
+    if (!program_state->document)
+        exit(1);
+    program_state->editor = ui_text_area(w, h, program_state->document);
+    if (is_c_source(path)) {
+        program_state->highlighter = highlight_create(program_state->document, wake_main_loop, NULL);
+        ui_text_area_set_highlighter(program_state->editor, program_state->highlighter);
+    }
+    ui_set_d(program_state->editor, UI_HEIGHT, 1);
+    ui_parse_style(program_state->editor, "background_color = #00000000; border_strengh = 0; "
+                                          "color = #E0E0E0FF");
+}
+
+// follows the panels, which the resizers move
+static void place_editor(struct program_state* program_state) {
+    UIRect left = ui_get_rect(program_state->left_ui);
+    UIRect right = ui_get_rect(program_state->right_ui);
+    int x = left.x + left.w;
+    int width = MAX(right.x - x, 0);
+    if (ui_get_i(program_state->editor, UI_OFFSET_X) != x)
+        ui_set_i(program_state->editor, UI_OFFSET_X, x);
+    if (ui_get_i(program_state->editor, UI_MIN_WIDTH) != width) {
+        ui_set_i(program_state->editor, UI_MIN_WIDTH, width);
+        ui_set_i(program_state->editor, UI_MAX_WIDTH, width);
+    }
+    ui_relayout(program_state->editor);
+}
+
 static void user_data_init(struct program_state* program_state) {
     program_state->user_config.background_color = color32(0x80, 0x80, 0x80, 0xFF);
 }
@@ -141,31 +242,119 @@ static void user_data_destroy(struct program_state* program_state) {
     for (int i = 0; program_state->toolbox_buttons[i]; i++)
         ui_free(program_state->toolbox_buttons[i]);
     free(program_state->toolbox_buttons);
+    layout_free(program_state->layout);
+    if (program_state->editor)
+        ui_free(program_state->editor);
+    highlight_free(program_state->highlighter);
+    text_buffer_close(program_state->document);
 }
 
 int main(int argc, char** argv) {
-    (void) argc; (void) argv;
+    if (argc == 4 && strcmp(argv[1], "--compile-layout") == 0)
+        return layout_compile(argv[2], argv[3]) ? 0 : 1;
     struct program_state program_state;
+    const char* layout_path = "default.layout";
+    const char* document_path = NULL;
+    program_state.core_profile = false;
+    program_state.latency_report = false;
+    program_state.latency_overlay = false;
+    bool vsync = true;
+    double fps_cap = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--renderer=core") == 0)
+            program_state.core_profile = true;
+        else if (strcmp(argv[i], "--renderer=gl") == 0)
+            program_state.core_profile = false;
+        else if (strcmp(argv[i], "--no-vsync") == 0)
+            vsync = false;
+        else if (strncmp(argv[i], "--fps-cap=", 10) == 0)
+            fps_cap = atof(argv[i] + 10);
+        else if (strcmp(argv[i], "--latency") == 0)
+            program_state.latency_report = program_state.latency_overlay = true;
+        else if (strncmp(argv[i], "--open=", 7) == 0)
+            document_path = argv[i] + 7;
+        else
+            layout_path = argv[i];
+    }
     int w = 640, h = 480;
     user_data_init(&program_state);
     if (!glfwInit())
         exit(1);
     setup_window(&program_state, w, h);
-    setup_layout(&program_state, w, h);
-
-    program_state.standart_cur = glfwCreateStandardCursor(GLFW_ARROW_CURSOR);
-    program_state.resize_ew_cur = glfwCreateStandardCursor(GLFW_RESIZE_EW_CURSOR);
-    program_state.resize_ns_cur = glfwCreateStandardCursor(GLFW_RESIZE_NS_CURSOR);
+    render_use_backend(program_state.core_profile ? &render_core_backend : &render_gl_backend);
+    setup_layout(&program_state, layout_path, w, h);
+    program_state.document = NULL;
+    program_state.editor = NULL;
+    program_state.highlighter = NULL;
+    program_state.dragging = false;
+    if (document_path)
+        setup_editor(&program_state, document_path, w, h);
 
+    PROFILE_THREAD_NAME("main");
+    frame_init(vsync, fps_cap);
+    input_init(program_state.window);
+    UIElement input_roots[] = {program_state.left_ui, program_state.right_ui, program_state.editor};
+    int input_root_count = program_state.editor ? 3 : 2;
+    ui_damage(0, 0, w, h);
     while (!glfwWindowShouldClose(program_state.window)) {
-        display_func(&program_state);
-        glfwWaitEventsTimeout(1/30);
+        // the highlighter asked for a redraw, its spans only damage the lines they color
+        if (frame_take_redraw_request() && program_state.highlighter &&
+            highlight_update(program_state.highlighter))
+            ui_text_area_refresh(program_state.editor);
+        // input goes out in one batch so layout runs once for all of it
+        input_dispatch(input_roots, input_root_count);
+        bool dragging = ui_pointer_capture() != NULL;
+        if (dragging != program_state.dragging) {
+            if (dragging)
+                frame_begin_animation();
+            else
+                frame_end_animation();
+            program_state.dragging = dragging;
+        }
+        ui_relayout(program_state.left_ui);
+        ui_relayout(program_state.right_ui);
+        if (program_state.editor)
+            place_editor(&program_state);
+        if (ui_has_damage() && frame_due()) {
+            frame_begin();
+            display_func(&program_state);
+            frame_end();
+        }
+        else if (!ui_has_damage())
+            latency_discard();
+        // after drawing, so lines that just came into view are sent before the loop sleeps
+        if (program_state.highlighter && highlight_update(program_state.highlighter))
+            ui_text_area_refresh(program_state.editor);
+        // a held resizer keeps the loop at display rate, otherwise it sleeps until input
+        frame_wait(ui_has_damage());
     }
+#ifdef DEBUG
+    struct FrameStats stats;
+    frame_stats(&stats);
+    printf("[APP][DEBUG] %lu frames, %lu wakeups, busy %.3fs, idle %.3fs\n",
+           stats.frames, stats.wakeups, stats.busy_seconds, stats.idle_seconds);
+    printf("[APP][DEBUG] frame time avg %.2fms p95 %.2fms max %.2fms, interval avg %.2fms p95 %.2fms\n",
+           stats.frame_ms_avg, stats.frame_ms_p95, stats.frame_ms_max,
+           stats.interval_ms_avg, stats.interval_ms_p95);
+    unsigned long input_received, input_dispatched;
+    input_stats(&input_received, &input_dispatched);
+    printf("[APP][DEBUG] %lu input events received, %lu dispatched\n",
+           input_received, input_dispatched);
+    struct TextStats text;
+    text_stats(&text);
+    printf("[APP][DEBUG] %lu glyph lookups, %lu rasterized, %lu atlas shelves evicted\n",
+           text.glyph_hits + text.glyph_misses, text.glyph_misses, text.shelf_evictions);
+#endif
 
-    glfwDestroyCursor(program_state.standart_cur);
-    glfwDestroyCursor(program_state.resize_ew_cur);
-    glfwDestroyCursor(program_state.resize_ns_cur);
-    glfwTerminate();
+    input_release();
+    if (program_state.latency_report)
+        latency_dump(LATENCY_REPORT_PATH);
+    PROFILE_DUMP(PROFILE_TRACE_PATH);
+    // cached panels own GL targets, so the tree goes before the context
     user_data_destroy(&program_state);
+    ui_release_all();
+    text_release();
+    render_release();
+    glfwTerminate();
     return 0;
 }
\ No newline at end of file
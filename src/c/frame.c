@@ -0,0 +1,149 @@
+#include <frame.h>
+#include <GLFW/glfw3.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_FALLBACK_RATE 60.0
+
+static double frame_interval = 0; // minimum time between frame starts, 0 means uncapped
+static double display_interval = 1.0 / FRAME_FALLBACK_RATE;
+static int animations = 0;
+static double wake_time = -1; // a deadline for the next wait, -1 when unset
+
+// set from any thread, consumed by the main loop
+static atomic_bool redraw_requested = false;
+
+static double last_frame_start = -1;
+static double frame_start = 0;
+static double busy_since = 0;
+
+static struct FrameStats totals;
+static float frame_ms[FRAME_STAT_WINDOW];
+static float interval_ms[FRAME_STAT_WINDOW];
+static int sample_count = 0;
+static int interval_count = 0;
+static int sample_next = 0;
+static int interval_next = 0;
+
+// needs the window's context to be current
+void frame_init(bool vsync, double fps_cap) {
+    glfwSwapInterval(vsync ? 1 : 0);
+    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+    if (mode && mode->refreshRate > 0)
+        display_interval = 1.0 / mode->refreshRate;
+    frame_set_fps_cap(fps_cap);
+    frame_reset_stats();
+}
+
+void frame_set_fps_cap(double fps_cap) {
+    frame_interval = fps_cap > 0 ? 1.0 / fps_cap : 0;
+}
+
+void frame_begin_animation(void) {
+    animations++;
+}
+
+void frame_end_animation(void) {
+    if (animations > 0)
+        animations--;
+}
+
+double frame_slot_interval(void) {
+    return frame_interval > 0 ? frame_interval : display_interval;
+}
+
+void frame_wake_at(double time) {
+    if (wake_time < 0 || time < wake_time)
+        wake_time = time;
+}
+
+void frame_request_redraw(void) {
+    atomic_store(&redraw_requested, true);
+    // safe from any thread, wakes glfwWaitEvents on the main thread
+    glfwPostEmptyEvent();
+}
+
+bool frame_take_redraw_request(void) {
+    return atomic_exchange(&redraw_requested, false);
+}
+
+bool frame_due(void) {
+    return last_frame_start < 0 || glfwGetTime() >= last_frame_start + frame_interval;
+}
+
+void frame_begin(void) {
+    frame_start = glfwGetTime();
+    if (last_frame_start >= 0) {
+        interval_ms[interval_next] = (frame_start - last_frame_start) * 1000;
+        interval_next = (interval_next + 1) % FRAME_STAT_WINDOW;
+        if (interval_count < FRAME_STAT_WINDOW)
+            interval_count++;
+    }
+    last_frame_start = frame_start;
+}
+
+void frame_end(void) {
+    frame_ms[sample_next] = (glfwGetTime() - frame_start) * 1000;
+    sample_next = (sample_next + 1) % FRAME_STAT_WINDOW;
+    if (sample_count < FRAME_STAT_WINDOW)
+        sample_count++;
+    totals.frames++;
+}
+
+void frame_wait(bool busy) {
+    double now = glfwGetTime();
+    totals.busy_seconds += now - busy_since;
+    double deadline = wake_time;
+    wake_time = -1;
+    if (busy || animations > 0) {
+        // wake for the next frame slot, earlier if input arrives
+        double slot = last_frame_start + frame_slot_interval();
+        if (deadline < 0 || slot < deadline)
+            deadline = slot;
+    }
+    if (deadline < 0)
+        glfwWaitEvents();
+    else if (deadline > now)
+        glfwWaitEventsTimeout(deadline - now);
+    else
+        glfwPollEvents();
+    busy_since = glfwGetTime();
+    totals.idle_seconds += busy_since - now;
+    totals.wakeups++;
+}
+
+static int compare_float(const void* a, const void* b) {
+    float x = *(const float*) a, y = *(const float*) b;
+    return (x > y) - (x < y);
+}
+
+static void summarize(const float* samples, int count, double* avg, double* p95, double* max) {
+    *avg = *p95 = *max = 0;
+    if (!count)
+        return;
+    float sorted[FRAME_STAT_WINDOW];
+    memcpy(sorted, samples, sizeof(float) * count);
+    qsort(sorted, count, sizeof(float), compare_float);
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += sorted[i];
+    *avg = sum / count;
+    *p95 = sorted[(count - 1) * 95 / 100];
+    *max = sorted[count - 1];
+}
+
+void frame_stats(struct FrameStats* out) {
+    *out = totals;
+    summarize(frame_ms, sample_count, &out->frame_ms_avg, &out->frame_ms_p95, &out->frame_ms_max);
+    summarize(interval_ms, interval_count, &out->interval_ms_avg, &out->interval_ms_p95,
+              &out->interval_ms_max);
+}
+
+void frame_reset_stats(void) {
+    memset(&totals, 0, sizeof(totals));
+    sample_count = interval_count = 0;
+    sample_next = interval_next = 0;
+    busy_since = glfwGetTime();
+}
@@ -0,0 +1,496 @@
+#include <highlight.h>
+#include <profile.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// what carries over from one line to the next
+enum HighlightState {
+    STATE_NORMAL, STATE_COMMENT
+};
+
+struct HighlightJob {
+    uint32_t epoch;
+    size_t line;
+    uint8_t state; // ignored when chained
+    bool chained; // starts in the state the job before it ended in
+    bool reusable; // the line is unchanged since it was tokenized from old_state
+    uint8_t old_state, old_end_state;
+    uint16_t length;
+    char text[HIGHLIGHT_MAX_LINE];
+};
+
+struct HighlightResult {
+    uint32_t epoch;
+    size_t line;
+    bool tokenized; // false when the spans the line has still hold
+    uint8_t state, end_state;
+    uint16_t span_count;
+    HighlightSpan spans[HIGHLIGHT_MAX_SPANS];
+};
+
+struct HighlightLine {
+    HighlightSpan* spans;
+    uint16_t span_count;
+    uint8_t state, end_state; // the spans were made from state and end in end_state
+    bool tokenized;
+    bool dirty; // the text changed since it was tokenized
+    uint32_t pending; // epoch of the job in flight for it, 0 for none
+};
+
+struct Highlighter {
+    TextBuffer buffer;
+    void (*notify)(void* user_data);
+    void* user_data;
+    pthread_t worker;
+    sem_t jobs_ready; // one post per job, and one to stop
+    atomic_bool stop;
+    // each ring has one producer, the counters only grow
+    struct HighlightJob jobs[HIGHLIGHT_RING];
+    atomic_uint job_head, job_tail;
+    struct HighlightResult results[HIGHLIGHT_RING];
+    atomic_uint result_head, result_tail;
+    atomic_ulong tokenized, reused;
+    // everything below belongs to the thread that owns the buffer
+    int in_flight; // jobs sent whose results were not taken yet, never more than a ring
+    uint32_t epoch; // bumped by every edit, older results are dropped
+    unsigned long dropped;
+    struct HighlightLine* lines;
+    size_t line_count, line_capacity;
+    size_t line_limit; // first line past the end of the buffer, SIZE_MAX until seen
+    size_t settled; // lines before it are final, its start state is settled_state
+    uint8_t settled_state;
+    size_t chain_run; // lines per chain batch, grows while the states keep differing
+    size_t visible_first, visible_count;
+};
+
+static const char* const keywords[] = {
+    "NULL", "_Alignas", "_Atomic", "_Bool", "_Static_assert", "_Thread_local", "auto", "bool",
+    "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum",
+    "extern", "false", "float", "for", "goto", "if", "inline", "int", "long", "register",
+    "restrict", "return", "short", "signed", "sizeof", "static", "struct", "switch", "true",
+    "typedef", "union", "unsigned", "void", "volatile", "while"
+};
+
+struct Word {
+    const char* text;
+    int length;
+};
+
+static int compare_keyword(const void* key, const void* element) {
+    const struct Word* word = key;
+    const char* keyword = *(const char* const*) element;
+    int order = strncmp(word->text, keyword, word->length);
+    if (order)
+        return order;
+    return keyword[word->length] ? -1 : 0;
+}
+
+static bool is_keyword(const char* text, int length) {
+    struct Word word = {text, length};
+    return bsearch(&word, keywords, sizeof(keywords) / sizeof(*keywords), sizeof(*keywords),
+                   compare_keyword) != NULL;
+}
+
+static bool is_word(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static void add_span(HighlightSpan* spans, uint16_t* count, uint8_t kind, int start, int end) {
+    if (end <= start || *count == HIGHLIGHT_MAX_SPANS)
+        return;
+    spans[(*count)++] = (HighlightSpan) {start, end - start, kind};
+}
+
+// the end of a block comment starting at from, or -1
+static int comment_end(const char* text, int length, int from) {
+    for (int i = from; i + 1 < length; i++)
+        if (text[i] == '*' && text[i + 1] == '/')
+            return i + 2;
+    return -1;
+}
+
+// C, one line at a time, returns the state the next line starts in
+static uint8_t tokenize(const char* text, int length, uint8_t state, HighlightSpan* spans, uint16_t* count) {
+    *count = 0;
+    int i = 0;
+    if (state == STATE_COMMENT) {
+        int end = comment_end(text, length, 0);
+        add_span(spans, count, HIGHLIGHT_COMMENT, 0, end < 0 ? length : end);
+        if (end < 0)
+            return STATE_COMMENT;
+        i = end;
+    }
+    int first = i;
+    while (first < length && (text[first] == ' ' || text[first] == '\t'))
+        first++;
+    if (first < length && text[first] == '#') {
+        i = first + 1;
+        while (i < length && (text[i] == ' ' || text[i] == '\t'))
+            i++;
+        while (i < length && is_word(text[i]))
+            i++;
+        add_span(spans, count, HIGHLIGHT_DIRECTIVE, first, i);
+    }
+    while (i < length) {
+        char c = text[i];
+        int start = i;
+        if (c == '/' && i + 1 < length && text[i + 1] == '/') {
+            add_span(spans, count, HIGHLIGHT_COMMENT, i, length);
+            return STATE_NORMAL;
+        }
+        if (c == '/' && i + 1 < length && text[i + 1] == '*') {
+            int end = comment_end(text, length, i + 2);
+            add_span(spans, count, HIGHLIGHT_COMMENT, i, end < 0 ? length : end);
+            if (end < 0)
+                return STATE_COMMENT;
+            i = end;
+        }
+        else if (c == '"' || c == '\'') {
+            for (i++; i < length && text[i] != c; i++)
+                if (text[i] == '\\')
+                    i++;
+            i = MIN(i + 1, length);
+            add_span(spans, count, HIGHLIGHT_STRING, start, i);
+        }
+        else if ((c >= '0' && c <= '9') || (c == '.' && i + 1 < length && text[i + 1] >= '0' && text[i + 1] <= '9')) {
+            while (i < length && (is_word(text[i]) || text[i] == '.'))
+                i++;
+            add_span(spans, count, HIGHLIGHT_NUMBER, start, i);
+        }
+        else if (is_word(c)) {
+            while (i < length && is_word(text[i]))
+                i++;
+            if (is_keyword(text + start, i - start))
+                add_span(spans, count, HIGHLIGHT_KEYWORD, start, i);
+        }
+        else
+            i++;
+    }
+    return STATE_NORMAL;
+}
+
+static void* worker_main(void* data) {
+    struct Highlighter* highlighter = data;
+    PROFILE_THREAD_NAME("highlight");
+    uint8_t chain_state = STATE_NORMAL;
+    for (;;) {
+        sem_wait(&highlighter->jobs_ready);
+        if (atomic_load(&highlighter->stop))
+            break;
+        unsigned tail = atomic_load_explicit(&highlighter->job_tail, memory_order_relaxed);
+        struct HighlightJob* job = &highlighter->jobs[tail % HIGHLIGHT_RING];
+        unsigned head = atomic_load_explicit(&highlighter->result_head, memory_order_relaxed);
+        // the sender keeps a ring's worth of jobs in flight at most, so there is room
+        struct HighlightResult* result = &highlighter->results[head % HIGHLIGHT_RING];
+        uint8_t state = job->chained ? chain_state : job->state;
+        result->epoch = job->epoch;
+        result->line = job->line;
+        result->state = state;
+        result->tokenized = !job->reusable || job->old_state != state;
+        if (result->tokenized) {
+            PROFILE_SCOPE("highlight:line");
+            result->end_state = tokenize(job->text, job->length, state, result->spans, &result->span_count);
+            atomic_fetch_add_explicit(&highlighter->tokenized, 1, memory_order_relaxed);
+        }
+        else {
+            result->end_state = job->old_end_state;
+            atomic_fetch_add_explicit(&highlighter->reused, 1, memory_order_relaxed);
+        }
+        chain_state = result->end_state;
+        atomic_store_explicit(&highlighter->job_tail, tail + 1, memory_order_release);
+        atomic_store_explicit(&highlighter->result_head, head + 1, memory_order_release);
+        // once the queue runs dry, so a batch is handed over in one go
+        if (highlighter->notify && tail + 1 == atomic_load_explicit(&highlighter->job_head, memory_order_acquire))
+            highlighter->notify(highlighter->user_data);
+    }
+    return NULL;
+}
+
+static struct HighlightLine* track_line(struct Highlighter* highlighter, size_t line) {
+    if (line >= highlighter->line_capacity) {
+        size_t capacity = MAX(highlighter->line_capacity * 2, line + 1);
+        struct HighlightLine* grown = realloc(highlighter->lines, sizeof(struct HighlightLine) * capacity);
+        if (!grown) {
+            printf("[HIGHLIGHT][ERROR] out of memory while tracking lines\n");
+            return NULL;
+        }
+        highlighter->lines = grown;
+        highlighter->line_capacity = capacity;
+    }
+    for (; highlighter->line_count <= line; highlighter->line_count++)
+        highlighter->lines[highlighter->line_count] = (struct HighlightLine) {0};
+    return &highlighter->lines[line];
+}
+
+// *known says whether *offset already is the start of line
+static bool read_line(struct Highlighter* highlighter, size_t line, size_t* offset, bool* known,
+                      struct HighlightJob* job) {
+    if (line >= highlighter->line_limit)
+        return false;
+    if (!*known && !text_buffer_line_start(highlighter->buffer, line, offset)) {
+        highlighter->line_limit = line;
+        return false;
+    }
+    // most lines are short, the rest of a long one is only read when needed
+    size_t got = text_buffer_read(highlighter->buffer, *offset, job->text, HIGHLIGHT_SHORT_LINE);
+    char* newline = memchr(job->text, '\n', got);
+    if (!newline && got == HIGHLIGHT_SHORT_LINE) {
+        got += text_buffer_read(highlighter->buffer, *offset + got, job->text + got,
+                                HIGHLIGHT_MAX_LINE - HIGHLIGHT_SHORT_LINE);
+        newline = memchr(job->text, '\n', got);
+    }
+    job->length = newline ? (size_t) (newline - job->text) : got;
+    *offset += job->length + 1;
+    *known = newline != NULL;
+    return true;
+}
+
+/*
+ * Sends lines [first, last) as one chain starting in state. It stops short
+ * at a line already in flight, at the end of the buffer, when the rings are
+ * full or, with only_stale, at the first line whose spans may still hold.
+ */
+static void send_chain(struct Highlighter* highlighter, size_t first, size_t last, uint8_t state,
+                       bool only_stale) {
+    size_t offset = 0;
+    bool known = false;
+    unsigned head = atomic_load_explicit(&highlighter->job_head, memory_order_relaxed);
+    for (size_t line = first; line < last && highlighter->in_flight < HIGHLIGHT_RING; line++) {
+        if (line < highlighter->line_count && highlighter->lines[line].pending == highlighter->epoch)
+            break;
+        struct HighlightJob* job = &highlighter->jobs[head % HIGHLIGHT_RING];
+        struct HighlightLine* tracked;
+        if (only_stale && line < highlighter->line_count && highlighter->lines[line].tokenized &&
+            !highlighter->lines[line].dirty)
+            break;
+        if (!read_line(highlighter, line, &offset, &known, job) || !(tracked = track_line(highlighter, line)))
+            break;
+        job->epoch = highlighter->epoch;
+        job->line = line;
+        job->state = state;
+        job->chained = line != first;
+        job->reusable = tracked->tokenized && !tracked->dirty;
+        job->old_state = tracked->state;
+        job->old_end_state = tracked->end_state;
+        tracked->pending = highlighter->epoch;
+        atomic_store_explicit(&highlighter->job_head, ++head, memory_order_release);
+        sem_post(&highlighter->jobs_ready);
+        highlighter->in_flight++;
+    }
+}
+
+static bool take_results(struct Highlighter* highlighter) {
+    bool changed = false;
+    unsigned tail = atomic_load_explicit(&highlighter->result_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&highlighter->result_head, memory_order_acquire);
+    for (; tail != head; tail++) {
+        struct HighlightResult* result = &highlighter->results[tail % HIGHLIGHT_RING];
+        highlighter->in_flight--;
+        if (result->epoch != highlighter->epoch || result->line >= highlighter->line_count) {
+            highlighter->dropped++;
+            continue;
+        }
+        struct HighlightLine* line = &highlighter->lines[result->line];
+        line->pending = 0;
+        if (!result->tokenized)
+            continue;
+        HighlightSpan* spans = NULL;
+        if (result->span_count && !(spans = malloc(sizeof(HighlightSpan) * result->span_count))) {
+            printf("[HIGHLIGHT][ERROR] out of memory while storing spans\n");
+            continue;
+        }
+        if (spans)
+            memcpy(spans, result->spans, sizeof(HighlightSpan) * result->span_count);
+        free(line->spans);
+        line->spans = spans;
+        line->span_count = result->span_count;
+        line->state = result->state;
+        line->end_state = result->end_state;
+        line->tokenized = true;
+        line->dirty = false;
+        if (result->line >= highlighter->visible_first &&
+            result->line - highlighter->visible_first < highlighter->visible_count)
+            changed = true;
+    }
+    atomic_store_explicit(&highlighter->result_tail, tail, memory_order_release);
+    return changed;
+}
+
+// past every line whose spans were made from the state the line before ends in
+static void settle(struct Highlighter* highlighter) {
+    while (highlighter->settled < highlighter->line_count) {
+        struct HighlightLine* line = &highlighter->lines[highlighter->settled];
+        if (!line->tokenized || line->dirty || line->state != highlighter->settled_state)
+            break;
+        highlighter->settled_state = line->end_state;
+        highlighter->settled++;
+    }
+}
+
+static bool needs_tokens(struct Highlighter* highlighter, size_t line) {
+    if (line >= highlighter->line_count)
+        return true;
+    struct HighlightLine* tracked = &highlighter->lines[line];
+    return tracked->pending != highlighter->epoch && (!tracked->tokenized || tracked->dirty);
+}
+
+// best guess for a line the settled part has not reached yet
+static uint8_t guess_state(struct Highlighter* highlighter, size_t line) {
+    if (line == highlighter->settled)
+        return highlighter->settled_state;
+    struct HighlightLine* before = line - 1 < highlighter->line_count ? &highlighter->lines[line - 1] : NULL;
+    if (before && before->tokenized && !before->dirty)
+        return before->end_state;
+    return line < highlighter->line_count ? highlighter->lines[line].state : STATE_NORMAL;
+}
+
+bool highlight_update(Highlighter highlighter) {
+    bool changed = take_results(highlighter);
+    settle(highlighter);
+    // visible lines without spans go first, from the state they most likely start in
+    size_t end = highlighter->visible_first + highlighter->visible_count;
+    for (size_t line = MAX(highlighter->visible_first, highlighter->settled); line < end; line++)
+        if (needs_tokens(highlighter, line)) {
+            send_chain(highlighter, line, end, guess_state(highlighter, line), true);
+            break;
+        }
+    /*
+     * Then the settled part catches up, which corrects the guesses. Below an
+     * edit the next line usually still holds, which settle() sees without
+     * sending it, so the batches start at one line and only grow while the
+     * states keep differing.
+     */
+    size_t target = MIN(end + HIGHLIGHT_LOOKAHEAD, highlighter->line_limit);
+    size_t settled = highlighter->settled;
+    if (settled < target && (settled >= highlighter->line_count ||
+                             highlighter->lines[settled].pending != highlighter->epoch)) {
+        send_chain(highlighter, settled, MIN(settled + highlighter->chain_run, target),
+                   highlighter->settled_state, false);
+        highlighter->chain_run = MIN(highlighter->chain_run * 2, (size_t) HIGHLIGHT_CHAIN_BATCH);
+    }
+    return changed;
+}
+
+bool highlight_idle(Highlighter highlighter) {
+    return highlighter->in_flight == 0;
+}
+
+void highlight_set_visible(Highlighter highlighter, size_t first_line, size_t count) {
+    highlighter->visible_first = first_line;
+    highlighter->visible_count = count;
+}
+
+int highlight_line(Highlighter highlighter, size_t line, const HighlightSpan** spans) {
+    if (line >= highlighter->line_count || !highlighter->lines[line].tokenized)
+        return -1;
+    *spans = highlighter->lines[line].spans;
+    return highlighter->lines[line].span_count;
+}
+
+color32 highlight_color(enum HighlightKind kind) {
+    static const color32 palette[HIGHLIGHT_KIND_COUNT] = {
+        [HIGHLIGHT_PLAIN] = color32(0xE0, 0xE0, 0xE0, 0xFF),
+        [HIGHLIGHT_KEYWORD] = color32(0x56, 0x9C, 0xD6, 0xFF),
+        [HIGHLIGHT_NUMBER] = color32(0xB5, 0xCE, 0xA8, 0xFF),
+        [HIGHLIGHT_STRING] = color32(0xCE, 0x91, 0x78, 0xFF),
+        [HIGHLIGHT_COMMENT] = color32(0x6A, 0x99, 0x55, 0xFF),
+        [HIGHLIGHT_DIRECTIVE] = color32(0xC5, 0x86, 0xC0, 0xFF)
+    };
+    return palette[kind < HIGHLIGHT_KIND_COUNT ? kind : HIGHLIGHT_PLAIN];
+}
+
+void highlight_stats(Highlighter highlighter, struct HighlightStats* out) {
+    out->lines_tokenized = atomic_load(&highlighter->tokenized);
+    out->lines_reused = atomic_load(&highlighter->reused);
+    out->results_dropped = highlighter->dropped;
+    out->lines_settled = highlighter->settled;
+    out->lines_tracked = highlighter->line_count;
+}
+
+/*
+ * The edited line and the added ones are tokenized again, the lines below
+ * keep their spans and are checked against the state the edit ends in, so
+ * the work stops where the states agree again.
+ */
+static void on_edit(void* user_data, size_t line, size_t removed, size_t added) {
+    struct Highlighter* highlighter = user_data;
+    if (++highlighter->epoch == 0)
+        highlighter->epoch = 1;
+    highlighter->line_limit = SIZE_MAX;
+    highlighter->chain_run = 1;
+    if (line >= highlighter->line_count)
+        return;
+    struct HighlightLine* lines = highlighter->lines;
+    lines[line].dirty = true;
+    size_t after = line + 1;
+    removed = MIN(removed, highlighter->line_count - after);
+    for (size_t i = after; i < after + removed; i++)
+        free(lines[i].spans);
+    memmove(lines + after, lines + after + removed,
+            sizeof(struct HighlightLine) * (highlighter->line_count - after - removed));
+    highlighter->line_count -= removed;
+    size_t moved = highlighter->line_count - after;
+    if (added && track_line(highlighter, highlighter->line_count + added - 1)) {
+        lines = highlighter->lines;
+        memmove(lines + after + added, lines + after, sizeof(struct HighlightLine) * moved);
+        for (size_t i = after; i < after + added; i++)
+            lines[i] = (struct HighlightLine) {.state = lines[line].state, .dirty = true};
+    }
+    if (line < highlighter->settled) {
+        highlighter->settled = line;
+        highlighter->settled_state = lines[line].state;
+    }
+}
+
+Highlighter highlight_create(TextBuffer buffer, void (*notify)(void* user_data), void* user_data) {
+    struct Highlighter* highlighter = calloc(1, sizeof(struct Highlighter));
+    if (!highlighter) {
+        printf("[HIGHLIGHT][ERROR] out of memory while creating a highlighter\n");
+        return NULL;
+    }
+    highlighter->buffer = buffer;
+    highlighter->notify = notify;
+    highlighter->user_data = user_data;
+    highlighter->epoch = 1;
+    highlighter->line_limit = SIZE_MAX;
+    highlighter->settled_state = STATE_NORMAL;
+    highlighter->chain_run = 1;
+    atomic_init(&highlighter->stop, false);
+    atomic_init(&highlighter->job_head, 0);
+    atomic_init(&highlighter->job_tail, 0);
+    atomic_init(&highlighter->result_head, 0);
+    atomic_init(&highlighter->result_tail, 0);
+    atomic_init(&highlighter->tokenized, 0);
+    atomic_init(&highlighter->reused, 0);
+    if (sem_init(&highlighter->jobs_ready, 0, 0) != 0) {
+        printf("[HIGHLIGHT][ERROR] unable to create a semaphore\n");
+        free(highlighter);
+        return NULL;
+    }
+    if (pthread_create(&highlighter->worker, NULL, worker_main, highlighter) != 0) {
+        printf("[HIGHLIGHT][ERROR] unable to start the worker thread\n");
+        sem_destroy(&highlighter->jobs_ready);
+        free(highlighter);
+        return NULL;
+    }
+    text_buffer_set_listener(buffer, (TextBufferListener) {on_edit, highlighter});
+    return highlighter;
+}
+
+void highlight_free(Highlighter highlighter) {
+    if (!highlighter)
+        return;
+    text_buffer_set_listener(highlighter->buffer, (TextBufferListener) {NULL, NULL});
+    atomic_store(&highlighter->stop, true);
+    sem_post(&highlighter->jobs_ready);
+    pthread_join(highlighter->worker, NULL);
+    sem_destroy(&highlighter->jobs_ready);
+    for (size_t i = 0; i < highlighter->line_count; i++)
+        free(highlighter->lines[i].spans);
+    free(highlighter->lines);
+    free(highlighter);
+}
@@ -0,0 +1,189 @@
+#include <input.h>
+#include <frame.h>
+#include <latency.h>
+#include <profile.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+
+static GLFWwindow* input_window = NULL;
+static int window_height = 0;
+static double cursor_x = 0, cursor_y = 0;
+
+// ring buffer, consecutive moves are folded into the newest move event
+static InputEvent queue[INPUT_QUEUE_SIZE];
+static int queue_head = 0;
+static int queue_count = 0;
+static int queued_buttons = 0;
+static double last_dispatch = -1;
+
+static unsigned long received = 0;
+static unsigned long dispatched = 0;
+
+static const int cursor_shapes[INPUT_CURSOR_COUNT] = {
+    [INPUT_CURSOR_ARROW] = GLFW_ARROW_CURSOR,
+    [INPUT_CURSOR_RESIZE_EW] = GLFW_RESIZE_EW_CURSOR,
+    [INPUT_CURSOR_RESIZE_NS] = GLFW_RESIZE_NS_CURSOR
+};
+static GLFWcursor* cursors[INPUT_CURSOR_COUNT];
+static enum InputCursor cursor_requested = INPUT_CURSOR_ARROW;
+static enum InputCursor cursor_shown = INPUT_CURSOR_COUNT;
+
+void input_init(GLFWwindow* window) {
+    input_window = window;
+    glfwGetWindowSize(window, NULL, &window_height);
+    glfwGetCursorPos(window, &cursor_x, &cursor_y);
+    for (int i = 0; i < INPUT_CURSOR_COUNT; i++)
+        cursors[i] = glfwCreateStandardCursor(cursor_shapes[i]);
+    queue_head = queue_count = queued_buttons = 0;
+    cursor_requested = INPUT_CURSOR_ARROW;
+    cursor_shown = INPUT_CURSOR_COUNT;
+}
+
+void input_release(void) {
+    for (int i = 0; i < INPUT_CURSOR_COUNT; i++) {
+        if (cursors[i])
+            glfwDestroyCursor(cursors[i]);
+        cursors[i] = NULL;
+    }
+    input_window = NULL;
+}
+
+void input_window_resized(int width, int height) {
+    (void) width;
+    window_height = height;
+}
+
+static InputEvent* last_event(void) {
+    if (!queue_count)
+        return NULL;
+    return &queue[(queue_head + queue_count - 1) % INPUT_QUEUE_SIZE];
+}
+
+static InputEvent* push_event(enum InputEventType type) {
+    received++;
+    if (queue_count == INPUT_QUEUE_SIZE) {
+        printf("[INPUT][WARNING] event queue full, dropping event\n");
+        return NULL;
+    }
+    InputEvent* event = &queue[(queue_head + queue_count++) % INPUT_QUEUE_SIZE];
+    event->type = type;
+    event->time = glfwGetTime();
+    event->coalesced = 1;
+    event->button = 0;
+    event->dx = event->dy = 0;
+    event->x = cursor_x;
+    event->y = window_height - cursor_y;
+    return event;
+}
+
+void input_mouse_moved(double x, double y) {
+    cursor_x = x;
+    cursor_y = y;
+    InputEvent* event = last_event();
+    if (event && event->type == INPUT_MOUSE_MOVE) {
+        // only the latest position matters, the timestamp stays the oldest
+        received++;
+        event->coalesced++;
+        event->x = cursor_x;
+        event->y = window_height - cursor_y;
+        return;
+    }
+    push_event(INPUT_MOUSE_MOVE);
+}
+
+void input_mouse_button(int button, bool pressed) {
+    InputEvent* event = push_event(pressed ? INPUT_MOUSE_DOWN : INPUT_MOUSE_UP);
+    if (event) {
+        event->button = button + 1;
+        queued_buttons++;
+    }
+}
+
+void input_scroll(double dx, double dy) {
+    InputEvent* event = last_event();
+    if (event && event->type == INPUT_SCROLL) {
+        received++;
+        event->coalesced++;
+    }
+    else if (!(event = push_event(INPUT_SCROLL)))
+        return;
+    event->dx += dx;
+    event->dy += dy;
+}
+
+bool input_pending(void) {
+    return queue_count > 0;
+}
+
+static void dispatch_event(const InputEvent* event, UIElement* roots, int root_count) {
+    for (int i = 0; i < root_count; i++) {
+        switch (event->type) {
+        case INPUT_MOUSE_MOVE:
+            ui_mouse_moved(roots[i], event->x, event->y);
+            break;
+        case INPUT_MOUSE_DOWN:
+            ui_mouse_down(roots[i], event->button, event->x, event->y);
+            break;
+        case INPUT_MOUSE_UP:
+            ui_mouse_up(roots[i], event->button, event->x, event->y);
+            break;
+        case INPUT_SCROLL:
+            ui_scroll(roots[i], event->dx, event->dy, event->x, event->y);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void apply_cursor(void) {
+    if (cursor_requested == cursor_shown || !input_window)
+        return;
+    glfwSetCursor(input_window, cursors[cursor_requested]);
+    cursor_shown = cursor_requested;
+}
+
+/*
+ * Dispatches the queued events in order. Moves and scrolls alone are held
+ * back until a frame slot has passed since the last dispatch, buttons flush
+ * right away.
+ */
+int input_dispatch(UIElement* roots, int root_count) {
+    if (!queue_count)
+        return 0;
+    double now = glfwGetTime();
+    if (!queued_buttons && last_dispatch >= 0 && now < last_dispatch + frame_slot_interval()) {
+        frame_wake_at(last_dispatch + frame_slot_interval());
+        return 0;
+    }
+    PROFILE_SCOPE("input_dispatch");
+    last_dispatch = now;
+    int count = 0;
+    while (queue_count) {
+        InputEvent event = queue[queue_head];
+        queue_head = (queue_head + 1) % INPUT_QUEUE_SIZE;
+        queue_count--;
+        // whatever is hovered after the move picks the cursor again
+        if (event.type == INPUT_MOUSE_MOVE)
+            cursor_requested = INPUT_CURSOR_ARROW;
+        dispatch_event(&event, roots, root_count);
+        latency_dispatched(event.type, event.time);
+        count++;
+    }
+    queued_buttons = 0;
+    dispatched += count;
+    apply_cursor();
+    return count;
+}
+
+void input_request_cursor(enum InputCursor cursor) {
+    if (cursor >= 0 && cursor < INPUT_CURSOR_COUNT)
+        cursor_requested = cursor;
+}
+
+void input_stats(unsigned long* received_out, unsigned long* dispatched_out) {
+    if (received_out)
+        *received_out = received;
+    if (dispatched_out)
+        *dispatched_out = dispatched;
+}
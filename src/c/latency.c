@@ -0,0 +1,182 @@
+#include <latency.h>
+#include <render.h>
+#include <stdio.h>
+#include <string.h>
+
+#define EVENT_TYPES INPUT_EVENT_TYPE_COUNT
+
+struct LatencyHistogram {
+    unsigned long bins[LATENCY_BINS];
+    unsigned long count;
+    double sum_ms, max_ms;
+};
+
+struct LatencyPending {
+    enum InputEventType type;
+    double time;
+};
+
+static const char* const type_names[EVENT_TYPES] = {
+    [INPUT_MOUSE_MOVE] = "mouse_move",
+    [INPUT_MOUSE_DOWN] = "mouse_down",
+    [INPUT_MOUSE_UP] = "mouse_up",
+    [INPUT_SCROLL] = "scroll"
+};
+
+static struct LatencyHistogram histograms[EVENT_TYPES];
+
+// dispatched events waiting for the frame that shows their effect
+static struct LatencyPending pending[LATENCY_PENDING_MAX];
+static int pending_count = 0;
+
+void latency_dispatched(enum InputEventType type, double event_time) {
+    if (pending_count < LATENCY_PENDING_MAX)
+        pending[pending_count++] = (struct LatencyPending) {type, event_time};
+}
+
+// the dispatched input changed nothing on screen, so there is no photon to wait for
+void latency_discard(void) {
+    pending_count = 0;
+}
+
+static void record(struct LatencyHistogram* histogram, double ms) {
+    int bin = ms / LATENCY_BIN_MS;
+    if (bin < 0)
+        bin = 0;
+    if (bin >= LATENCY_BINS)
+        bin = LATENCY_BINS - 1;
+    histogram->bins[bin]++;
+    histogram->count++;
+    histogram->sum_ms += ms;
+    if (ms > histogram->max_ms)
+        histogram->max_ms = ms;
+}
+
+// call right after the buffer swap, returns whether any samples were taken
+bool latency_presented(double present_time) {
+    if (!pending_count)
+        return false;
+    for (int i = 0; i < pending_count; i++)
+        record(&histograms[pending[i].type], (present_time - pending[i].time) * 1000);
+    pending_count = 0;
+    return true;
+}
+
+static double percentile(const struct LatencyHistogram* histogram, double fraction) {
+    unsigned long target = histogram->count * fraction;
+    if (target >= histogram->count)
+        target = histogram->count - 1;
+    unsigned long seen = 0;
+    for (int i = 0; i < LATENCY_BINS; i++) {
+        seen += histogram->bins[i];
+        // the upper edge of the bin, never above the slowest sample
+        if (seen > target) {
+            double edge = (i + 1) * LATENCY_BIN_MS;
+            return edge < histogram->max_ms ? edge : histogram->max_ms;
+        }
+    }
+    return histogram->max_ms;
+}
+
+void latency_summary(enum InputEventType type, struct LatencySummary* out) {
+    memset(out, 0, sizeof(*out));
+    const struct LatencyHistogram* histogram = &histograms[type];
+    if (!histogram->count)
+        return;
+    out->count = histogram->count;
+    out->avg_ms = histogram->sum_ms / histogram->count;
+    out->p50_ms = percentile(histogram, 0.50);
+    out->p95_ms = percentile(histogram, 0.95);
+    out->p99_ms = percentile(histogram, 0.99);
+    out->max_ms = histogram->max_ms;
+}
+
+void latency_reset(void) {
+    memset(histograms, 0, sizeof(histograms));
+    pending_count = 0;
+}
+
+#define OVERLAY_PAD 8
+#define OVERLAY_BAR 4
+#define OVERLAY_BAR_GAP 2
+#define OVERLAY_GROUP_GAP 6
+#define OVERLAY_MS_SCALE 4 // pixels per millisecond
+#define OVERLAY_MAX_MS 50.0
+#define OVERLAY_GROUP (3 * OVERLAY_BAR + 2 * OVERLAY_BAR_GAP)
+#define OVERLAY_W (2 * OVERLAY_PAD + (int) (OVERLAY_MAX_MS * OVERLAY_MS_SCALE))
+#define OVERLAY_H (2 * OVERLAY_PAD + EVENT_TYPES * OVERLAY_GROUP + (EVENT_TYPES - 1) * OVERLAY_GROUP_GAP)
+
+// top left corner of the frame
+UIRect latency_overlay_rect(int frame_w, int frame_h) {
+    (void) frame_w;
+    return (UIRect) {OVERLAY_PAD, frame_h - OVERLAY_PAD - OVERLAY_H, OVERLAY_W, OVERLAY_H};
+}
+
+static void draw_bar(int x, int y, double ms, color32 color) {
+    if (ms > OVERLAY_MAX_MS)
+        ms = OVERLAY_MAX_MS;
+    int length = ms * OVERLAY_MS_SCALE;
+    if (length < 1)
+        length = 1;
+    render_rect(x, y, x + length, y + OVERLAY_BAR, color);
+}
+
+/*
+ * p50, p95 and p99 bars for every event type, top to bottom in the order of
+ * enum InputEventType, with tick marks at every 60 Hz frame.
+ */
+void latency_draw_overlay(int frame_w, int frame_h) {
+    UIRect rect = latency_overlay_rect(frame_w, frame_h);
+    render_rect(rect.x, rect.y, rect.x + rect.w, rect.y + rect.h, color32(0x10, 0x10, 0x10, 0xC0));
+    int x = rect.x + OVERLAY_PAD;
+    for (double ms = 1000 / 60.0; ms < OVERLAY_MAX_MS; ms += 1000 / 60.0) {
+        int tick = x + ms * OVERLAY_MS_SCALE;
+        render_rect(tick, rect.y + OVERLAY_PAD / 2, tick + 1, rect.y + rect.h - OVERLAY_PAD / 2,
+                    color32(0x60, 0x60, 0x60, 0xFF));
+    }
+    int y = rect.y + rect.h - OVERLAY_PAD;
+    for (int type = 0; type < EVENT_TYPES; type++) {
+        struct LatencySummary summary;
+        latency_summary(type, &summary);
+        if (summary.count) {
+            draw_bar(x, y - OVERLAY_BAR, summary.p50_ms, color32(0x40, 0xC0, 0x40, 0xFF));
+            draw_bar(x, y - 2 * OVERLAY_BAR - OVERLAY_BAR_GAP, summary.p95_ms, color32(0xE0, 0xC0, 0x30, 0xFF));
+            draw_bar(x, y - OVERLAY_GROUP, summary.p99_ms, color32(0xE0, 0x40, 0x30, 0xFF));
+        }
+        y -= OVERLAY_GROUP + OVERLAY_GROUP_GAP;
+    }
+}
+
+bool latency_dump(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        printf("[LATENCY][ERROR] unable to open \"%s\" for writing\n", path);
+        return false;
+    }
+    fprintf(file, "{\"bin_ms\": %.3f, \"events\": {", LATENCY_BIN_MS);
+    for (int type = 0; type < EVENT_TYPES; type++) {
+        struct LatencySummary summary;
+        latency_summary(type, &summary);
+        fprintf(file, "%s\n  \"%s\": {\"count\": %lu, \"avg_ms\": %.3f, \"p50_ms\": %.3f, "
+                "\"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f, \"bins\": {",
+                type ? "," : "", type_names[type], summary.count, summary.avg_ms,
+                summary.p50_ms, summary.p95_ms, summary.p99_ms, summary.max_ms);
+        // sparse, keyed by the lower edge of the bin in milliseconds
+        bool first = true;
+        for (int i = 0; i < LATENCY_BINS; i++) {
+            if (!histograms[type].bins[i])
+                continue;
+            fprintf(file, "%s\"%.2f\": %lu", first ? "" : ", ", i * LATENCY_BIN_MS,
+                    histograms[type].bins[i]);
+            first = false;
+        }
+        fprintf(file, "}}");
+    }
+    fprintf(file, "\n}}\n");
+    bool ok = fclose(file) == 0;
+    if (ok)
+        printf("[LATENCY] wrote latency report to \"%s\"\n", path);
+    else
+        printf("[LATENCY][ERROR] failed to write \"%s\"\n", path);
+    return ok;
+}
@@ -0,0 +1,838 @@
+#include <layout.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Loader for the .layout format:
+ *
+ *     <name:type> {
+ *         key = value;
+ *         <child:type> { ... }
+ *     }
+ *
+ * The file is mapped and parsed in a single pass. Tokens are slices of
+ * the mapping, so names stay valid until layout_free unmaps it.
+ *
+ * layout_compile turns the same text into a binary image: a header, one
+ * fixed-size record per element in document order, a prebuilt name hash
+ * table and the name strings. layout_load recognises images by their
+ * magic and builds the tree from the records in one linear pass.
+ */
+
+#define LAYOUT_INITIAL_TABLE 64
+
+#define LAYOUT_IMAGE_MAGIC "NSLB"
+#define LAYOUT_IMAGE_VERSION 1
+#define LAYOUT_IMAGE_BYTE_ORDER 0x01020304u
+
+struct LayoutImageHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t node_count;
+    uint32_t table_capacity;
+    uint32_t names_size;
+};
+
+struct LayoutImageTransform {
+    int32_t min_w, min_h, max_w, max_h, off_x, off_y;
+    double x, y, w, h;
+};
+
+struct LayoutImageStyle {
+    uint32_t color;
+    uint32_t background_color;
+    uint32_t border_color;
+    int32_t border_strengh;
+    uint32_t fields;
+    uint32_t padding;
+};
+
+// a subtree spans the records [index, subtree_end)
+struct LayoutImageNode {
+    uint32_t type;
+    uint32_t direction;
+    int32_t parent;
+    int32_t subtree_end;
+    int32_t item1;
+    int32_t item2;
+    uint32_t name_offset;
+    uint32_t name_length;
+    double side_ratio;
+    struct LayoutImageTransform transform;
+    struct LayoutImageStyle style;
+};
+
+struct LayoutImageSlot {
+    uint32_t hash;
+    int32_t index;
+};
+
+_Static_assert(sizeof(struct LayoutImageHeader) % 8 == 0, "image header breaks record alignment");
+_Static_assert(sizeof(struct LayoutImageNode) == 120, "image node record changed size");
+
+struct LayoutImageBuilder {
+    struct LayoutImageNode* nodes;
+    int node_capacity;
+    char* names;
+    size_t names_size;
+    size_t names_capacity;
+};
+
+struct LayoutToken {
+    const char* start;
+    int length;
+};
+
+struct LayoutEntry {
+    struct LayoutToken name;
+    uint32_t hash;
+    int index;
+    bool used;
+};
+
+struct UILayout {
+    void* map;
+    size_t map_size;
+    struct LayoutEntry* entries;
+    int entry_capacity;
+    int entry_count;
+    UIElement* elements;
+    int element_count;
+    int element_capacity;
+    UIElement* roots;
+    int root_count;
+    int root_capacity;
+    // set when the layout was loaded from a compiled image
+    const struct LayoutImageHeader* image;
+};
+
+enum LayoutUnit {
+    UNIT_NONE, UNIT_PERCENT, UNIT_PX
+};
+
+enum LayoutStyleField {
+    STYLE_COLOR = UI_STYLE_COLOR,
+    STYLE_BACKGROUND = UI_STYLE_BACKGROUND_COLOR,
+    STYLE_BORDER_COLOR = UI_STYLE_BORDER_COLOR,
+    STYLE_BORDER_STRENGH = UI_STYLE_BORDER_STRENGH
+};
+
+// a block collects its properties until its element can be created
+struct LayoutNode {
+    struct LayoutToken name;
+    int line, column;
+    enum UIType type;
+    struct UITransform transform;
+    struct UIStyleSheet style;
+    int style_set;
+    enum UIDirection direction;
+    double side_ratio;
+    int item1;
+    int item2;
+    int parent;
+    int index;
+};
+
+struct LayoutParser {
+    const char* path;
+    const char* cur;
+    const char* end;
+    const char* line_start;
+    int line;
+    int window_w, window_h;
+    UILayout layout;
+    int node_count;
+    struct LayoutImageBuilder* image;
+};
+
+static uint32_t hash_token(struct LayoutToken token) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < token.length; i++)
+        hash = (hash ^ (uint8_t) token.start[i]) * 16777619u;
+    return hash;
+}
+
+static bool token_equal(struct LayoutToken token, const char* str, int length) {
+    return token.length == length && memcmp(token.start, str, length) == 0;
+}
+
+#define TOKEN_IS(token, literal) token_equal(token, literal, sizeof(literal) - 1)
+
+static struct LayoutEntry* find_entry(UILayout layout, struct LayoutToken name, uint32_t hash) {
+    int mask = layout->entry_capacity - 1;
+    for (int i = hash & mask;; i = (i + 1) & mask) {
+        struct LayoutEntry* entry = &layout->entries[i];
+        if (!entry->used ||
+            (entry->hash == hash && token_equal(entry->name, name.start, name.length)))
+            return entry;
+    }
+}
+
+static void grow_table(UILayout layout) {
+    struct LayoutEntry* old = layout->entries;
+    int old_capacity = layout->entry_capacity;
+    layout->entry_capacity = old_capacity ? old_capacity * 2 : LAYOUT_INITIAL_TABLE;
+    layout->entries = calloc(layout->entry_capacity, sizeof(struct LayoutEntry));
+    for (int i = 0; i < old_capacity; i++)
+        if (old[i].used)
+            *find_entry(layout, old[i].name, old[i].hash) = old[i];
+    free(old);
+}
+
+static int lookup(UILayout layout, struct LayoutToken name) {
+    if (!layout->entry_capacity)
+        return -1;
+    struct LayoutEntry* entry = find_entry(layout, name, hash_token(name));
+    return entry->used ? entry->index : -1;
+}
+
+static bool parse_error(struct LayoutParser* p, int line, int column, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    printf("[LAYOUT][ERROR] %s:%d:%d: ", p->path, line, column);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+    return false;
+}
+
+#define COLUMN(p) ((int) ((p)->cur - (p)->line_start) + 1)
+#define ERROR(p, ...) parse_error(p, (p)->line, COLUMN(p), __VA_ARGS__)
+
+static void skip_space(struct LayoutParser* p) {
+    while (p->cur < p->end) {
+        char c = *p->cur;
+        if (c == '\n') {
+            p->line++;
+            p->line_start = ++p->cur;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r') {
+            p->cur++;
+        }
+        else if (c == '/' && p->cur + 1 < p->end && p->cur[1] == '/') {
+            while (p->cur < p->end && *p->cur != '\n')
+                p->cur++;
+        }
+        else {
+            return;
+        }
+    }
+}
+
+static bool peek(struct LayoutParser* p, char c) {
+    skip_space(p);
+    return p->cur < p->end && *p->cur == c;
+}
+
+static bool expect(struct LayoutParser* p, char c) {
+    if (!peek(p, c))
+        return p->cur < p->end ? ERROR(p, "expected '%c' but found '%c'", c, *p->cur)
+                               : ERROR(p, "expected '%c' but reached the end of the file", c);
+    p->cur++;
+    return true;
+}
+
+static bool is_ident_char(char c, bool first) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+           (!first && c >= '0' && c <= '9');
+}
+
+static bool read_ident(struct LayoutParser* p, struct LayoutToken* out) {
+    skip_space(p);
+    if (p->cur >= p->end || !is_ident_char(*p->cur, true))
+        return ERROR(p, "expected a name");
+    out->start = p->cur;
+    while (p->cur < p->end && is_ident_char(*p->cur, false))
+        p->cur++;
+    out->length = p->cur - out->start;
+    return true;
+}
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Reads a decimal number straight from the mapping, which is not null
+ * terminated. Up to 15 significant digits the mantissa and the power of
+ * ten are exact, so the single division rounds like strtod. Percentages
+ * come back as fractions, folded into the same division.
+ */
+static bool read_number(struct LayoutParser* p, double* out, enum LayoutUnit* unit) {
+    skip_space(p);
+    bool negative = false;
+    if (p->cur < p->end && (*p->cur == '-' || *p->cur == '+'))
+        negative = *p->cur++ == '-';
+    uint64_t mantissa = 0;
+    int digits = 0, scale = 0;
+    bool fraction = false;
+    for (; p->cur < p->end; p->cur++) {
+        char c = *p->cur;
+        if (c == '.' && !fraction) {
+            fraction = true;
+        }
+        else if (c >= '0' && c <= '9') {
+            if (digits >= 15)
+                return ERROR(p, "number has too many digits");
+            mantissa = mantissa * 10 + (c - '0');
+            digits++;
+            scale += fraction;
+        }
+        else {
+            break;
+        }
+    }
+    if (!digits)
+        return ERROR(p, "expected a number");
+    *unit = UNIT_NONE;
+    if (p->cur < p->end && *p->cur == '%') {
+        p->cur++;
+        *unit = UNIT_PERCENT;
+        scale += 2;
+    }
+    else if (p->end - p->cur >= 2 && p->cur[0] == 'p' && p->cur[1] == 'x') {
+        p->cur += 2;
+        *unit = UNIT_PX;
+    }
+    *out = mantissa / powers_of_ten[scale];
+    if (negative)
+        *out = -*out;
+    return true;
+}
+
+static bool read_pixels(struct LayoutParser* p, int* out) {
+    double value;
+    enum LayoutUnit unit;
+    if (!read_number(p, &value, &unit))
+        return false;
+    if (unit == UNIT_PERCENT)
+        return ERROR(p, "expected a pixel value");
+    *out = value;
+    return true;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_color(struct LayoutParser* p, color32* out) {
+    skip_space(p);
+    if (p->cur < p->end && *p->cur == '#')
+        p->cur++;
+    color32 color = color32(0, 0, 0, 0xff);
+    int digits = 0;
+    for (; p->cur < p->end && hex_digit(*p->cur) >= 0 && digits < 8; p->cur++, digits++) {
+        int byte = digits >> 1;
+        color.rgba[byte] = (digits & 1 ? color.rgba[byte] << 4 : 0) | hex_digit(*p->cur);
+    }
+    if (digits != 6 && digits != 8)
+        return ERROR(p, "expected a color as RRGGBB or RRGGBBAA");
+    *out = color;
+    return true;
+}
+
+// x and y take fractions of the window (50% or 0.5) or a pixel offset
+static bool read_position(struct LayoutParser* p, double* rel, int* off) {
+    double value;
+    enum LayoutUnit unit;
+    if (!read_number(p, &value, &unit))
+        return false;
+    if (unit == UNIT_PX)
+        *off = value;
+    else
+        *rel = value;
+    return true;
+}
+
+// a pixel size pins the extent: the fraction is dropped and min == max
+static bool read_size(struct LayoutParser* p, double* rel, int* min, int* max) {
+    double value;
+    enum LayoutUnit unit;
+    if (!read_number(p, &value, &unit))
+        return false;
+    if (unit == UNIT_PX) {
+        *rel = 0;
+        *min = *max = value;
+    }
+    else {
+        *rel = value;
+    }
+    return true;
+}
+
+static bool read_reference(struct LayoutParser* p, int* out) {
+    if (!expect(p, '@'))
+        return false;
+    int line = p->line, column = COLUMN(p);
+    struct LayoutToken name;
+    if (!read_ident(p, &name))
+        return false;
+    *out = lookup(p->layout, name);
+    if (*out < 0)
+        return parse_error(p, line, column, "unknown element \"@%.*s\"", name.length, name.start);
+    return true;
+}
+
+static bool read_property(struct LayoutParser* p, struct LayoutNode* node) {
+    int line = p->line, column = COLUMN(p);
+    struct LayoutToken key;
+    if (!read_ident(p, &key) || !expect(p, '='))
+        return false;
+    struct UITransform* t = &node->transform;
+    bool ok;
+    if (TOKEN_IS(key, "x"))
+        ok = read_position(p, &t->x, &t->off_x);
+    else if (TOKEN_IS(key, "y"))
+        ok = read_position(p, &t->y, &t->off_y);
+    else if (TOKEN_IS(key, "width"))
+        ok = read_size(p, &t->w, &t->min_w, &t->max_w);
+    else if (TOKEN_IS(key, "height"))
+        ok = read_size(p, &t->h, &t->min_h, &t->max_h);
+    else if (TOKEN_IS(key, "min_width"))
+        ok = read_pixels(p, &t->min_w);
+    else if (TOKEN_IS(key, "max_width"))
+        ok = read_pixels(p, &t->max_w);
+    else if (TOKEN_IS(key, "min_height"))
+        ok = read_pixels(p, &t->min_h);
+    else if (TOKEN_IS(key, "max_height"))
+        ok = read_pixels(p, &t->max_h);
+    else if (TOKEN_IS(key, "offset_x"))
+        ok = read_pixels(p, &t->off_x);
+    else if (TOKEN_IS(key, "offset_y"))
+        ok = read_pixels(p, &t->off_y);
+    else if (TOKEN_IS(key, "color"))
+        ok = read_color(p, &node->style.color), node->style_set |= STYLE_COLOR;
+    else if (TOKEN_IS(key, "background_color"))
+        ok = read_color(p, &node->style.background_color), node->style_set |= STYLE_BACKGROUND;
+    else if (TOKEN_IS(key, "border_color"))
+        ok = read_color(p, &node->style.border_color), node->style_set |= STYLE_BORDER_COLOR;
+    else if (TOKEN_IS(key, "border_strength") || TOKEN_IS(key, "border_strengh"))
+        ok = read_pixels(p, &node->style.border_strengh), node->style_set |= STYLE_BORDER_STRENGH;
+    else if (node->type != UI_RESIZER)
+        return parse_error(p, line, column, "unknown property \"%.*s\"", key.length, key.start);
+    else if (TOKEN_IS(key, "item1"))
+        ok = read_reference(p, &node->item1);
+    else if (TOKEN_IS(key, "item2"))
+        ok = read_reference(p, &node->item2);
+    else if (TOKEN_IS(key, "side_ratio")) {
+        enum LayoutUnit unit;
+        ok = read_number(p, &node->side_ratio, &unit);
+    }
+    else if (TOKEN_IS(key, "direction")) {
+        struct LayoutToken value;
+        ok = read_ident(p, &value);
+        if (ok && TOKEN_IS(value, "horizontal"))
+            node->direction = HORIZONTAL;
+        else if (ok && TOKEN_IS(value, "vertical"))
+            node->direction = VERTICAL;
+        else if (ok)
+            ok = ERROR(p, "direction must be horizontal or vertical");
+    }
+    else
+        return parse_error(p, line, column, "unknown property \"%.*s\"", key.length, key.start);
+    return ok && expect(p, ';');
+}
+
+static void add_root(UILayout layout, UIElement root) {
+    if (layout->root_count == layout->root_capacity) {
+        layout->root_capacity = layout->root_capacity ? layout->root_capacity * 2 : 4;
+        layout->roots = realloc(layout->roots, sizeof(UIElement) * layout->root_capacity);
+    }
+    layout->roots[layout->root_count++] = root;
+}
+
+static void add_element(UILayout layout, UIElement element) {
+    if (layout->element_count == layout->element_capacity) {
+        layout->element_capacity = layout->element_capacity ? layout->element_capacity * 2 : 16;
+        layout->elements = realloc(layout->elements, sizeof(UIElement) * layout->element_capacity);
+    }
+    layout->elements[layout->element_count++] = element;
+}
+
+static UIElement create_element(enum UIType type, enum UIDirection direction,
+                                UIElement item1, UIElement item2, double side_ratio,
+                                int window_w, int window_h) {
+    switch (type) {
+    case UI_RESIZER:
+        return ui_resizer(window_w, window_h, direction, item1, item2, side_ratio);
+    case UI_BUTTON:
+        return ui_button(window_w, window_h, NULL, NULL);
+    default:
+        return ui_canvas(window_w, window_h);
+    }
+}
+
+static void build_element(struct LayoutParser* p, struct LayoutNode* node) {
+    UILayout layout = p->layout;
+    UIElement element = create_element(node->type, node->direction,
+                                       node->item1 >= 0 ? layout->elements[node->item1] : NULL,
+                                       node->item2 >= 0 ? layout->elements[node->item2] : NULL,
+                                       node->side_ratio, p->window_w, p->window_h);
+    ui_set_transform(element, &node->transform);
+    ui_override_style(element, &node->style, node->style_set);
+    if (node->parent >= 0)
+        ui_set_parent(element, layout->elements[node->parent]);
+    else
+        add_root(layout, element);
+    add_element(layout, element);
+}
+
+static void emit_record(struct LayoutImageBuilder* image, struct LayoutNode* node) {
+    if (node->index >= image->node_capacity) {
+        image->node_capacity = image->node_capacity ? image->node_capacity * 2 : 64;
+        image->nodes = realloc(image->nodes, sizeof(struct LayoutImageNode) * image->node_capacity);
+    }
+    if (image->names_size + node->name.length > image->names_capacity) {
+        image->names_capacity = MAX(image->names_capacity * 2, image->names_size + node->name.length);
+        image->names = realloc(image->names, image->names_capacity);
+    }
+    memcpy(image->names + image->names_size, node->name.start, node->name.length);
+    struct UITransform* t = &node->transform;
+    image->nodes[node->index] = (struct LayoutImageNode) {
+        .type = node->type,
+        .direction = node->direction,
+        .parent = node->parent,
+        .subtree_end = node->index + 1,
+        .item1 = node->item1,
+        .item2 = node->item2,
+        .name_offset = image->names_size,
+        .name_length = node->name.length,
+        .side_ratio = node->side_ratio,
+        .transform = {t->min_w, t->min_h, t->max_w, t->max_h, t->off_x, t->off_y,
+                      t->x, t->y, t->w, t->h},
+        .style = {
+            .color = node->style.color.i,
+            .background_color = node->style.background_color.i,
+            .border_color = node->style.border_color.i,
+            .border_strengh = node->style.border_strengh,
+            .fields = node->style_set,
+        },
+    };
+    image->names_size += node->name.length;
+}
+
+static bool instantiate(struct LayoutParser* p, struct LayoutNode* node) {
+    if (node->index >= 0)
+        return true;
+    UILayout layout = p->layout;
+    if ((layout->entry_count + 1) * 10 > layout->entry_capacity * 7)
+        grow_table(layout);
+    uint32_t hash = hash_token(node->name);
+    struct LayoutEntry* entry = find_entry(layout, node->name, hash);
+    if (entry->used)
+        return parse_error(p, node->line, node->column, "element \"%.*s\" is defined twice",
+                           node->name.length, node->name.start);
+    node->index = p->node_count++;
+    *entry = (struct LayoutEntry) {node->name, hash, node->index, true};
+    layout->entry_count++;
+    if (p->image)
+        emit_record(p->image, node);
+    else
+        build_element(p, node);
+    return true;
+}
+
+static bool read_block(struct LayoutParser* p, int parent) {
+    if (!expect(p, '<'))
+        return false;
+    struct LayoutNode node = {
+        .line = p->line,
+        .column = COLUMN(p),
+        .transform = {.max_w = INT_MAX, .max_h = INT_MAX},
+        .direction = HORIZONTAL,
+        .side_ratio = 1,
+        .item1 = -1,
+        .item2 = -1,
+        .parent = parent,
+        .index = -1,
+    };
+    struct LayoutToken type;
+    if (!read_ident(p, &node.name) || !expect(p, ':'))
+        return false;
+    int line = p->line, column = COLUMN(p);
+    if (!read_ident(p, &type))
+        return false;
+    if (TOKEN_IS(type, "canvas"))
+        node.type = UI_CANVAS;
+    else if (TOKEN_IS(type, "resizer"))
+        node.type = UI_RESIZER;
+    else if (TOKEN_IS(type, "button"))
+        node.type = UI_BUTTON;
+    else
+        return parse_error(p, line, column, "unknown element type \"%.*s\"", type.length, type.start);
+    if (!expect(p, '>') || !expect(p, '{'))
+        return false;
+    while (!peek(p, '}')) {
+        if (p->cur >= p->end)
+            return ERROR(p, "block \"%.*s\" is not closed", node.name.length, node.name.start);
+        if (*p->cur == '<') {
+            // children need their parent to exist, so properties end here
+            if (!instantiate(p, &node) || !read_block(p, node.index))
+                return false;
+        }
+        else if (node.index >= 0) {
+            return ERROR(p, "properties must come before child elements");
+        }
+        else if (!read_property(p, &node)) {
+            return false;
+        }
+    }
+    p->cur++;
+    if (!instantiate(p, &node))
+        return false;
+    if (p->image)
+        p->image->nodes[node.index].subtree_end = p->node_count;
+    return true;
+}
+
+static void* map_file(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("[LAYOUT][ERROR] could not open \"%s\"\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        printf("[LAYOUT][ERROR] could not stat \"%s\"\n", path);
+        close(fd);
+        return NULL;
+    }
+    *size = st.st_size;
+    // an empty file maps to an empty, but valid, buffer
+    void* map = (void*) "";
+    if (*size) {
+        map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            printf("[LAYOUT][ERROR] could not map \"%s\"\n", path);
+            close(fd);
+            return NULL;
+        }
+        madvise(map, *size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    return map;
+}
+
+static bool parse_text(UILayout layout, const char* path, struct LayoutImageBuilder* image,
+                       int window_w, int window_h) {
+    struct LayoutParser parser = {
+        .path = path,
+        .cur = layout->map,
+        .end = (const char*) layout->map + layout->map_size,
+        .line_start = layout->map,
+        .line = 1,
+        .window_w = window_w,
+        .window_h = window_h,
+        .layout = layout,
+        .image = image,
+    };
+    bool ok = true;
+    while (ok && (skip_space(&parser), parser.cur < parser.end))
+        ok = read_block(&parser, -1);
+    return ok;
+}
+
+static bool image_error(const char* path, const char* message) {
+    printf("[LAYOUT][ERROR] %s: %s\n", path, message);
+    return false;
+}
+
+static const struct LayoutImageNode* image_nodes(const struct LayoutImageHeader* header) {
+    return (const struct LayoutImageNode*) (header + 1);
+}
+
+static const struct LayoutImageSlot* image_table(const struct LayoutImageHeader* header) {
+    return (const struct LayoutImageSlot*) (image_nodes(header) + header->node_count);
+}
+
+static const char* image_names(const struct LayoutImageHeader* header) {
+    return (const char*) (image_table(header) + header->table_capacity);
+}
+
+static bool load_image(UILayout layout, const char* path, int window_w, int window_h) {
+    const struct LayoutImageHeader* header = layout->map;
+    if (header->version != LAYOUT_IMAGE_VERSION)
+        return image_error(path, "image was compiled for another layout version, recompile it");
+    if (header->byte_order != LAYOUT_IMAGE_BYTE_ORDER)
+        return image_error(path, "image was compiled on a machine with another byte order");
+    size_t expected = sizeof(struct LayoutImageHeader) +
+                      (size_t) header->node_count * sizeof(struct LayoutImageNode) +
+                      (size_t) header->table_capacity * sizeof(struct LayoutImageSlot) +
+                      header->names_size;
+    if (layout->map_size != expected || header->table_capacity == 0 ||
+        (header->table_capacity & (header->table_capacity - 1)) ||
+        header->table_capacity <= header->node_count)
+        return image_error(path, "image is truncated or corrupt");
+    // layout_find probes until it meets an empty slot, so there has to be one
+    const struct LayoutImageSlot* table = image_table(header);
+    uint32_t empty = 0;
+    for (uint32_t i = 0; i < header->table_capacity; i++) {
+        if (table[i].index < -1 || table[i].index >= (int64_t) header->node_count)
+            return image_error(path, "image contains an invalid name table entry");
+        empty += table[i].index == -1;
+    }
+    if (!empty)
+        return image_error(path, "image name table has no empty slot");
+
+    const struct LayoutImageNode* nodes = image_nodes(header);
+    layout->elements = malloc(sizeof(UIElement) * MAX(header->node_count, 1u));
+    layout->element_capacity = header->node_count;
+    for (int i = 0; i < (int) header->node_count; i++) {
+        const struct LayoutImageNode* node = &nodes[i];
+        // records may only point backwards, which also rules out cycles
+        if (node->type >= UI_TYPE_COUNT || node->parent < -1 || node->parent >= i ||
+            node->item1 < -1 || node->item1 >= i || node->item2 < -1 || node->item2 >= i ||
+            node->name_offset + (size_t) node->name_length > header->names_size)
+            return image_error(path, "image contains an invalid element record");
+        UIElement element = create_element(node->type, node->direction,
+                                           node->item1 >= 0 ? layout->elements[node->item1] : NULL,
+                                           node->item2 >= 0 ? layout->elements[node->item2] : NULL,
+                                           node->side_ratio, window_w, window_h);
+        const struct LayoutImageTransform* t = &node->transform;
+        ui_set_transform(element, &(struct UITransform) {
+            .min_w = t->min_w, .min_h = t->min_h, .max_w = t->max_w, .max_h = t->max_h,
+            .off_x = t->off_x, .off_y = t->off_y, .x = t->x, .y = t->y, .w = t->w, .h = t->h,
+        });
+        ui_override_style(element, &(struct UIStyleSheet) {
+            .color = {.i = node->style.color},
+            .background_color = {.i = node->style.background_color},
+            .border_color = {.i = node->style.border_color},
+            .border_strengh = node->style.border_strengh,
+        }, node->style.fields);
+        if (node->parent >= 0)
+            ui_set_parent(element, layout->elements[node->parent]);
+        else
+            add_root(layout, element);
+        layout->elements[layout->element_count++] = element;
+    }
+    layout->image = header;
+    return true;
+}
+
+UILayout layout_load(const char* path, int window_w, int window_h) {
+    UILayout layout = calloc(1, sizeof(struct UILayout));
+    layout->map = map_file(path, &layout->map_size);
+    if (!layout->map) {
+        free(layout);
+        return NULL;
+    }
+    bool ok;
+    if (layout->map_size >= sizeof(struct LayoutImageHeader) &&
+        memcmp(layout->map, LAYOUT_IMAGE_MAGIC, 4) == 0)
+        ok = load_image(layout, path, window_w, window_h);
+    else
+        ok = parse_text(layout, path, NULL, window_w, window_h);
+    if (!ok) {
+        // every element created so far hangs below one of the roots
+        for (int i = 0; i < layout->root_count; i++)
+            ui_free(layout->roots[i]);
+        layout->root_count = 0;
+        layout_free(layout);
+        return NULL;
+    }
+    return layout;
+}
+
+bool layout_compile(const char* source, const char* target) {
+    struct UILayout layout = {0};
+    layout.map = map_file(source, &layout.map_size);
+    if (!layout.map)
+        return false;
+    struct LayoutImageBuilder image = {0};
+    bool ok = parse_text(&layout, source, &image, 0, 0);
+    int count = layout.entry_count;
+    struct LayoutImageHeader header = {
+        .magic = LAYOUT_IMAGE_MAGIC,
+        .version = LAYOUT_IMAGE_VERSION,
+        .byte_order = LAYOUT_IMAGE_BYTE_ORDER,
+        .node_count = count,
+        .table_capacity = 1,
+        .names_size = image.names_size,
+    };
+    while (header.table_capacity < (uint32_t) count * 2)
+        header.table_capacity *= 2;
+    struct LayoutImageSlot* table = malloc(sizeof(struct LayoutImageSlot) * header.table_capacity);
+    for (uint32_t i = 0; i < header.table_capacity; i++)
+        table[i] = (struct LayoutImageSlot) {0, -1};
+    for (int i = 0; ok && i < count; i++) {
+        uint32_t hash = hash_token((struct LayoutToken) {image.names + image.nodes[i].name_offset,
+                                                         image.nodes[i].name_length});
+        uint32_t slot = hash & (header.table_capacity - 1);
+        while (table[slot].index >= 0)
+            slot = (slot + 1) & (header.table_capacity - 1);
+        table[slot] = (struct LayoutImageSlot) {hash, i};
+    }
+    FILE* out = ok ? fopen(target, "wb") : NULL;
+    if (ok && !out)
+        ok = image_error(target, "could not open the output file");
+    if (out) {
+        ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+             fwrite(image.nodes, sizeof(struct LayoutImageNode), count, out) == (size_t) count &&
+             fwrite(table, sizeof(struct LayoutImageSlot), header.table_capacity, out) == header.table_capacity &&
+             fwrite(image.names, 1, image.names_size, out) == image.names_size;
+        ok = fclose(out) == 0 && ok;
+        if (!ok)
+            image_error(target, "could not write the image");
+    }
+    free(table);
+    free(image.nodes);
+    free(image.names);
+    free(layout.entries);
+    if (layout.map_size)
+        munmap(layout.map, layout.map_size);
+    return ok;
+}
+
+UIElement layout_find(UILayout layout, const char* name) {
+    struct LayoutToken token = {name, strlen(name)};
+    uint32_t hash = hash_token(token);
+    if (layout->image) {
+        const struct LayoutImageSlot* table = image_table(layout->image);
+        const struct LayoutImageNode* nodes = image_nodes(layout->image);
+        const char* names = image_names(layout->image);
+        uint32_t mask = layout->image->table_capacity - 1;
+        for (uint32_t slot = hash & mask; table[slot].index >= 0; slot = (slot + 1) & mask) {
+            const struct LayoutImageNode* node = &nodes[table[slot].index];
+            if (table[slot].hash == hash && token_equal(token, names + node->name_offset, node->name_length))
+                return layout->elements[table[slot].index];
+        }
+        return NULL;
+    }
+    int index = lookup(layout, token);
+    return index >= 0 ? layout->elements[index] : NULL;
+}
+
+int layout_root_count(UILayout layout) {
+    return layout->root_count;
+}
+
+UIElement layout_root(UILayout layout, int index) {
+    return layout->roots[index];
+}
+
+void layout_free(UILayout layout) {
+    if (!layout)
+        return;
+    if (layout->map_size)
+        munmap(layout->map, layout->map_size);
+    free(layout->entries);
+    free(layout->elements);
+    free(layout->roots);
+    free(layout);
+}
@@ -0,0 +1,264 @@
+#include <layout_store.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LAYOUT_STORE_X86
+#endif
+
+#define LAYOUT_STORE_INITIAL_CAPACITY 256
+
+UILayoutStore layout_store_create(void) {
+    UILayoutStore store = calloc(1, sizeof(struct UILayoutStore));
+    return store;
+}
+
+void layout_store_clear(UILayoutStore store) {
+    store->count = 0;
+    store->level_count = 0;
+}
+
+#define GROW(array, capacity) array = realloc(array, sizeof(*array) * (capacity))
+
+void layout_store_reserve(UILayoutStore store, int capacity) {
+    if (capacity <= store->capacity)
+        return;
+    GROW(store->x, capacity);
+    GROW(store->y, capacity);
+    GROW(store->w, capacity);
+    GROW(store->h, capacity);
+    GROW(store->off_x, capacity);
+    GROW(store->off_y, capacity);
+    GROW(store->min_w, capacity);
+    GROW(store->max_w, capacity);
+    GROW(store->min_h, capacity);
+    GROW(store->max_h, capacity);
+    GROW(store->out_x, capacity);
+    GROW(store->out_y, capacity);
+    GROW(store->out_w, capacity);
+    GROW(store->out_h, capacity);
+    GROW(store->elements, capacity);
+    store->capacity = capacity;
+}
+
+int layout_store_push(UILayoutStore store, UIElement element, UITransform transform) {
+    if (store->count == store->capacity)
+        layout_store_reserve(store, store->capacity ? store->capacity * 2 : LAYOUT_STORE_INITIAL_CAPACITY);
+    int i = store->count++;
+    store->x[i] = transform->x;
+    store->y[i] = transform->y;
+    store->w[i] = transform->w;
+    store->h[i] = transform->h;
+    store->off_x[i] = transform->off_x;
+    store->off_y[i] = transform->off_y;
+    store->min_w[i] = transform->min_w;
+    store->max_w[i] = transform->max_w;
+    store->min_h[i] = transform->min_h;
+    store->max_h[i] = transform->max_h;
+    store->elements[i] = element;
+    if (store->level_count)
+        store->level_start[store->level_count] = store->count;
+    return i;
+}
+
+void layout_store_begin_level(UILayoutStore store) {
+    if (store->level_count + 2 > store->level_capacity) {
+        store->level_capacity = store->level_capacity ? store->level_capacity * 2 : 16;
+        GROW(store->level_start, store->level_capacity);
+    }
+    store->level_start[store->level_count] = store->count;
+    store->level_start[++store->level_count] = store->count;
+}
+
+#undef GROW
+
+// must stay bit-identical to dimensions() in ui.c
+void layout_store_compute_scalar(UILayoutStore store, int first, int count,
+                                 int window_w, int window_h) {
+    for (int i = first; i < first + count; i++) {
+        int x = store->x[i] * window_w + store->off_x[i];
+        int y = store->y[i] * window_h + store->off_y[i];
+        int w = CLAMP(store->min_w[i], store->max_w[i], store->w[i] * window_w);
+        int h = CLAMP(store->min_h[i], store->max_h[i], store->h[i] * window_h);
+        if (w < 0) {
+            x += w;
+            w = -w;
+        }
+        if (h < 0) {
+            y += h;
+            h = -h;
+        }
+        store->out_x[i] = x;
+        store->out_y[i] = y;
+        store->out_w[i] = w;
+        store->out_h[i] = h;
+    }
+}
+
+#ifdef LAYOUT_STORE_X86
+
+/*
+ * Both kernels follow the scalar expression order: the position is a
+ * multiply followed by a separate add (no fma, so rounding matches), the
+ * size is clamped in double precision and every result is truncated
+ * toward zero like the implicit double to int conversion.
+ */
+
+__attribute__((target("sse2")))
+static inline __m128d clamp2_sse2(__m128d val, __m128i bound_a, __m128i bound_b) {
+    __m128d a = _mm_cvtepi32_pd(bound_a);
+    __m128d b = _mm_cvtepi32_pd(bound_b);
+    __m128d lo = _mm_min_pd(a, b);
+    __m128d hi = _mm_max_pd(a, b);
+    return _mm_max_pd(_mm_min_pd(val, hi), lo);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i load2_sse2(const int* p) {
+    return _mm_loadl_epi64((const __m128i*) p);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i pos4_sse2(const double* rel, const int* off, __m128d scale) {
+    __m128d lo = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(rel), scale),
+                            _mm_cvtepi32_pd(load2_sse2(off)));
+    __m128d hi = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(rel + 2), scale),
+                            _mm_cvtepi32_pd(load2_sse2(off + 2)));
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i size4_sse2(const double* rel, const int* min, const int* max, __m128d scale) {
+    __m128d lo = clamp2_sse2(_mm_mul_pd(_mm_loadu_pd(rel), scale),
+                             load2_sse2(min), load2_sse2(max));
+    __m128d hi = clamp2_sse2(_mm_mul_pd(_mm_loadu_pd(rel + 2), scale),
+                             load2_sse2(min + 2), load2_sse2(max + 2));
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+// negative sizes flip to the other side of the anchor: pos += size, size = -size
+__attribute__((target("sse2")))
+static inline void flip4_sse2(__m128i* pos, __m128i* size) {
+    __m128i sign = _mm_srai_epi32(*size, 31);
+    *pos = _mm_add_epi32(*pos, _mm_and_si128(*size, sign));
+    *size = _mm_sub_epi32(_mm_xor_si128(*size, sign), sign);
+}
+
+__attribute__((target("sse2")))
+static void compute_sse2(UILayoutStore store, int first, int count,
+                         int window_w, int window_h) {
+    __m128d scale_w = _mm_set1_pd(window_w);
+    __m128d scale_h = _mm_set1_pd(window_h);
+    int i = first;
+    for (; i + 4 <= first + count; i += 4) {
+        __m128i x = pos4_sse2(store->x + i, store->off_x + i, scale_w);
+        __m128i y = pos4_sse2(store->y + i, store->off_y + i, scale_h);
+        __m128i w = size4_sse2(store->w + i, store->min_w + i, store->max_w + i, scale_w);
+        __m128i h = size4_sse2(store->h + i, store->min_h + i, store->max_h + i, scale_h);
+        flip4_sse2(&x, &w);
+        flip4_sse2(&y, &h);
+        _mm_storeu_si128((__m128i*) (store->out_x + i), x);
+        _mm_storeu_si128((__m128i*) (store->out_y + i), y);
+        _mm_storeu_si128((__m128i*) (store->out_w + i), w);
+        _mm_storeu_si128((__m128i*) (store->out_h + i), h);
+    }
+    layout_store_compute_scalar(store, i, first + count - i, window_w, window_h);
+}
+
+__attribute__((target("avx2")))
+static inline __m128i pos4_avx2(const double* rel, const int* off, __m256d scale) {
+    __m256d offset = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*) off));
+    return _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(rel), scale), offset));
+}
+
+__attribute__((target("avx2")))
+static inline __m128i size4_avx2(const double* rel, const int* min, const int* max, __m256d scale) {
+    __m256d a = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*) min));
+    __m256d b = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*) max));
+    __m256d lo = _mm256_min_pd(a, b);
+    __m256d hi = _mm256_max_pd(a, b);
+    __m256d val = _mm256_mul_pd(_mm256_loadu_pd(rel), scale);
+    return _mm256_cvttpd_epi32(_mm256_max_pd(_mm256_min_pd(val, hi), lo));
+}
+
+__attribute__((target("avx2")))
+static void compute_avx2(UILayoutStore store, int first, int count,
+                         int window_w, int window_h) {
+    __m256d scale_w = _mm256_set1_pd(window_w);
+    __m256d scale_h = _mm256_set1_pd(window_h);
+    int i = first;
+    for (; i + 4 <= first + count; i += 4) {
+        __m128i x = pos4_avx2(store->x + i, store->off_x + i, scale_w);
+        __m128i y = pos4_avx2(store->y + i, store->off_y + i, scale_h);
+        __m128i w = size4_avx2(store->w + i, store->min_w + i, store->max_w + i, scale_w);
+        __m128i h = size4_avx2(store->h + i, store->min_h + i, store->max_h + i, scale_h);
+        __m128i sign_w = _mm_srai_epi32(w, 31);
+        __m128i sign_h = _mm_srai_epi32(h, 31);
+        x = _mm_add_epi32(x, _mm_and_si128(w, sign_w));
+        y = _mm_add_epi32(y, _mm_and_si128(h, sign_h));
+        _mm_storeu_si128((__m128i*) (store->out_x + i), x);
+        _mm_storeu_si128((__m128i*) (store->out_y + i), y);
+        _mm_storeu_si128((__m128i*) (store->out_w + i), _mm_abs_epi32(w));
+        _mm_storeu_si128((__m128i*) (store->out_h + i), _mm_abs_epi32(h));
+    }
+    layout_store_compute_scalar(store, i, first + count - i, window_w, window_h);
+}
+
+#endif
+
+typedef void (*LayoutKernel)(UILayoutStore store, int first, int count,
+                             int window_w, int window_h);
+
+static LayoutKernel kernel = NULL;
+static const char* kernel_name = "scalar";
+
+static void select_kernel(void) {
+    kernel = layout_store_compute_scalar;
+#ifdef LAYOUT_STORE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = compute_avx2;
+        kernel_name = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        kernel = compute_sse2;
+        kernel_name = "sse2";
+    }
+#endif
+}
+
+void layout_store_compute(UILayoutStore store, int first, int count,
+                          int window_w, int window_h) {
+    if (!kernel)
+        select_kernel();
+    kernel(store, first, count, window_w, window_h);
+}
+
+const char* layout_store_kernel_name(void) {
+    if (!kernel)
+        select_kernel();
+    return kernel_name;
+}
+
+void layout_store_free(UILayoutStore store) {
+    if (!store)
+        return;
+    free(store->x);
+    free(store->y);
+    free(store->w);
+    free(store->h);
+    free(store->off_x);
+    free(store->off_y);
+    free(store->min_w);
+    free(store->max_w);
+    free(store->min_h);
+    free(store->max_h);
+    free(store->out_x);
+    free(store->out_y);
+    free(store->out_w);
+    free(store->out_h);
+    free(store->elements);
+    free(store->level_start);
+    free(store);
+}
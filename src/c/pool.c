@@ -0,0 +1,82 @@
+#include <pool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define POOL_FIRST_CHUNK_BLOCKS 64
+#define POOL_MAX_CHUNK_BLOCKS 65536
+
+struct PoolChunk {
+    struct PoolChunk* next;
+    size_t blocks;
+    size_t used;
+    max_align_t data[];
+};
+
+void pool_init(Pool pool, size_t block_size) {
+    size_t align = _Alignof(max_align_t);
+    // a free block has to be able to hold the free list link
+    if (block_size < sizeof(void*))
+        block_size = sizeof(void*);
+    pool->block_size = (block_size + align - 1) / align * align;
+    pool->chunk_blocks = POOL_FIRST_CHUNK_BLOCKS;
+    pool->free_list = NULL;
+    pool->chunks = NULL;
+    pool->live_blocks = 0;
+    pool->reserved_bytes = 0;
+}
+
+static struct PoolChunk* add_chunk(Pool pool) {
+    struct PoolChunk* chunk = malloc(sizeof(struct PoolChunk) + pool->block_size * pool->chunk_blocks);
+    if (!chunk) {
+        printf("[POOL][ERROR] out of memory while adding a chunk of %zu blocks\n", pool->chunk_blocks);
+        return NULL;
+    }
+    chunk->next = pool->chunks;
+    chunk->blocks = pool->chunk_blocks;
+    chunk->used = 0;
+    pool->chunks = chunk;
+    pool->reserved_bytes += pool->block_size * pool->chunk_blocks;
+    if (pool->chunk_blocks < POOL_MAX_CHUNK_BLOCKS)
+        pool->chunk_blocks *= 2;
+    return chunk;
+}
+
+void* pool_alloc(Pool pool) {
+    void* block = pool->free_list;
+    if (block) {
+        pool->free_list = *(void**) block;
+    }
+    else {
+        struct PoolChunk* chunk = pool->chunks;
+        if (!chunk || chunk->used == chunk->blocks)
+            chunk = add_chunk(pool);
+        if (!chunk)
+            return NULL;
+        block = (uint8_t*) chunk->data + pool->block_size * chunk->used++;
+    }
+    pool->live_blocks++;
+    return block;
+}
+
+void pool_free(Pool pool, void* block) {
+    if (!block)
+        return;
+    *(void**) block = pool->free_list;
+    pool->free_list = block;
+    pool->live_blocks--;
+}
+
+void pool_release(Pool pool) {
+    struct PoolChunk* chunk = pool->chunks;
+    while (chunk) {
+        struct PoolChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    pool_init(pool, pool->block_size);
+}
+
+size_t pool_live_bytes(Pool pool) {
+    return pool->live_blocks * pool->block_size;
+}
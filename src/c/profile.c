@@ -0,0 +1,147 @@
+#include <profile.h>
+
+#ifdef PROFILE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define PROFILE_RING_SIZE (1 << 16)
+
+struct ProfileEvent {
+    const char* name;
+    long long start_ns;
+    long long duration_ns;
+};
+
+// each thread only ever writes its own ring, the dump reads behind the head
+struct ProfileRing {
+    struct ProfileRing* next;
+    int thread_id;
+    const char* thread_name;
+    atomic_ullong head;
+    struct ProfileEvent events[PROFILE_RING_SIZE];
+};
+
+// the list only changes when a thread starts or stops profiling, the lock keeps a dump off freed rings
+static struct ProfileRing* rings = NULL;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int next_thread_id = 1;
+static _Thread_local struct ProfileRing* local_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static long long now_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// runs when a thread that profiled exits, its events leave the trace with it
+static void free_ring(void* data) {
+    struct ProfileRing* ring = data;
+    pthread_mutex_lock(&rings_lock);
+    struct ProfileRing** link = &rings;
+    while (*link && *link != ring)
+        link = &(*link)->next;
+    if (*link)
+        *link = ring->next;
+    pthread_mutex_unlock(&rings_lock);
+    free(ring);
+    local_ring = NULL;
+}
+
+static void create_ring_key(void) {
+    if (pthread_key_create(&ring_key, free_ring) != 0)
+        printf("[PROFILE][ERROR] unable to create a thread key, rings of exited threads are kept\n");
+}
+
+static struct ProfileRing* get_ring(void) {
+    if (local_ring)
+        return local_ring;
+    pthread_once(&ring_key_once, create_ring_key);
+    struct ProfileRing* ring = calloc(1, sizeof(struct ProfileRing));
+    if (!ring)
+        return NULL;
+    ring->thread_id = atomic_fetch_add(&next_thread_id, 1);
+    atomic_init(&ring->head, 0);
+    pthread_mutex_lock(&rings_lock);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&rings_lock);
+    pthread_setspecific(ring_key, ring);
+    local_ring = ring;
+    return ring;
+}
+
+struct ProfileScope profile_scope_begin(const char* name) {
+    return (struct ProfileScope) {name, now_ns()};
+}
+
+void profile_scope_end(struct ProfileScope* scope) {
+    long long end = now_ns();
+    struct ProfileRing* ring = get_ring();
+    if (!ring)
+        return;
+    unsigned long long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring->events[head % PROFILE_RING_SIZE] = (struct ProfileEvent) {
+        scope->name, scope->start_ns, end - scope->start_ns
+    };
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void profile_thread_name(const char* name) {
+    struct ProfileRing* ring = get_ring();
+    if (ring)
+        ring->thread_name = name;
+}
+
+static void write_escaped(FILE* file, const char* text) {
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\')
+            fputc('\\', file);
+        fputc(*text, file);
+    }
+}
+
+// Chrome trace event format, loadable in chrome://tracing and Perfetto
+bool profile_dump(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        printf("[PROFILE][ERROR] unable to open \"%s\" for writing\n", path);
+        return false;
+    }
+    fprintf(file, "{\"traceEvents\":[");
+    bool first = true;
+    pthread_mutex_lock(&rings_lock);
+    for (struct ProfileRing* ring = rings; ring; ring = ring->next) {
+        if (ring->thread_name) {
+            fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"name\":\"", first ? "" : ",", ring->thread_id);
+            write_escaped(file, ring->thread_name);
+            fprintf(file, "\"}}");
+            first = false;
+        }
+        unsigned long long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned long long begin = head > PROFILE_RING_SIZE ? head - PROFILE_RING_SIZE : 0;
+        for (unsigned long long i = begin; i < head; i++) {
+            const struct ProfileEvent* event = &ring->events[i % PROFILE_RING_SIZE];
+            fprintf(file, "%s\n{\"name\":\"", first ? "" : ",");
+            write_escaped(file, event->name);
+            fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    ring->thread_id, event->start_ns / 1000.0, event->duration_ns / 1000.0);
+            first = false;
+        }
+    }
+    pthread_mutex_unlock(&rings_lock);
+    fprintf(file, "\n]}\n");
+    bool ok = fclose(file) == 0;
+    if (ok)
+        printf("[PROFILE] wrote trace to \"%s\"\n", path);
+    else
+        printf("[PROFILE][ERROR] failed to write \"%s\"\n", path);
+    return ok;
+}
+
+#endif
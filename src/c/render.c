@@ -0,0 +1,162 @@
+#include <render.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define RENDER_MAX_BACKENDS 4
+
+// nothing is drawn until a backend is picked, so headless builds never pull in GL
+static const struct RenderBackend* backend = NULL;
+static const struct RenderBackend* used[RENDER_MAX_BACKENDS]; // released by render_release
+static int used_count = 0;
+
+// the glyph atlas as handed over by the text code, mirrored lazily into the backend in use
+static const uint8_t* atlas = NULL;
+static int atlas_w = 0;
+static int atlas_h = 0;
+static const struct RenderBackend* atlas_backend = NULL; // backend holding a full copy
+static int atlas_dirty_x0, atlas_dirty_y0, atlas_dirty_x1, atlas_dirty_y1;
+
+void render_use_backend(const struct RenderBackend* next) {
+    if (next == backend)
+        return;
+    if (backend)
+        backend->flush();
+    backend = next;
+    for (int i = 0; i < used_count; i++)
+        if (used[i] == next)
+            return;
+    if (used_count < RENDER_MAX_BACKENDS)
+        used[used_count++] = next;
+    else
+        printf("[RENDER][ERROR] more than %d backends in use, %s is never released\n",
+               RENDER_MAX_BACKENDS, next->name);
+}
+
+const struct RenderBackend* render_current_backend(void) {
+    return backend;
+}
+
+void render_begin_frame(int width, int height) {
+    backend->begin_frame(width, height);
+}
+
+void render_end_frame(void) {
+    backend->end_frame();
+}
+
+void render_rect(int x1, int y1, int x2, int y2, color32 color) {
+    backend->fill_rect(x1, y1, x2, y2, color);
+}
+
+void render_box(int x, int y, int w, int h, color32 fill, color32 border, int border_width) {
+    if (backend->draw_box) {
+        backend->draw_box(x, y, w, h, fill, border, border_width);
+        return;
+    }
+    int t = border_width;
+    backend->fill_rect(x,      y,
+                       x + w,  y + t,      border);
+    backend->fill_rect(x,      y + h,
+                       x + w,  y + h - t,  border);
+    backend->fill_rect(x,      y + t,
+                       x + t,  y + h - t,  border);
+    backend->fill_rect(x + w,  y + t,
+                       x+w-t,  y + h - t,  border);
+    backend->fill_rect(x + t,  y + t,
+                       x+w-t,  y + h - t,  fill);
+}
+
+void render_set_clip(int x, int y, int w, int h) {
+    backend->set_clip(x, y, w, h);
+}
+
+void render_disable_clip(void) {
+    backend->disable_clip();
+}
+
+void render_clear(color32 color) {
+    backend->clear(color);
+}
+
+void render_flush(void) {
+    backend->flush();
+}
+
+bool render_supports_targets(void) {
+    return backend->create_target != NULL;
+}
+
+RenderTarget render_create_target(int width, int height) {
+    return backend->create_target(width, height);
+}
+
+void render_free_target(RenderTarget target) {
+    backend->free_target(target);
+}
+
+void render_begin_target(RenderTarget target, int x, int y) {
+    backend->begin_target(target, x, y);
+}
+
+void render_end_target(void) {
+    backend->end_target();
+}
+
+void render_draw_target(RenderTarget target, int x, int y) {
+    backend->draw_target(target, x, y);
+}
+
+bool render_supports_text(void) {
+    return backend->draw_glyph != NULL;
+}
+
+void render_set_atlas(const uint8_t* alpha, int width, int height) {
+    atlas = alpha;
+    atlas_w = width;
+    atlas_h = height;
+    atlas_backend = NULL;
+}
+
+void render_atlas_changed(int x, int y, int w, int h) {
+    if (atlas_dirty_x1 <= atlas_dirty_x0 || atlas_dirty_y1 <= atlas_dirty_y0) {
+        atlas_dirty_x0 = x;
+        atlas_dirty_y0 = y;
+        atlas_dirty_x1 = x + w;
+        atlas_dirty_y1 = y + h;
+        return;
+    }
+    atlas_dirty_x0 = MIN(atlas_dirty_x0, x);
+    atlas_dirty_y0 = MIN(atlas_dirty_y0, y);
+    atlas_dirty_x1 = MAX(atlas_dirty_x1, x + w);
+    atlas_dirty_y1 = MAX(atlas_dirty_y1, y + h);
+}
+
+// a backend seeing the atlas for the first time gets all of it, later only what changed
+static void sync_atlas(void) {
+    if (atlas_backend != backend) {
+        backend->update_atlas(atlas, atlas_w, atlas_h, 0, 0, atlas_w, atlas_h);
+        atlas_backend = backend;
+    }
+    else if (atlas_dirty_x1 > atlas_dirty_x0 && atlas_dirty_y1 > atlas_dirty_y0)
+        backend->update_atlas(atlas, atlas_w, atlas_h, atlas_dirty_x0, atlas_dirty_y0,
+                              atlas_dirty_x1 - atlas_dirty_x0, atlas_dirty_y1 - atlas_dirty_y0);
+    else
+        return;
+    atlas_dirty_x0 = atlas_dirty_x1 = 0;
+    atlas_dirty_y0 = atlas_dirty_y1 = 0;
+}
+
+void render_glyph(int x, int y, int w, int h, int u, int v, color32 color) {
+    if (!backend->draw_glyph || !atlas)
+        return;
+    sync_atlas();
+    backend->draw_glyph(x, y, w, h, u, v, color);
+}
+
+void render_release(void) {
+    for (int i = 0; i < used_count; i++)
+        used[i]->release();
+    used_count = 0;
+    backend = NULL;
+    atlas_backend = NULL;
+}
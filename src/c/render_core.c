@@ -0,0 +1,436 @@
+#define GL_GLEXT_PROTOTYPES
+#include <render.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#define CORE_INITIAL_CAPACITY 1024
+
+// one record per rect, expanded to a quad by the vertex shader
+struct CoreInstance {
+    GLint rect[4]; // x0, y0, x1, y1 with x0 <= x1 and y0 <= y1
+    color32 fill;
+    color32 border;
+    GLfloat border_width;
+    GLint glyph[2]; // atlas texel under the bottom left corner, -1 for boxes
+};
+
+static const char* vertex_source =
+    "#version 330 core\n"
+    "layout(location = 0) in ivec4 rect;\n"
+    "layout(location = 1) in vec4 fill;\n"
+    "layout(location = 2) in vec4 border;\n"
+    "layout(location = 3) in float border_width;\n"
+    "layout(location = 4) in ivec2 glyph;\n"
+    "uniform vec2 viewport;\n"
+    "uniform vec2 origin;\n"
+    "flat out vec4 v_rect;\n"
+    "flat out vec4 v_fill;\n"
+    "flat out vec4 v_border;\n"
+    "flat out float v_border_width;\n"
+    "flat out ivec2 v_glyph;\n"
+    "void main() {\n"
+    "    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "    vec2 position = mix(vec2(rect.xy), vec2(rect.zw), corner);\n"
+    "    gl_Position = vec4((position - origin) / viewport * 2.0 - 1.0, 0.0, 1.0);\n"
+    "    v_rect = vec4(rect) - origin.xyxy;\n"
+    "    v_fill = fill;\n"
+    "    v_border = border;\n"
+    "    v_border_width = border_width;\n"
+    "    v_glyph = glyph;\n"
+    "}\n";
+
+// gl_FragCoord is in window pixels with a bottom left origin, like the UI
+static const char* fragment_source =
+    "#version 330 core\n"
+    "flat in vec4 v_rect;\n"
+    "flat in vec4 v_fill;\n"
+    "flat in vec4 v_border;\n"
+    "flat in float v_border_width;\n"
+    "flat in ivec2 v_glyph;\n"
+    "uniform sampler2D atlas;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    vec2 p = gl_FragCoord.xy;\n"
+    "    if (v_glyph.x >= 0) {\n"
+    "        float coverage = texelFetch(atlas, v_glyph + ivec2(p - v_rect.xy), 0).r;\n"
+    "        color = vec4(v_fill.rgb, v_fill.a * coverage);\n"
+    "        return;\n"
+    "    }\n"
+    "    bool edge = any(lessThan(p, v_rect.xy + v_border_width)) ||\n"
+    "                any(greaterThan(p, v_rect.zw - v_border_width));\n"
+    "    color = edge ? v_border : v_fill;\n"
+    "}\n";
+
+// composites a premultiplied target texture
+static const char* blit_vertex_source =
+    "#version 330 core\n"
+    "uniform vec4 rect;\n"
+    "uniform vec2 viewport;\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    uv = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "    vec2 position = mix(rect.xy, rect.zw, uv);\n"
+    "    gl_Position = vec4(position / viewport * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* blit_fragment_source =
+    "#version 330 core\n"
+    "uniform sampler2D image;\n"
+    "in vec2 uv;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    color = texture(image, uv);\n"
+    "}\n";
+
+struct RenderTarget {
+    GLuint framebuffer;
+    GLuint texture;
+    int width, height;
+};
+
+static bool initialized = false;
+static bool broken = false;
+static GLuint program = 0;
+static GLuint vertex_array = 0;
+static GLuint instance_buffer = 0;
+static GLint viewport_location = -1;
+static GLint origin_location = -1;
+static GLuint atlas_texture = 0;
+static int atlas_width = 0;
+static int atlas_height = 0;
+
+static GLuint blit_program = 0;
+static GLuint blit_array = 0;
+static GLint blit_rect_location = -1;
+static GLint blit_viewport_location = -1;
+
+static int frame_width = 0;
+static int frame_height = 0;
+static int origin_x = 0;
+static int origin_y = 0;
+
+static struct CoreInstance* instances = NULL;
+static size_t instance_count = 0;
+static size_t instance_capacity = 0;
+
+static GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint ok;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        printf("[RENDER][ERROR] shader compilation failed: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint link_program(const char* vertex_text, const char* fragment_text) {
+    GLuint vertex = compile_shader(GL_VERTEX_SHADER, vertex_text);
+    GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_text);
+    if (!vertex || !fragment) {
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        return 0;
+    }
+    GLuint out = glCreateProgram();
+    glAttachShader(out, vertex);
+    glAttachShader(out, fragment);
+    glLinkProgram(out);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    GLint ok;
+    glGetProgramiv(out, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[512];
+        glGetProgramInfoLog(out, sizeof(log), NULL, log);
+        printf("[RENDER][ERROR] shader linking failed: %s\n", log);
+        glDeleteProgram(out);
+        return 0;
+    }
+    return out;
+}
+
+static bool init_core(void) {
+    if (initialized)
+        return !broken;
+    initialized = true;
+    program = link_program(vertex_source, fragment_source);
+    blit_program = link_program(blit_vertex_source, blit_fragment_source);
+    if (!program || !blit_program) {
+        broken = true;
+        return false;
+    }
+    viewport_location = glGetUniformLocation(program, "viewport");
+    origin_location = glGetUniformLocation(program, "origin");
+    // unit 0 stays free for the blit
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "atlas"), 1);
+    blit_rect_location = glGetUniformLocation(blit_program, "rect");
+    blit_viewport_location = glGetUniformLocation(blit_program, "viewport");
+    glUseProgram(blit_program);
+    glUniform1i(glGetUniformLocation(blit_program, "image"), 0);
+    // core profiles need a bound vertex array even when nothing is fetched
+    glGenVertexArrays(1, &blit_array);
+
+    glGenVertexArrays(1, &vertex_array);
+    glGenBuffers(1, &instance_buffer);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    GLsizei stride = sizeof(struct CoreInstance);
+    glVertexAttribIPointer(0, 4, GL_INT, stride, (void*) offsetof(struct CoreInstance, rect));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*) offsetof(struct CoreInstance, fill));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*) offsetof(struct CoreInstance, border));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*) offsetof(struct CoreInstance, border_width));
+    glVertexAttribIPointer(4, 2, GL_INT, stride, (void*) offsetof(struct CoreInstance, glyph));
+    for (GLuint i = 0; i < 5; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    glBindVertexArray(0);
+    return true;
+}
+
+static struct CoreInstance* reserve_instance(void) {
+    if (instance_count == instance_capacity) {
+        size_t capacity = instance_capacity ? instance_capacity * 2 : CORE_INITIAL_CAPACITY;
+        struct CoreInstance* grown = realloc(instances, sizeof(struct CoreInstance) * capacity);
+        if (!grown) {
+            printf("[RENDER][ERROR] out of memory while growing the instance batch\n");
+            return NULL;
+        }
+        instances = grown;
+        instance_capacity = capacity;
+    }
+    return instances + instance_count++;
+}
+
+static void core_flush(void) {
+    if (instance_count == 0)
+        return;
+    if (broken) {
+        instance_count = 0;
+        return;
+    }
+    size_t size = sizeof(struct CoreInstance) * instance_count;
+    glUseProgram(program);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    // orphan the old storage so the driver never waits on the previous draw
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, atlas_texture);
+    glActiveTexture(GL_TEXTURE0);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instance_count);
+    glBindVertexArray(0);
+    instance_count = 0;
+}
+
+static void set_projection(int width, int height, int x, int y) {
+    glViewport(0, 0, width, height);
+    glUseProgram(program);
+    glUniform2f(viewport_location, width, height);
+    glUniform2f(origin_location, x, y);
+    origin_x = x;
+    origin_y = y;
+}
+
+static void core_begin_frame(int width, int height) {
+    if (!init_core())
+        return;
+    frame_width = width;
+    frame_height = height;
+    set_projection(width, height, 0, 0);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_BLEND);
+}
+
+static void core_draw_box(int x, int y, int w, int h, color32 fill,
+                          color32 border, int border_width) {
+    struct CoreInstance* instance = reserve_instance();
+    if (!instance)
+        return;
+    *instance = (struct CoreInstance) {
+        .rect = {MIN(x, x + w), MIN(y, y + h), MAX(x, x + w), MAX(y, y + h)},
+        .fill = fill,
+        .border = border,
+        .border_width = border_width,
+        .glyph = {-1, -1}
+    };
+}
+
+static void core_draw_glyph(int x, int y, int w, int h, int u, int v, color32 color) {
+    struct CoreInstance* instance = reserve_instance();
+    if (!instance)
+        return;
+    *instance = (struct CoreInstance) {
+        .rect = {x, y, x + w, y + h},
+        .fill = color,
+        .border = color,
+        .border_width = 0,
+        .glyph = {u, v}
+    };
+}
+
+static void core_update_atlas(const uint8_t* alpha, int width, int height, int x, int y, int w, int h) {
+    if (!atlas_texture || width != atlas_width || height != atlas_height) {
+        if (!atlas_texture)
+            glGenTextures(1, &atlas_texture);
+        glBindTexture(GL_TEXTURE_2D, atlas_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        atlas_width = width;
+        atlas_height = height;
+    }
+    glBindTexture(GL_TEXTURE_2D, atlas_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE,
+                    alpha + (size_t) y * width + x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void core_fill_rect(int x1, int y1, int x2, int y2, color32 color) {
+    core_draw_box(x1, y1, x2 - x1, y2 - y1, color, color, 0);
+}
+
+static void core_set_clip(int x, int y, int w, int h) {
+    core_flush();
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x - origin_x, y - origin_y, w, h);
+}
+
+static void core_disable_clip(void) {
+    core_flush();
+    glDisable(GL_SCISSOR_TEST);
+}
+
+static void core_clear(color32 color) {
+    core_flush();
+    glClearColor(color.r / 255.0, color.g / 255.0, color.b / 255.0, color.a / 255.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+static RenderTarget core_create_target(int width, int height) {
+    if (!init_core())
+        return NULL;
+    RenderTarget target = malloc(sizeof(struct RenderTarget));
+    target->width = width;
+    target->height = height;
+    glGenTextures(1, &target->texture);
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &target->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        printf("[RENDER][ERROR] unable to create a %dx%d render target\n", width, height);
+        glDeleteFramebuffers(1, &target->framebuffer);
+        glDeleteTextures(1, &target->texture);
+        free(target);
+        return NULL;
+    }
+    return target;
+}
+
+static void core_free_target(RenderTarget target) {
+    glDeleteFramebuffers(1, &target->framebuffer);
+    glDeleteTextures(1, &target->texture);
+    free(target);
+}
+
+static void core_begin_target(RenderTarget target, int x, int y) {
+    core_flush();
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    set_projection(target->width, target->height, x, y);
+    // accumulate premultiplied color so the texture can be composited later
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+static void core_end_target(void) {
+    core_flush();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDisable(GL_SCISSOR_TEST);
+    set_projection(frame_width, frame_height, 0, 0);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+static void core_draw_target(RenderTarget target, int x, int y) {
+    core_flush();
+    glUseProgram(blit_program);
+    glUniform4f(blit_rect_location, x, y, x + target->width, y + target->height);
+    glUniform2f(blit_viewport_location, frame_width, frame_height);
+    glBindVertexArray(blit_array);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+}
+
+static void core_release(void) {
+    if (initialized && !broken) {
+        glDeleteBuffers(1, &instance_buffer);
+        glDeleteVertexArrays(1, &vertex_array);
+        glDeleteVertexArrays(1, &blit_array);
+    }
+    if (atlas_texture)
+        glDeleteTextures(1, &atlas_texture);
+    atlas_texture = 0;
+    atlas_width = atlas_height = 0;
+    if (program)
+        glDeleteProgram(program);
+    if (blit_program)
+        glDeleteProgram(blit_program);
+    program = 0;
+    blit_program = 0;
+    initialized = false;
+    broken = false;
+    free(instances);
+    instances = NULL;
+    instance_count = 0;
+    instance_capacity = 0;
+}
+
+const struct RenderBackend render_core_backend = {
+    .name = "core",
+    .begin_frame = core_begin_frame,
+    .end_frame = core_flush,
+    .fill_rect = core_fill_rect,
+    .draw_box = core_draw_box,
+    .set_clip = core_set_clip,
+    .disable_clip = core_disable_clip,
+    .clear = core_clear,
+    .flush = core_flush,
+    .release = core_release,
+    .create_target = core_create_target,
+    .free_target = core_free_target,
+    .begin_target = core_begin_target,
+    .end_target = core_end_target,
+    .draw_target = core_draw_target,
+    .update_atlas = core_update_atlas,
+    .draw_glyph = core_draw_glyph
+};
@@ -0,0 +1,258 @@
+#define GL_GLEXT_PROTOTYPES
+#include <render.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#define RENDER_INITIAL_CAPACITY 1024
+
+struct RenderVertex {
+    GLint x, y;
+    color32 color;
+    GLfloat u, v; // rects sample the covered atlas texel at (0, 0)
+};
+
+struct RenderTarget {
+    GLuint framebuffer;
+    GLuint texture;
+    int width, height;
+};
+
+static int frame_width = 0;
+static int frame_height = 0;
+static int origin_x = 0;
+static int origin_y = 0;
+
+static struct RenderVertex* vertices = NULL;
+static size_t vertex_count = 0;
+static size_t vertex_capacity = 0;
+
+static GLuint atlas_texture = 0;
+static int atlas_width = 0;
+static int atlas_height = 0;
+
+static struct RenderVertex* reserve_vertices(size_t count) {
+    if (vertex_count + count > vertex_capacity) {
+        size_t capacity = vertex_capacity ? vertex_capacity : RENDER_INITIAL_CAPACITY;
+        while (capacity < vertex_count + count)
+            capacity *= 2;
+        struct RenderVertex* grown = realloc(vertices, sizeof(struct RenderVertex) * capacity);
+        if (!grown) {
+            printf("[RENDER][ERROR] out of memory while growing the vertex batch\n");
+            return NULL;
+        }
+        vertices = grown;
+        vertex_capacity = capacity;
+    }
+    struct RenderVertex* out = vertices + vertex_count;
+    vertex_count += count;
+    return out;
+}
+
+static void gl_fill_rect(int x1, int y1, int x2, int y2, color32 color) {
+    struct RenderVertex* v = reserve_vertices(4);
+    if (!v)
+        return;
+    v[0] = (struct RenderVertex) {x1, y1, color, 0, 0};
+    v[1] = (struct RenderVertex) {x2, y1, color, 0, 0};
+    v[2] = (struct RenderVertex) {x2, y2, color, 0, 0};
+    v[3] = (struct RenderVertex) {x1, y2, color, 0, 0};
+}
+
+static void gl_draw_glyph(int x, int y, int w, int h, int u, int v, color32 color) {
+    struct RenderVertex* out = reserve_vertices(4);
+    if (!out)
+        return;
+    GLfloat u0 = (GLfloat) u / atlas_width, u1 = (GLfloat) (u + w) / atlas_width;
+    GLfloat v0 = (GLfloat) v / atlas_height, v1 = (GLfloat) (v + h) / atlas_height;
+    out[0] = (struct RenderVertex) {x, y, color, u0, v0};
+    out[1] = (struct RenderVertex) {x + w, y, color, u1, v0};
+    out[2] = (struct RenderVertex) {x + w, y + h, color, u1, v1};
+    out[3] = (struct RenderVertex) {x, y + h, color, u0, v1};
+}
+
+static void gl_flush(void) {
+    if (vertex_count == 0)
+        return;
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_INT, sizeof(struct RenderVertex), &vertices->x);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(struct RenderVertex), vertices->color.rgba);
+    // rects and glyphs share the batch, the atlas alpha scales the vertex color
+    if (atlas_texture) {
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, atlas_texture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(struct RenderVertex), &vertices->u);
+    }
+    glDrawArrays(GL_QUADS, 0, vertex_count);
+    if (atlas_texture) {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+    }
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    vertex_count = 0;
+}
+
+static void gl_update_atlas(const uint8_t* alpha, int width, int height, int x, int y, int w, int h) {
+    if (!atlas_texture || width != atlas_width || height != atlas_height) {
+        if (!atlas_texture)
+            glGenTextures(1, &atlas_texture);
+        glBindTexture(GL_TEXTURE_2D, atlas_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, width, height, 0, GL_ALPHA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        atlas_width = width;
+        atlas_height = height;
+    }
+    glBindTexture(GL_TEXTURE_2D, atlas_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_ALPHA, GL_UNSIGNED_BYTE,
+                    alpha + (size_t) y * width + x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void gl_begin_frame(int width, int height) {
+    frame_width = width;
+    frame_height = height;
+}
+
+static void gl_set_clip(int x, int y, int w, int h) {
+    // queued rects must reach the driver before the scissor box changes
+    gl_flush();
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x - origin_x, y - origin_y, w, h);
+}
+
+static void gl_disable_clip(void) {
+    gl_flush();
+    glDisable(GL_SCISSOR_TEST);
+}
+
+static void gl_clear(color32 color) {
+    gl_flush();
+    glClearColor(color.r / 255.0, color.g / 255.0, color.b / 255.0, color.a / 255.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+static void gl_release(void) {
+    if (atlas_texture)
+        glDeleteTextures(1, &atlas_texture);
+    atlas_texture = 0;
+    atlas_width = atlas_height = 0;
+    free(vertices);
+    vertices = NULL;
+    vertex_count = 0;
+    vertex_capacity = 0;
+}
+
+static RenderTarget gl_create_target(int width, int height) {
+    RenderTarget target = malloc(sizeof(struct RenderTarget));
+    target->width = width;
+    target->height = height;
+    glGenTextures(1, &target->texture);
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &target->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        printf("[RENDER][ERROR] unable to create a %dx%d render target\n", width, height);
+        glDeleteFramebuffers(1, &target->framebuffer);
+        glDeleteTextures(1, &target->texture);
+        free(target);
+        return NULL;
+    }
+    return target;
+}
+
+static void gl_free_target(RenderTarget target) {
+    glDeleteFramebuffers(1, &target->framebuffer);
+    glDeleteTextures(1, &target->texture);
+    free(target);
+}
+
+static void gl_begin_target(RenderTarget target, int x, int y) {
+    gl_flush();
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glViewport(0, 0, target->width, target->height);
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(x, x + target->width, y, y + target->height, -1, 1);
+    // accumulate premultiplied color so the texture can be composited later
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    origin_x = x;
+    origin_y = y;
+}
+
+static void gl_end_target(void) {
+    gl_flush();
+    glPopMatrix();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, frame_width, frame_height);
+    glDisable(GL_SCISSOR_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    origin_x = 0;
+    origin_y = 0;
+}
+
+static void gl_draw_target(RenderTarget target, int x, int y) {
+    gl_flush();
+    GLint corners[8] = {
+        x, y, x + target->width, y,
+        x + target->width, y + target->height, x, y + target->height
+    };
+    GLfloat coords[8] = {0, 0, 1, 0, 1, 1, 0, 1};
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_INT, 0, corners);
+    glTexCoordPointer(2, GL_FLOAT, 0, coords);
+    glDrawArrays(GL_QUADS, 0, 4);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+const struct RenderBackend render_gl_backend = {
+    .name = "gl",
+    .begin_frame = gl_begin_frame,
+    .end_frame = gl_flush,
+    .fill_rect = gl_fill_rect,
+    .set_clip = gl_set_clip,
+    .disable_clip = gl_disable_clip,
+    .clear = gl_clear,
+    .flush = gl_flush,
+    .release = gl_release,
+    .create_target = gl_create_target,
+    .free_target = gl_free_target,
+    .begin_target = gl_begin_target,
+    .end_target = gl_end_target,
+    .draw_target = gl_draw_target,
+    .update_atlas = gl_update_atlas,
+    .draw_glyph = gl_draw_glyph
+};
@@ -0,0 +1,329 @@
+#include <render.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RENDER_SOFT_SSE2
+#endif
+
+// row 0 is the bottom, matching the GL window coordinates
+struct RenderTarget {
+    color32* pixels;
+    int width, height;
+};
+
+static struct RenderTarget frame = {NULL, 0, 0};
+static size_t pixel_capacity = 0;
+
+// drawing goes to the frame or to the bound target, offset by its origin
+static struct RenderTarget* current = &frame;
+static int origin_x = 0;
+static int origin_y = 0;
+
+static bool clip_enabled = false;
+static int clip_x0, clip_y0, clip_x1, clip_y1;
+
+static uint8_t* atlas = NULL;
+static int atlas_width = 0;
+static int atlas_height = 0;
+
+// round(v / 255) for v in [0, 255 * 255], the same in scalar and SIMD form
+static inline uint8_t div255(unsigned v) {
+    v += 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+static void fill_span(color32* dst, int count, color32 color) {
+    int i = 0;
+#ifdef RENDER_SOFT_SSE2
+    __m128i c = _mm_set1_epi32(color.i);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128((__m128i*) (dst + i), c);
+#endif
+    for (; i < count; i++)
+        dst[i] = color;
+}
+
+// dst = src * a + dst * (1 - a) on every channel, like GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA;
+// targets pass a src alpha of 255 so they accumulate premultiplied color
+static void blend_span(color32* dst, int count, color32 color, unsigned a) {
+    unsigned inv = 255 - a;
+    int i = 0;
+#ifdef RENDER_SOFT_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32(color.i), zero);
+    __m128i src_term = _mm_add_epi16(_mm_mullo_epi16(src, _mm_set1_epi16(a)), _mm_set1_epi16(128));
+    __m128i inv16 = _mm_set1_epi16(inv);
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((__m128i*) (dst + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv16), src_term);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv16), src_term);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++)
+        for (int c = 0; c < 4; c++)
+            dst[i].rgba[c] = div255(color.rgba[c] * a + dst[i].rgba[c] * inv);
+}
+
+// dst = src + dst * (1 - src alpha), like GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+static void composite_span(color32* dst, const color32* src, int count) {
+    int i = 0;
+#ifdef RENDER_SOFT_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi16(255);
+    __m128i half = _mm_set1_epi16(128);
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i d = _mm_loadu_si128((__m128i*) (dst + i));
+        __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+        __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+        __m128i inv_lo = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xff), 0xff));
+        __m128i inv_hi = _mm_sub_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xff), 0xff));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_lo), half);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_hi), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i*) (dst + i),
+                         _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+#endif
+    for (; i < count; i++) {
+        unsigned inv = 255 - src[i].a;
+        for (int c = 0; c < 4; c++)
+            dst[i].rgba[c] = MIN(src[i].rgba[c] + div255(dst[i].rgba[c] * inv), 255);
+    }
+}
+
+static bool clip_span(int* x0, int* y0, int* x1, int* y1) {
+    *x0 = MAX(*x0, 0);
+    *y0 = MAX(*y0, 0);
+    *x1 = MIN(*x1, current->width);
+    *y1 = MIN(*y1, current->height);
+    if (clip_enabled) {
+        *x0 = MAX(*x0, clip_x0);
+        *y0 = MAX(*y0, clip_y0);
+        *x1 = MIN(*x1, clip_x1);
+        *y1 = MIN(*y1, clip_y1);
+    }
+    return *x1 > *x0 && *y1 > *y0;
+}
+
+static void soft_begin_frame(int width, int height) {
+    if (width != frame.width || height != frame.height) {
+        size_t needed = (size_t) MAX(width, 0) * MAX(height, 0);
+        if (needed > pixel_capacity) {
+            color32* grown = realloc(frame.pixels, sizeof(color32) * needed);
+            if (!grown) {
+                printf("[RENDER][ERROR] out of memory while resizing the software frame\n");
+                return;
+            }
+            frame.pixels = grown;
+            pixel_capacity = needed;
+        }
+        memset(frame.pixels, 0, sizeof(color32) * needed);
+        frame.width = width;
+        frame.height = height;
+    }
+    clip_enabled = false;
+}
+
+static void soft_end_frame(void) {
+}
+
+// covers the pixels whose centers lie inside the rect, like a GL quad
+static void soft_fill_rect(int x1, int y1, int x2, int y2, color32 color) {
+    if (color.a == 0)
+        return;
+    int x0 = MIN(x1, x2) - origin_x, y0 = MIN(y1, y2) - origin_y;
+    int xe = MAX(x1, x2) - origin_x, ye = MAX(y1, y2) - origin_y;
+    if (!clip_span(&x0, &y0, &xe, &ye))
+        return;
+    unsigned alpha = color.a;
+    if (current != &frame)
+        color.a = 0xff;
+    for (int y = y0; y < ye; y++) {
+        color32* row = current->pixels + (size_t) y * current->width + x0;
+        if (alpha == 0xff)
+            fill_span(row, xe - x0, color);
+        else
+            blend_span(row, xe - x0, color, alpha);
+    }
+}
+
+static void soft_draw_glyph(int x, int y, int w, int h, int u, int v, color32 color) {
+    int x0 = x - origin_x, y0 = y - origin_y;
+    int xe = x0 + w, ye = y0 + h;
+    if (!clip_span(&x0, &y0, &xe, &ye))
+        return;
+    unsigned alpha = color.a;
+    bool target = current != &frame;
+    if (target)
+        color.a = 0xff;
+    for (int row = y0; row < ye; row++) {
+        color32* dst = current->pixels + (size_t) row * current->width;
+        const uint8_t* coverage = atlas + (size_t) (v + row - (y - origin_y)) * atlas_width
+                                  + u - (x - origin_x);
+        for (int col = x0; col < xe; col++) {
+            if (!coverage[col])
+                continue;
+            unsigned a = div255(coverage[col] * alpha);
+            // like the atlas modulating the vertex alpha in GL, the blended alpha is the covered one
+            if (!target)
+                color.a = a;
+            if (a == 0xff)
+                dst[col] = color;
+            else if (a)
+                blend_span(dst + col, 1, color, a);
+        }
+    }
+}
+
+static void soft_update_atlas(const uint8_t* alpha, int width, int height, int x, int y, int w, int h) {
+    if (width != atlas_width || height != atlas_height) {
+        uint8_t* grown = realloc(atlas, (size_t) width * height);
+        if (!grown) {
+            printf("[RENDER][ERROR] out of memory while copying the glyph atlas\n");
+            return;
+        }
+        atlas = grown;
+        atlas_width = width;
+        atlas_height = height;
+        x = y = 0;
+        w = width;
+        h = height;
+    }
+    for (int row = y; row < y + h; row++)
+        memcpy(atlas + (size_t) row * width + x, alpha + (size_t) row * width + x, w);
+}
+
+static void soft_set_clip(int x, int y, int w, int h) {
+    clip_enabled = true;
+    clip_x0 = x - origin_x;
+    clip_y0 = y - origin_y;
+    clip_x1 = clip_x0 + w;
+    clip_y1 = clip_y0 + h;
+}
+
+static void soft_disable_clip(void) {
+    clip_enabled = false;
+}
+
+static void soft_clear(color32 color) {
+    int x0 = 0, y0 = 0, x1 = current->width, y1 = current->height;
+    if (!clip_span(&x0, &y0, &x1, &y1))
+        return;
+    for (int y = y0; y < y1; y++)
+        fill_span(current->pixels + (size_t) y * current->width + x0, x1 - x0, color);
+}
+
+static void soft_flush(void) {
+}
+
+static void soft_release(void) {
+    free(frame.pixels);
+    frame = (struct RenderTarget) {NULL, 0, 0};
+    pixel_capacity = 0;
+    current = &frame;
+    origin_x = 0;
+    origin_y = 0;
+    free(atlas);
+    atlas = NULL;
+    atlas_width = atlas_height = 0;
+}
+
+static RenderTarget soft_create_target(int width, int height) {
+    RenderTarget target = malloc(sizeof(struct RenderTarget));
+    target->pixels = malloc(sizeof(color32) * MAX(width, 1) * MAX(height, 1));
+    target->width = width;
+    target->height = height;
+    return target;
+}
+
+static void soft_free_target(RenderTarget target) {
+    free(target->pixels);
+    free(target);
+}
+
+static void soft_begin_target(RenderTarget target, int x, int y) {
+    current = target;
+    origin_x = x;
+    origin_y = y;
+    clip_enabled = false;
+    memset(target->pixels, 0, sizeof(color32) * target->width * target->height);
+}
+
+static void soft_end_target(void) {
+    current = &frame;
+    origin_x = 0;
+    origin_y = 0;
+    clip_enabled = false;
+}
+
+static void soft_draw_target(RenderTarget target, int x, int y) {
+    int x0 = x, y0 = y, x1 = x + target->width, y1 = y + target->height;
+    if (!clip_span(&x0, &y0, &x1, &y1))
+        return;
+    for (int row = y0; row < y1; row++)
+        composite_span(frame.pixels + (size_t) row * frame.width + x0,
+                       target->pixels + (size_t) (row - y) * target->width + (x0 - x),
+                       x1 - x0);
+}
+
+const struct RenderBackend render_soft_backend = {
+    .name = "soft",
+    .begin_frame = soft_begin_frame,
+    .end_frame = soft_end_frame,
+    .fill_rect = soft_fill_rect,
+    .set_clip = soft_set_clip,
+    .disable_clip = soft_disable_clip,
+    .clear = soft_clear,
+    .flush = soft_flush,
+    .release = soft_release,
+    .create_target = soft_create_target,
+    .free_target = soft_free_target,
+    .begin_target = soft_begin_target,
+    .end_target = soft_end_target,
+    .draw_target = soft_draw_target,
+    .update_atlas = soft_update_atlas,
+    .draw_glyph = soft_draw_glyph
+};
+
+const color32* render_soft_pixels(int* width, int* height) {
+    if (width)
+        *width = frame.width;
+    if (height)
+        *height = frame.height;
+    return frame.pixels;
+}
+
+// binary PPM, top row first, alpha is dropped
+bool render_soft_write_ppm(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        printf("[RENDER][ERROR] unable to open \"%s\" for writing\n", path);
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", frame.width, frame.height);
+    uint8_t* row = malloc((size_t) frame.width * 3 + 1);
+    bool ok = row != NULL;
+    for (int y = frame.height - 1; ok && y >= 0; y--) {
+        const color32* src = frame.pixels + (size_t) y * frame.width;
+        for (int x = 0; x < frame.width; x++) {
+            row[x * 3] = src[x].r;
+            row[x * 3 + 1] = src[x].g;
+            row[x * 3 + 2] = src[x].b;
+        }
+        ok = fwrite(row, 3, frame.width, file) == (size_t) frame.width;
+    }
+    free(row);
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok)
+        printf("[RENDER][ERROR] failed to write \"%s\"\n", path);
+    return ok;
+}
@@ -0,0 +1,196 @@
+#include <task_pool.h>
+#include <profile.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// the lock is only held for a copy in or out, so waiting on it spins
+struct TaskDeque {
+    _Alignas(64) atomic_flag lock;
+    long top, bottom; // tasks[top..bottom), both only grow
+    TaskPool pool;
+    int index;
+    TaskPoolTask tasks[TASK_POOL_DEQUE];
+};
+
+struct TaskPool {
+    int threads;
+    pthread_t* workers; // threads - 1, the caller of task_pool_run is worker 0
+    struct TaskDeque* deques;
+    atomic_long pending; // tasks queued or running
+    // a run bumps the generation to wake the workers, they go back to sleep when pending drops to 0
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    unsigned generation;
+    bool stop;
+};
+
+static void lock_deque(struct TaskDeque* deque) {
+    while (atomic_flag_test_and_set_explicit(&deque->lock, memory_order_acquire))
+        ;
+}
+
+static void unlock_deque(struct TaskDeque* deque) {
+    atomic_flag_clear_explicit(&deque->lock, memory_order_release);
+}
+
+static bool push(struct TaskDeque* deque, const TaskPoolTask* task) {
+    lock_deque(deque);
+    bool room = deque->bottom - deque->top < TASK_POOL_DEQUE;
+    if (room)
+        deque->tasks[deque->bottom++ % TASK_POOL_DEQUE] = *task;
+    unlock_deque(deque);
+    return room;
+}
+
+// the newest task, the one whose data is most likely still in this core's cache
+static bool pop(struct TaskDeque* deque, TaskPoolTask* out) {
+    lock_deque(deque);
+    bool found = deque->bottom > deque->top;
+    if (found)
+        *out = deque->tasks[--deque->bottom % TASK_POOL_DEQUE];
+    unlock_deque(deque);
+    return found;
+}
+
+static bool steal(struct TaskDeque* deque, TaskPoolTask* out) {
+    lock_deque(deque);
+    bool found = deque->bottom > deque->top;
+    if (found)
+        *out = deque->tasks[deque->top++ % TASK_POOL_DEQUE];
+    unlock_deque(deque);
+    return found;
+}
+
+static bool run_one(TaskPool pool, int worker, unsigned* seed) {
+    TaskPoolTask task;
+    bool found = pop(&pool->deques[worker], &task);
+    // victims are tried from a random start so thieves spread out
+    *seed = *seed * 1103515245 + 12345;
+    int start = (*seed >> 16) % pool->threads;
+    for (int i = 0; i < pool->threads && !found; i++) {
+        int victim = (start + i) % pool->threads;
+        if (victim != worker)
+            found = steal(&pool->deques[victim], &task);
+    }
+    if (!found)
+        return false;
+    task.run(&task, worker);
+    atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_acq_rel);
+    return true;
+}
+
+static void work(TaskPool pool, int worker) {
+    unsigned seed = worker + 1;
+    while (atomic_load_explicit(&pool->pending, memory_order_acquire) > 0)
+        if (!run_one(pool, worker, &seed))
+            sched_yield();
+}
+
+static void* worker_main(void* arg) {
+    struct TaskDeque* deque = arg;
+    TaskPool pool = deque->pool;
+    PROFILE_THREAD_NAME("task worker");
+    unsigned seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->stop && pool->generation == seen)
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        bool stop = pool->stop;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+        if (stop)
+            return NULL;
+        work(pool, deque->index);
+    }
+}
+
+TaskPool task_pool_create(int threads) {
+    if (threads <= 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0)
+        threads = 1;
+    struct TaskPool* pool = calloc(1, sizeof(struct TaskPool));
+    struct TaskDeque* deques = aligned_alloc(_Alignof(struct TaskDeque), sizeof(struct TaskDeque) * threads);
+    pthread_t* workers = malloc(sizeof(pthread_t) * threads);
+    if (!pool || !deques || !workers) {
+        printf("[TASK_POOL][ERROR] out of memory while creating a pool of %d threads\n", threads);
+        free(pool);
+        free(deques);
+        free(workers);
+        return NULL;
+    }
+    pool->deques = deques;
+    pool->workers = workers;
+    atomic_init(&pool->pending, 0);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (int i = 0; i < threads; i++) {
+        atomic_flag_clear(&deques[i].lock);
+        deques[i].top = deques[i].bottom = 0;
+        deques[i].pool = pool;
+        deques[i].index = i;
+    }
+    // a pool with fewer workers than asked for still runs everything
+    pool->threads = 1;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[i - 1], NULL, worker_main, &deques[i]) != 0) {
+            printf("[TASK_POOL][ERROR] unable to start worker %d, using %d threads\n", i, i);
+            break;
+        }
+        pool->threads++;
+    }
+    return pool;
+}
+
+void task_pool_free(TaskPool pool) {
+    if (!pool)
+        return;
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->threads - 1; i++)
+        pthread_join(pool->workers[i], NULL);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->workers);
+    free(pool->deques);
+    free(pool);
+}
+
+int task_pool_threads(TaskPool pool) {
+    return pool->threads;
+}
+
+void task_pool_run(TaskPool pool, const TaskPoolTask* task) {
+    PROFILE_SCOPE("task_pool_run");
+    if (pool->threads == 1) {
+        task->run(task, 0);
+        return;
+    }
+    atomic_store_explicit(&pool->pending, 1, memory_order_relaxed);
+    push(&pool->deques[0], task);
+    pthread_mutex_lock(&pool->mutex);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    work(pool, 0);
+}
+
+void task_pool_spawn(TaskPool pool, int worker, const TaskPoolTask* task) {
+    if (pool->threads == 1) {
+        task->run(task, worker);
+        return;
+    }
+    // the spawning task is still pending, so the count can not reach 0 in between
+    atomic_fetch_add_explicit(&pool->pending, 1, memory_order_relaxed);
+    if (!push(&pool->deques[worker], task)) {
+        atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_relaxed);
+        task->run(task, worker);
+    }
+}
@@ -0,0 +1,623 @@
+#include <text.h>
+#include <render.h>
+#include <pool.h>
+#include <profile.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+struct TextFont {
+    const char* name;
+    int cell_w, cell_h;
+    int first, count; // code points covered, the rest draw as fallback
+    int fallback;
+    const uint8_t* bitmap; // cell_h rows per glyph, bit 0 is the leftmost pixel
+};
+
+// public domain 8x8 bitmap font, printable ASCII
+static const uint8_t font_8x8[95][8] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00}, // !
+    {0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
+    {0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00}, // #
+    {0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00}, // $
+    {0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00}, // %
+    {0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00}, // &
+    {0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00}, // '
+    {0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00}, // (
+    {0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00}, // )
+    {0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00}, // *
+    {0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00}, // +
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06}, // ,
+    {0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00}, // .
+    {0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00}, // /
+    {0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00}, // 0
+    {0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00}, // 1
+    {0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00}, // 2
+    {0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00}, // 3
+    {0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00}, // 4
+    {0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00}, // 5
+    {0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00}, // 6
+    {0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00}, // 7
+    {0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00}, // 8
+    {0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00}, // 9
+    {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00}, // :
+    {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06}, // ;
+    {0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00}, // <
+    {0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00}, // =
+    {0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00}, // >
+    {0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00}, // ?
+    {0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00}, // @
+    {0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00}, // A
+    {0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00}, // B
+    {0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00}, // C
+    {0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00}, // D
+    {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00}, // E
+    {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00}, // F
+    {0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00}, // G
+    {0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00}, // H
+    {0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // I
+    {0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00}, // J
+    {0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00}, // K
+    {0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00}, // L
+    {0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00}, // M
+    {0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00}, // N
+    {0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00}, // O
+    {0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00}, // P
+    {0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00}, // Q
+    {0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00}, // R
+    {0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00}, // S
+    {0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // T
+    {0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00}, // U
+    {0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, // V
+    {0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00}, // W
+    {0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00}, // X
+    {0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00}, // Y
+    {0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00}, // Z
+    {0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00}, // [
+    {0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00}, // backslash
+    {0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00}, // ]
+    {0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00}, // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF}, // _
+    {0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00}, // `
+    {0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00}, // a
+    {0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00}, // b
+    {0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00}, // c
+    {0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00}, // d
+    {0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00}, // e
+    {0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00}, // f
+    {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F}, // g
+    {0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00}, // h
+    {0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // i
+    {0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E}, // j
+    {0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00}, // k
+    {0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // l
+    {0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00}, // m
+    {0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00}, // n
+    {0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00}, // o
+    {0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F}, // p
+    {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78}, // q
+    {0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00}, // r
+    {0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00}, // s
+    {0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00}, // t
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00}, // u
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, // v
+    {0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00}, // w
+    {0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00}, // x
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F}, // y
+    {0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00}, // z
+    {0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00}, // {
+    {0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00}, // |
+    {0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00}, // }
+    {0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ~
+};
+
+static struct TextFont default_font = {"fixed 8x8", 8, 8, ' ', 95, '?', &font_8x8[0][0]};
+
+// a glyph rasterized at one size, blank glyphs take no atlas space
+struct Glyph {
+    TextFont font;
+    int size, code;
+    int u, v, w, h; // atlas texels, v is the bottom row
+    struct Shelf* shelf; // NULL when blank
+    struct Glyph* next; // hash bucket
+    struct Glyph* shelf_next;
+};
+
+// a band of the atlas holding glyphs of about the same height, evicted as a
+// whole; shelves are kept in y order so neighbours can be merged
+struct Shelf {
+    struct Shelf* below;
+    struct Shelf* above;
+    int y, height;
+    int x; // first free texel
+    unsigned long last_used;
+    struct Glyph* glyphs;
+};
+
+struct ShapedGlyph {
+    int code;
+    int x; // pen offset from the start of the run
+    struct Glyph* glyph; // valid while the run generation matches the atlas
+};
+
+struct ShapedRun {
+    struct ShapedRun* next; // hash bucket
+    struct ShapedRun* newer;
+    struct ShapedRun* older;
+    TextFont font;
+    int size;
+    uint64_t hash;
+    unsigned generation;
+    int width;
+    int count;
+    struct ShapedGlyph* glyphs;
+    char* text;
+};
+
+// row 0 is the bottom, texel (0, 0) stays covered for backends drawing rects through the atlas
+static uint8_t* atlas = NULL;
+static struct Shelf* lowest_shelf = NULL;
+static struct Shelf* highest_shelf = NULL;
+static int next_shelf_y = 1; // everything above is free
+static unsigned atlas_generation = 1; // bumped whenever cached glyphs are dropped
+static unsigned long use_clock = 0;
+
+static bool pools_ready = false;
+static struct Pool glyph_pool;
+static struct Pool shelf_pool;
+static struct Glyph* glyph_buckets[TEXT_GLYPH_BUCKETS];
+
+static struct ShapedRun* shape_buckets[TEXT_SHAPE_BUCKETS];
+static struct ShapedRun* newest_run = NULL;
+static struct ShapedRun* oldest_run = NULL;
+
+static struct TextStats stats;
+static bool warned_too_large = false;
+
+TextFont text_default_font(void) {
+    return &default_font;
+}
+
+static int glyph_width(TextFont font, int size) {
+    return MAX((size * font->cell_w + font->cell_h / 2) / font->cell_h, 1);
+}
+
+int text_line_height(TextFont font, int size) {
+    (void) font;
+    return size;
+}
+
+static unsigned glyph_hash(TextFont font, int size, int code) {
+    uintptr_t f = (uintptr_t) font >> 4;
+    return ((unsigned) code * 2654435761u ^ (unsigned) size * 40503u ^ (unsigned) f) % TEXT_GLYPH_BUCKETS;
+}
+
+static void unlink_glyph(struct Glyph* glyph) {
+    struct Glyph** link = &glyph_buckets[glyph_hash(glyph->font, glyph->size, glyph->code)];
+    while (*link != glyph)
+        link = &(*link)->next;
+    *link = glyph->next;
+    pool_free(&glyph_pool, glyph);
+    stats.glyphs_cached--;
+}
+
+static void clear_glyphs(void) {
+    for (int i = 0; i < TEXT_GLYPH_BUCKETS; i++) {
+        while (glyph_buckets[i]) {
+            struct Glyph* next = glyph_buckets[i]->next;
+            pool_free(&glyph_pool, glyph_buckets[i]);
+            glyph_buckets[i] = next;
+        }
+    }
+    stats.glyphs_cached = 0;
+}
+
+static bool create_atlas(void) {
+    atlas = calloc((size_t) TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE, 1);
+    if (!atlas) {
+        printf("[TEXT][ERROR] out of memory while creating the glyph atlas\n");
+        return false;
+    }
+    if (!pools_ready) {
+        pool_init(&glyph_pool, sizeof(struct Glyph));
+        pool_init(&shelf_pool, sizeof(struct Shelf));
+        pools_ready = true;
+    }
+    atlas[0] = 0xff;
+    render_set_atlas(atlas, TEXT_ATLAS_SIZE, TEXT_ATLAS_SIZE);
+    return true;
+}
+
+static void clear_shelves(void) {
+    while (lowest_shelf) {
+        struct Shelf* above = lowest_shelf->above;
+        pool_free(&shelf_pool, lowest_shelf);
+        lowest_shelf = above;
+    }
+    highest_shelf = NULL;
+    next_shelf_y = 1;
+}
+
+// queued glyphs still sample the old texels, so they are drawn before any gets reused
+static void reset_atlas(void) {
+    render_flush();
+    clear_glyphs();
+    clear_shelves();
+    memset(atlas, 0, (size_t) TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE);
+    atlas[0] = 0xff;
+    atlas_generation++;
+    stats.atlas_resets++;
+    render_atlas_changed(0, 0, TEXT_ATLAS_SIZE, TEXT_ATLAS_SIZE);
+}
+
+static struct Shelf* insert_shelf(struct Shelf* below, int y, int height) {
+    struct Shelf* shelf = pool_alloc(&shelf_pool);
+    *shelf = (struct Shelf) {below, below ? below->above : lowest_shelf, y, height, 0, 0, NULL};
+    if (shelf->above)
+        shelf->above->below = shelf;
+    else
+        highest_shelf = shelf;
+    if (below)
+        below->above = shelf;
+    else
+        lowest_shelf = shelf;
+    return shelf;
+}
+
+static void remove_shelf(struct Shelf* shelf) {
+    if (shelf->below)
+        shelf->below->above = shelf->above;
+    else
+        lowest_shelf = shelf->above;
+    if (shelf->above)
+        shelf->above->below = shelf->below;
+    else
+        highest_shelf = shelf->below;
+    pool_free(&shelf_pool, shelf);
+}
+
+static bool fits_height(const struct Shelf* shelf, int h) {
+    return shelf->height >= h && shelf->height <= h + h / 4 + 1;
+}
+
+// an empty shelf gives what a glyph of height h does not need back, to the
+// free space on top or as an empty shelf of its own
+static void trim_shelf(struct Shelf* shelf, int h) {
+    if (shelf == highest_shelf)
+        next_shelf_y = shelf->y + h;
+    else if (!fits_height(shelf, h))
+        insert_shelf(shelf, shelf->y + h, shelf->height - h);
+    else
+        return;
+    shelf->height = h;
+}
+
+static void empty_shelf(struct Shelf* shelf) {
+    while (shelf->glyphs) {
+        struct Glyph* next = shelf->glyphs->shelf_next;
+        unlink_glyph(shelf->glyphs);
+        shelf->glyphs = next;
+    }
+    shelf->x = 0;
+    stats.shelf_evictions++;
+}
+
+// the neighbouring shelves starting at first that add up to h, with the free space on top
+static int run_height(const struct Shelf* first, int h, unsigned long* last_used) {
+    int height = 0;
+    *last_used = 0;
+    for (const struct Shelf* shelf = first; shelf && height < h; shelf = shelf->above) {
+        height += shelf->height;
+        *last_used = MAX(*last_used, shelf->last_used);
+        if (shelf == highest_shelf)
+            height += TEXT_ATLAS_SIZE - next_shelf_y;
+    }
+    return height;
+}
+
+/*
+ * Makes room for a glyph of height h by emptying the least recently used run
+ * of neighbouring shelves that is tall enough and merging it into one shelf.
+ */
+static struct Shelf* evict_shelves(int h) {
+    struct Shelf* victim = NULL;
+    unsigned long victim_used = 0;
+    int victim_height = 0;
+    for (struct Shelf* first = lowest_shelf; first; first = first->above) {
+        unsigned long last_used;
+        int height = run_height(first, h, &last_used);
+        if (height < h)
+            break;
+        if (!victim || last_used < victim_used || (last_used == victim_used && height < victim_height)) {
+            victim = first;
+            victim_used = last_used;
+            victim_height = height;
+        }
+    }
+    if (!victim)
+        return NULL;
+    render_flush();
+    empty_shelf(victim);
+    while (victim->height < h && victim != highest_shelf) {
+        empty_shelf(victim->above);
+        victim->height += victim->above->height;
+        remove_shelf(victim->above);
+    }
+    trim_shelf(victim, h);
+    atlas_generation++;
+    return victim;
+}
+
+/*
+ * Best fitting shelf with room left, where empty shelves fit any shorter
+ * glyph, then a new shelf on top of the others, then evicted shelves. Only
+ * when the shelves can not be merged into enough room does the whole atlas
+ * start over.
+ */
+static struct Shelf* find_shelf(int w, int h) {
+    struct Shelf* best = NULL;
+    for (struct Shelf* shelf = lowest_shelf; shelf; shelf = shelf->above) {
+        if (shelf->x + w > TEXT_ATLAS_SIZE || shelf->height < h || (shelf->glyphs && !fits_height(shelf, h)))
+            continue;
+        if (!best || shelf->height < best->height)
+            best = shelf;
+    }
+    if (best) {
+        if (!best->glyphs)
+            trim_shelf(best, h);
+        return best;
+    }
+    if (next_shelf_y + h <= TEXT_ATLAS_SIZE) {
+        best = insert_shelf(highest_shelf, next_shelf_y, h);
+        next_shelf_y += h;
+        return best;
+    }
+    if ((best = evict_shelves(h)))
+        return best;
+    reset_atlas();
+    return find_shelf(w, h);
+}
+
+// area coverage of the scaled cell, exact in integers: an output texel spans
+// cell_w x cell_h units and a source pixel w x h units
+static void rasterize(const struct Glyph* glyph) {
+    TextFont font = glyph->font;
+    int index = glyph->code - font->first;
+    const uint8_t* rows = font->bitmap + index * font->cell_h;
+    int area = font->cell_w * font->cell_h;
+    for (int oy = 0; oy < glyph->h; oy++) {
+        uint8_t* out = atlas + (size_t) (glyph->v + glyph->h - 1 - oy) * TEXT_ATLAS_SIZE + glyph->u;
+        int y0 = oy * font->cell_h, y1 = y0 + font->cell_h;
+        for (int ox = 0; ox < glyph->w; ox++) {
+            int x0 = ox * font->cell_w, x1 = x0 + font->cell_w;
+            int covered = 0;
+            for (int sy = y0 / glyph->h; sy * glyph->h < y1 && sy < font->cell_h; sy++) {
+                int overlap_y = MIN(y1, (sy + 1) * glyph->h) - MAX(y0, sy * glyph->h);
+                for (int sx = x0 / glyph->w; sx * glyph->w < x1 && sx < font->cell_w; sx++)
+                    if (rows[sy] >> sx & 1)
+                        covered += overlap_y * (MIN(x1, (sx + 1) * glyph->w) - MAX(x0, sx * glyph->w));
+            }
+            out[ox] = (covered * 255 + area / 2) / area;
+        }
+    }
+}
+
+static bool is_blank(TextFont font, int code) {
+    const uint8_t* rows = font->bitmap + (code - font->first) * font->cell_h;
+    for (int i = 0; i < font->cell_h; i++)
+        if (rows[i])
+            return false;
+    return true;
+}
+
+static struct Glyph* find_glyph(TextFont font, int size, int code) {
+    struct Glyph** bucket = &glyph_buckets[glyph_hash(font, size, code)];
+    for (struct Glyph* glyph = *bucket; glyph; glyph = glyph->next) {
+        if (glyph->code == code && glyph->size == size && glyph->font == font) {
+            stats.glyph_hits++;
+            return glyph;
+        }
+    }
+    stats.glyph_misses++;
+    int w = glyph_width(font, size), h = size;
+    if (w > TEXT_ATLAS_SIZE || h >= TEXT_ATLAS_SIZE) {
+        if (!warned_too_large)
+            printf("[TEXT][WARNING] glyphs of size %d do not fit the atlas\n", size);
+        warned_too_large = true;
+        return NULL;
+    }
+    struct Shelf* shelf = NULL;
+    if (!is_blank(font, code) && !(shelf = find_shelf(w, h)))
+        return NULL;
+    struct Glyph* glyph = pool_alloc(&glyph_pool);
+    *glyph = (struct Glyph) {font, size, code, 0, 0, w, h, shelf, NULL, NULL};
+    if (shelf) {
+        glyph->u = shelf->x;
+        glyph->v = shelf->y;
+        glyph->shelf_next = shelf->glyphs;
+        shelf->glyphs = glyph;
+        shelf->x += w;
+        rasterize(glyph);
+        render_atlas_changed(glyph->u, glyph->v, w, h);
+    }
+    // the shelf search may have emptied this bucket
+    bucket = &glyph_buckets[glyph_hash(font, size, code)];
+    glyph->next = *bucket;
+    *bucket = glyph;
+    stats.glyphs_cached++;
+    return glyph;
+}
+
+static uint64_t run_hash(TextFont font, int size, const char* text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char* c = (const unsigned char*) text; *c; c++)
+        hash = (hash ^ *c) * 1099511628211ull;
+    hash = (hash ^ (unsigned) size) * 1099511628211ull;
+    return (hash ^ (uintptr_t) font) * 1099511628211ull;
+}
+
+// one code point, malformed sequences come out as -1 and skip a single byte
+static int next_code(const unsigned char** text) {
+    const unsigned char* c = *text;
+    int length = c[0] < 0x80 ? 1 : (c[0] & 0xe0) == 0xc0 ? 2 : (c[0] & 0xf0) == 0xe0 ? 3 :
+                 (c[0] & 0xf8) == 0xf0 ? 4 : 0;
+    if (!length) {
+        *text = c + 1;
+        return -1;
+    }
+    int code = length == 1 ? c[0] : c[0] & (0x7f >> length);
+    for (int i = 1; i < length; i++) {
+        if ((c[i] & 0xc0) != 0x80) {
+            *text = c + 1;
+            return -1;
+        }
+        code = code << 6 | (c[i] & 0x3f);
+    }
+    *text = c + length;
+    return code;
+}
+
+static void unlink_run(struct ShapedRun* run) {
+    if (run->newer)
+        run->newer->older = run->older;
+    else
+        newest_run = run->older;
+    if (run->older)
+        run->older->newer = run->newer;
+    else
+        oldest_run = run->newer;
+}
+
+static void push_run(struct ShapedRun* run) {
+    run->newer = NULL;
+    run->older = newest_run;
+    if (newest_run)
+        newest_run->newer = run;
+    newest_run = run;
+    if (!oldest_run)
+        oldest_run = run;
+}
+
+static void drop_run(struct ShapedRun* run) {
+    struct ShapedRun** link = &shape_buckets[run->hash % TEXT_SHAPE_BUCKETS];
+    while (*link != run)
+        link = &(*link)->next;
+    *link = run->next;
+    unlink_run(run);
+    free(run);
+    stats.shapes_cached--;
+}
+
+static struct ShapedRun* shape(TextFont font, int size, const char* text) {
+    uint64_t hash = run_hash(font, size, text);
+    struct ShapedRun** bucket = &shape_buckets[hash % TEXT_SHAPE_BUCKETS];
+    for (struct ShapedRun* run = *bucket; run; run = run->next) {
+        if (run->hash == hash && run->size == size && run->font == font && strcmp(run->text, text) == 0) {
+            stats.shape_hits++;
+            unlink_run(run);
+            push_run(run);
+            return run;
+        }
+    }
+    stats.shape_misses++;
+    // one glyph per byte at most, the text is kept behind them
+    size_t length = strlen(text);
+    struct ShapedRun* run = malloc(sizeof(struct ShapedRun) + sizeof(struct ShapedGlyph) * length + length + 1);
+    if (!run) {
+        printf("[TEXT][ERROR] out of memory while shaping text\n");
+        return NULL;
+    }
+    run->font = font;
+    run->size = size;
+    run->hash = hash;
+    run->generation = 0;
+    run->glyphs = (struct ShapedGlyph*) (run + 1);
+    run->text = (char*) (run->glyphs + length);
+    memcpy(run->text, text, length + 1);
+    int advance = glyph_width(font, size);
+    int pen = 0, count = 0;
+    const unsigned char* c = (const unsigned char*) text;
+    while (*c) {
+        int code = next_code(&c);
+        if (code < font->first || code >= font->first + font->count)
+            code = font->fallback;
+        run->glyphs[count++] = (struct ShapedGlyph) {code, pen, NULL};
+        pen += advance;
+    }
+    run->count = count;
+    run->width = pen;
+    run->next = *bucket;
+    *bucket = run;
+    push_run(run);
+    if (++stats.shapes_cached > TEXT_SHAPE_CACHE_MAX)
+        drop_run(oldest_run);
+    return run;
+}
+
+int text_width(TextFont font, int size, const char* text) {
+    if (!text || !*text || size <= 0)
+        return 0;
+    struct ShapedRun* run = shape(font, size, text);
+    return run ? run->width : 0;
+}
+
+void text_draw(TextFont font, int size, int x, int y, const char* text, color32 color) {
+    if (!text || !*text || size <= 0 || color.a == 0 || !render_supports_text())
+        return;
+    if (!atlas && !create_atlas())
+        return;
+    PROFILE_SCOPE("text_draw");
+    struct ShapedRun* run = shape(font, size, text);
+    if (!run)
+        return;
+    use_clock++;
+    // a run drawn since the last eviction still points at its glyphs
+    unsigned generation = atlas_generation;
+    bool resolved = run->generation == generation;
+    for (int i = 0; i < run->count; i++) {
+        struct ShapedGlyph* shaped = &run->glyphs[i];
+        struct Glyph* glyph;
+        if (resolved) {
+            glyph = shaped->glyph;
+            stats.glyph_hits++;
+        }
+        else
+            glyph = shaped->glyph = find_glyph(font, size, shaped->code);
+        if (!glyph || !glyph->shelf)
+            continue;
+        glyph->shelf->last_used = use_clock;
+        render_glyph(x + shaped->x, y, glyph->w, glyph->h, glyph->u, glyph->v, color);
+    }
+    run->generation = atlas_generation == generation ? generation : 0;
+}
+
+void text_stats(struct TextStats* out) {
+    *out = stats;
+}
+
+void text_reset_stats(void) {
+    stats.glyph_hits = stats.glyph_misses = 0;
+    stats.shape_hits = stats.shape_misses = 0;
+    stats.shelf_evictions = stats.atlas_resets = 0;
+}
+
+void text_release(void) {
+    while (oldest_run)
+        drop_run(oldest_run);
+    if (pools_ready) {
+        clear_glyphs();
+        clear_shelves();
+        pool_release(&glyph_pool);
+        pool_release(&shelf_pool);
+        pools_ready = false;
+    }
+    free(atlas);
+    atlas = NULL;
+    atlas_generation++;
+    warned_too_large = false;
+    memset(&stats, 0, sizeof(stats));
+    render_set_atlas(NULL, 0, 0);
+}
@@ -0,0 +1,545 @@
+#include <text_buffer.h>
+#include <pool.h>
+#include <types.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TEXT_BUFFER_ADD_INITIAL 4096
+#define TEXT_BUFFER_GUESS_LINE 64 // bytes per line assumed before anything is counted
+#define NOT_FOUND SIZE_MAX
+
+// a run of bytes from the file or from the add buffer, as a treap node in document order
+struct TextPiece {
+    struct TextPiece* left;
+    struct TextPiece* right;
+    uint32_t priority;
+    bool added;
+    size_t start, length;
+    long newlines; // -1 until counted
+    // totals of the subtree
+    size_t total_length;
+    size_t total_newlines; // of the counted pieces
+    size_t uncounted; // bytes in pieces not counted yet
+};
+
+struct TextBuffer {
+    struct TextPiece* root;
+    struct Pool pieces;
+    size_t piece_count;
+    const char* original; // the mapping, never written
+    size_t original_length;
+    char* added; // append only, pieces refer to it by offset
+    size_t added_length;
+    size_t added_capacity;
+    uint32_t seed;
+    unsigned long version;
+    TextBufferListener listener;
+};
+
+static const char* piece_data(struct TextBuffer* buffer, const struct TextPiece* piece) {
+    return (piece->added ? buffer->added : buffer->original) + piece->start;
+}
+
+static size_t count_newlines(const char* data, size_t length) {
+    size_t count = 0;
+    const char* end = data + length;
+    while ((data = memchr(data, '\n', end - data))) {
+        count++;
+        data++;
+    }
+    return count;
+}
+
+// position of the nth newline, counting from 1
+static size_t nth_newline(const char* data, size_t length, size_t n) {
+    const char* at = data;
+    const char* end = data + length;
+    while ((at = memchr(at, '\n', end - at)) && --n)
+        at++;
+    return at - data;
+}
+
+static size_t total_length(const struct TextPiece* piece) {
+    return piece ? piece->total_length : 0;
+}
+
+static size_t total_newlines(const struct TextPiece* piece) {
+    return piece ? piece->total_newlines : 0;
+}
+
+static size_t uncounted(const struct TextPiece* piece) {
+    return piece ? piece->uncounted : 0;
+}
+
+static void update(struct TextPiece* piece) {
+    piece->total_length = total_length(piece->left) + piece->length + total_length(piece->right);
+    piece->total_newlines = total_newlines(piece->left) + total_newlines(piece->right) +
+                            (piece->newlines < 0 ? 0 : piece->newlines);
+    piece->uncounted = uncounted(piece->left) + uncounted(piece->right) +
+                       (piece->newlines < 0 ? piece->length : 0);
+}
+
+static struct TextPiece* new_piece(struct TextBuffer* buffer, bool added, size_t start,
+                                   size_t length, long newlines) {
+    struct TextPiece* piece = pool_alloc(&buffer->pieces);
+    if (!piece)
+        return NULL;
+    // xorshift, the treap only needs the priorities to look random
+    buffer->seed ^= buffer->seed << 13;
+    buffer->seed ^= buffer->seed >> 17;
+    buffer->seed ^= buffer->seed << 5;
+    *piece = (struct TextPiece) {NULL, NULL, buffer->seed, added, start, length, newlines, 0, 0, 0};
+    update(piece);
+    buffer->piece_count++;
+    return piece;
+}
+
+static void free_pieces(struct TextBuffer* buffer, struct TextPiece* piece) {
+    if (!piece)
+        return;
+    free_pieces(buffer, piece->left);
+    free_pieces(buffer, piece->right);
+    pool_free(&buffer->pieces, piece);
+    buffer->piece_count--;
+}
+
+static void count_piece(struct TextBuffer* buffer, struct TextPiece* piece) {
+    if (piece->newlines < 0)
+        piece->newlines = count_newlines(piece_data(buffer, piece), piece->length);
+}
+
+static void count_subtree(struct TextBuffer* buffer, struct TextPiece* piece) {
+    if (!piece || !piece->uncounted)
+        return;
+    count_subtree(buffer, piece->left);
+    count_piece(buffer, piece);
+    count_subtree(buffer, piece->right);
+    update(piece);
+}
+
+static struct TextPiece* merge(struct TextPiece* a, struct TextPiece* b) {
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+    if (a->priority > b->priority) {
+        a->right = merge(a->right, b);
+        update(a);
+        return a;
+    }
+    b->left = merge(a, b->left);
+    update(b);
+    return b;
+}
+
+/*
+ * Splits the subtree at a document offset, cutting the piece it falls into in
+ * two. The tail keeps the priority of the piece so both halves stay treaps.
+ */
+static bool split(struct TextBuffer* buffer, struct TextPiece* piece, size_t offset,
+                  struct TextPiece** left, struct TextPiece** right) {
+    if (!piece) {
+        *left = *right = NULL;
+        return true;
+    }
+    size_t before = total_length(piece->left);
+    bool ok = true;
+    if (offset <= before) {
+        ok = split(buffer, piece->left, offset, left, &piece->left);
+        *right = piece;
+    }
+    else if (offset >= before + piece->length) {
+        ok = split(buffer, piece->right, offset - before - piece->length, &piece->right, right);
+        *left = piece;
+    }
+    else {
+        size_t cut = offset - before;
+        struct TextPiece* tail = new_piece(buffer, piece->added, piece->start + cut, piece->length - cut, -1);
+        if (!tail) {
+            *left = piece;
+            *right = NULL;
+            return false;
+        }
+        // only the shorter half is scanned, the other one is the difference
+        if (piece->newlines >= 0 && cut < tail->length) {
+            long head = count_newlines(piece_data(buffer, piece), cut);
+            tail->newlines = piece->newlines - head;
+            piece->newlines = head;
+        }
+        else if (piece->newlines >= 0) {
+            tail->newlines = count_newlines(piece_data(buffer, tail), tail->length);
+            piece->newlines -= tail->newlines;
+        }
+        tail->priority = piece->priority;
+        tail->right = piece->right;
+        piece->right = NULL;
+        piece->length = cut;
+        update(tail);
+        *left = piece;
+        *right = tail;
+    }
+    update(piece);
+    return ok;
+}
+
+static bool reserve_added(struct TextBuffer* buffer, size_t length) {
+    if (buffer->added_length + length <= buffer->added_capacity)
+        return true;
+    size_t capacity = buffer->added_capacity ? buffer->added_capacity : TEXT_BUFFER_ADD_INITIAL;
+    while (capacity < buffer->added_length + length)
+        capacity *= 2;
+    char* grown = realloc(buffer->added, capacity);
+    if (!grown) {
+        printf("[TEXT_BUFFER][ERROR] out of memory while growing the add buffer\n");
+        return false;
+    }
+    buffer->added = grown;
+    buffer->added_capacity = capacity;
+    return true;
+}
+
+static struct TextBuffer* new_buffer(void) {
+    struct TextBuffer* buffer = calloc(1, sizeof(struct TextBuffer));
+    if (!buffer) {
+        printf("[TEXT_BUFFER][ERROR] out of memory while creating a buffer\n");
+        return NULL;
+    }
+    pool_init(&buffer->pieces, sizeof(struct TextPiece));
+    buffer->seed = 0x9e3779b9;
+    return buffer;
+}
+
+// text already in place as one piece per chunk, appended in order
+static bool append_chunks(struct TextBuffer* buffer, bool added, size_t start, size_t length, bool count) {
+    for (size_t at = 0; at < length; at += TEXT_BUFFER_CHUNK) {
+        size_t chunk = MIN(length - at, (size_t) TEXT_BUFFER_CHUNK);
+        struct TextPiece* piece = new_piece(buffer, added, start + at, chunk, -1);
+        if (!piece)
+            return false;
+        if (count)
+            count_piece(buffer, piece);
+        update(piece);
+        buffer->root = merge(buffer->root, piece);
+    }
+    return true;
+}
+
+TextBuffer text_buffer_create(const char* text, size_t length) {
+    struct TextBuffer* buffer = new_buffer();
+    if (!buffer)
+        return NULL;
+    if (length && !reserve_added(buffer, length)) {
+        text_buffer_close(buffer);
+        return NULL;
+    }
+    if (length)
+        memcpy(buffer->added, text, length);
+    buffer->added_length = length;
+    if (!append_chunks(buffer, true, 0, length, true)) {
+        text_buffer_close(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+// the file is mapped, not read, so opening costs the same for any size
+TextBuffer text_buffer_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("[TEXT_BUFFER][ERROR] unable to open \"%s\"\n", path);
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        printf("[TEXT_BUFFER][ERROR] \"%s\" is not a regular file\n", path);
+        close(fd);
+        return NULL;
+    }
+    struct TextBuffer* buffer = new_buffer();
+    if (!buffer) {
+        close(fd);
+        return NULL;
+    }
+    if (info.st_size > 0) {
+        void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            printf("[TEXT_BUFFER][ERROR] unable to map \"%s\"\n", path);
+            close(fd);
+            text_buffer_close(buffer);
+            return NULL;
+        }
+        buffer->original = mapping;
+        buffer->original_length = info.st_size;
+    }
+    close(fd);
+    if (!append_chunks(buffer, false, 0, buffer->original_length, false)) {
+        text_buffer_close(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+void text_buffer_close(TextBuffer buffer) {
+    if (!buffer)
+        return;
+    if (buffer->original)
+        munmap((void*) buffer->original, buffer->original_length);
+    free(buffer->added);
+    pool_release(&buffer->pieces);
+    free(buffer);
+}
+
+static bool write_pieces(struct TextBuffer* buffer, struct TextPiece* piece, FILE* file) {
+    if (!piece)
+        return true;
+    return write_pieces(buffer, piece->left, file) &&
+           fwrite(piece_data(buffer, piece), 1, piece->length, file) == piece->length &&
+           write_pieces(buffer, piece->right, file);
+}
+
+// written next to the target and renamed over it, the mapping may be of that very file
+bool text_buffer_save(TextBuffer buffer, const char* path) {
+    size_t length = strlen(path);
+    char* temporary = malloc(length + 5);
+    if (!temporary) {
+        printf("[TEXT_BUFFER][ERROR] out of memory while saving \"%s\"\n", path);
+        return false;
+    }
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", 5);
+    FILE* file = fopen(temporary, "wb");
+    if (!file) {
+        printf("[TEXT_BUFFER][ERROR] unable to open \"%s\" for writing\n", temporary);
+        free(temporary);
+        return false;
+    }
+    bool ok = write_pieces(buffer, buffer->root, file);
+    if (fclose(file) != 0)
+        ok = false;
+    if (ok && rename(temporary, path) != 0)
+        ok = false;
+    if (!ok) {
+        printf("[TEXT_BUFFER][ERROR] failed to write \"%s\"\n", path);
+        remove(temporary);
+    }
+    free(temporary);
+    return ok;
+}
+
+size_t text_buffer_length(TextBuffer buffer) {
+    return total_length(buffer->root);
+}
+
+unsigned long text_buffer_version(TextBuffer buffer) {
+    return buffer->version;
+}
+
+static size_t newlines_before(struct TextBuffer* buffer, struct TextPiece* piece, size_t offset);
+
+// typing extends the piece it just added instead of adding one per keystroke
+static bool extend_last(struct TextPiece* piece, size_t start, size_t length, size_t newlines) {
+    if (!piece)
+        return false;
+    bool extended;
+    if (piece->right)
+        extended = extend_last(piece->right, start, length, newlines);
+    else if ((extended = piece->added && piece->newlines >= 0 && piece->start + piece->length == start)) {
+        piece->length += length;
+        piece->newlines += newlines;
+    }
+    if (extended)
+        update(piece);
+    return extended;
+}
+
+bool text_buffer_insert(TextBuffer buffer, size_t offset, const char* text, size_t length) {
+    if (offset > text_buffer_length(buffer))
+        return false;
+    if (!length)
+        return true;
+    if (!reserve_added(buffer, length))
+        return false;
+    size_t start = buffer->added_length;
+    memcpy(buffer->added + start, text, length);
+    buffer->added_length += length;
+    size_t newlines = count_newlines(text, length);
+    // the line is only looked up for a listener, it may count a chunk
+    size_t line = buffer->listener.on_edit ? newlines_before(buffer, buffer->root, offset) : 0;
+    struct TextPiece *left, *right;
+    bool ok = split(buffer, buffer->root, offset, &left, &right);
+    if (ok && !extend_last(left, start, length, newlines)) {
+        struct TextPiece* piece = new_piece(buffer, true, start, length, newlines);
+        if (piece)
+            left = merge(left, piece);
+        ok = piece != NULL;
+    }
+    buffer->root = merge(left, right);
+    buffer->version++;
+    if (!ok)
+        printf("[TEXT_BUFFER][ERROR] out of memory while inserting text\n");
+    else if (buffer->listener.on_edit)
+        buffer->listener.on_edit(buffer->listener.user_data, line, 0, newlines);
+    return ok;
+}
+
+bool text_buffer_delete(TextBuffer buffer, size_t offset, size_t length) {
+    size_t total = text_buffer_length(buffer);
+    if (offset > total)
+        return false;
+    length = MIN(length, total - offset);
+    if (!length)
+        return true;
+    size_t line = buffer->listener.on_edit ? newlines_before(buffer, buffer->root, offset) : 0;
+    struct TextPiece *left, *middle, *right;
+    bool ok = split(buffer, buffer->root, offset, &left, &right);
+    ok = split(buffer, right, length, &middle, &right) && ok;
+    size_t removed = 0;
+    if (ok && buffer->listener.on_edit) {
+        count_subtree(buffer, middle);
+        removed = total_newlines(middle);
+    }
+    if (ok)
+        free_pieces(buffer, middle);
+    else
+        right = merge(middle, right);
+    buffer->root = merge(left, right);
+    buffer->version++;
+    if (!ok)
+        printf("[TEXT_BUFFER][ERROR] out of memory while deleting text\n");
+    else if (buffer->listener.on_edit)
+        buffer->listener.on_edit(buffer->listener.user_data, line, removed, 0);
+    return ok;
+}
+
+static size_t copy_range(struct TextBuffer* buffer, struct TextPiece* piece, size_t offset,
+                         size_t length, char* out) {
+    size_t copied = 0;
+    while (piece && length) {
+        size_t before = total_length(piece->left);
+        if (offset < before) {
+            size_t n = copy_range(buffer, piece->left, offset, length, out);
+            copied += n;
+            out += n;
+            length -= n;
+            offset = before;
+        }
+        if (length && offset < before + piece->length) {
+            size_t n = MIN(before + piece->length - offset, length);
+            memcpy(out, piece_data(buffer, piece) + offset - before, n);
+            copied += n;
+            out += n;
+            length -= n;
+            offset += n;
+        }
+        offset -= before + piece->length;
+        piece = piece->right;
+    }
+    return copied;
+}
+
+size_t text_buffer_read(TextBuffer buffer, size_t offset, char* out, size_t length) {
+    if (offset >= text_buffer_length(buffer))
+        return 0;
+    return copy_range(buffer, buffer->root, offset, length, out);
+}
+
+/*
+ * Offset just past the skip-th newline of the subtree. Subtrees that are
+ * fully counted and too short are stepped over by their totals, the rest is
+ * counted piece by piece on the way, so only the text before the line is
+ * ever scanned.
+ */
+static size_t find_newline(struct TextBuffer* buffer, struct TextPiece* piece, size_t* skip) {
+    if (!piece)
+        return NOT_FOUND;
+    if (!piece->uncounted && piece->total_newlines < *skip) {
+        *skip -= piece->total_newlines;
+        return NOT_FOUND;
+    }
+    size_t before = total_length(piece->left);
+    size_t found = find_newline(buffer, piece->left, skip);
+    if (found == NOT_FOUND) {
+        count_piece(buffer, piece);
+        if ((size_t) piece->newlines >= *skip)
+            found = before + nth_newline(piece_data(buffer, piece), piece->length, *skip) + 1;
+        else {
+            *skip -= piece->newlines;
+            found = find_newline(buffer, piece->right, skip);
+            if (found != NOT_FOUND)
+                found += before + piece->length;
+        }
+    }
+    update(piece);
+    return found;
+}
+
+bool text_buffer_line_start(TextBuffer buffer, size_t line, size_t* offset) {
+    if (!line) {
+        *offset = 0;
+        return true;
+    }
+    size_t skip = line;
+    size_t found = find_newline(buffer, buffer->root, &skip);
+    if (found == NOT_FOUND)
+        return false;
+    *offset = found;
+    return true;
+}
+
+static size_t newlines_before(struct TextBuffer* buffer, struct TextPiece* piece, size_t offset) {
+    if (!piece)
+        return 0;
+    size_t before = total_length(piece->left);
+    size_t count;
+    if (offset <= before)
+        count = newlines_before(buffer, piece->left, offset);
+    else {
+        count_subtree(buffer, piece->left);
+        count = total_newlines(piece->left);
+        if (offset >= before + piece->length) {
+            count_piece(buffer, piece);
+            count += piece->newlines + newlines_before(buffer, piece->right, offset - before - piece->length);
+        }
+        else
+            count += count_newlines(piece_data(buffer, piece), offset - before);
+    }
+    update(piece);
+    return count;
+}
+
+size_t text_buffer_line_of(TextBuffer buffer, size_t offset) {
+    return newlines_before(buffer, buffer->root, offset);
+}
+
+size_t text_buffer_line_count(TextBuffer buffer, bool* exact) {
+    struct TextPiece* root = buffer->root;
+    if (exact)
+        *exact = !uncounted(root);
+    if (!uncounted(root))
+        return total_newlines(root) + 1;
+    size_t counted = total_length(root) - root->uncounted;
+    double per_byte = counted ? (double) root->total_newlines / counted : 1.0 / TEXT_BUFFER_GUESS_LINE;
+    return root->total_newlines + (size_t) (root->uncounted * per_byte) + 1;
+}
+
+size_t text_buffer_count_lines(TextBuffer buffer) {
+    count_subtree(buffer, buffer->root);
+    return total_newlines(buffer->root) + 1;
+}
+
+void text_buffer_memory(TextBuffer buffer, size_t* pieces, size_t* added_bytes) {
+    if (pieces)
+        *pieces = buffer->piece_count;
+    if (added_bytes)
+        *added_bytes = buffer->added_length;
+}
+
+void text_buffer_set_listener(TextBuffer buffer, TextBufferListener listener) {
+    buffer->listener = listener;
+}
@@ -1,21 +1,145 @@
 #include <ui.h>
+#include <render.h>
+#include <pool.h>
+#include <layout_store.h>
+#include <profile.h>
+#include <text.h>
+#include <text_buffer.h>
+#include <highlight.h>
+#include <task_pool.h>
 #include <stdlib.h>
-#include <GL/gl.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <limits.h>
 #include <assert.h>
 #include <string.h>
 
-#if defined(_MSC_VER)
-#define strtok_r strtok_s
-#endif
-
 
 #define GET_EXTENTION_DATA(ui_element, t) ({assert(ui_element->type == t); get_extention_data(ui_element);})
 
-int window_width;
-int window_height;
+struct UIDamage {
+    UIRect rects[UI_MAX_DAMAGE_RECTS];
+    int count;
+};
+
+static struct UIDamage damage_current;
+static struct UIDamage damage_previous;
+
+static bool draw_clip_active = false;
+static UIRect draw_clip;
+
+// CPU copy of the scissor box, GL is only told when the effective rect changes
+static bool scissor_known = false;
+static UIRect scissor_box;
+
+static int layout_counter = 0;
+
+// every window a tree was laid out for, what a change to a shared style repaints
+static int screen_w = 0, screen_h = 0;
+
+// the window a tree is laid out for, passed down instead of kept in globals so
+// that trees for different windows never interfere
+struct UILayoutContext {
+    int window_w, window_h;
+};
+
+// trees this big are split over the layout pool, subtrees below the grain stay on one worker
+#define UI_PARALLEL_LAYOUT_MIN 16384
+#define UI_PARALLEL_LAYOUT_GRAIN 2048
+
+static TaskPool layout_pool = NULL;
+static int layout_threads = 0; // 0 for one per core
+
+#define UI_HIT_MIN_CELL 4 // pixels, the finest level is never smaller
+#define UI_HIT_SPAN 2 // cells an element covers at most along each axis of its level
+#define UI_HIT_LEVELS 24
+#define UI_HIT_SLACK 4 // a cell is built with room for a quarter more keys
+#define UI_HIT_MIN_MOVES 256 // moves a grid takes in place even in a small tree
+
+// rows kept alive above and below the viewport of a scroll view
+#define UI_SCROLL_OVERSCAN 4
+#define UI_SCROLL_STEP 48 // pixels per wheel notch
+#define UI_SCROLLBAR_WIDTH 6
+#define UI_SCROLLBAR_MIN_THUMB 16
+
+#define UI_LABEL_SIZE 16 // line height of button labels, less on shorter buttons
+
+#define UI_TEXT_AREA_SIZE 16 // line height of a text area
+#define UI_TEXT_AREA_SCROLL_LINES 3 // lines per wheel notch
+#define UI_TEXT_AREA_TAB 4
+#define UI_TEXT_AREA_MAX_COLUMNS 1024 // the rest of a longer line is never read
+
+struct UIHitLevel {
+    int cell_size, cols, rows;
+    int first_cell;
+    int elements; // bucketed on this level, hit tests skip empty ones
+};
+
+struct UIHitCell {
+    int start, used; // room up to the start of the next cell
+};
+
+// elements are keyed in draw order and a cell keeps its keys sorted, so the last hit is the topmost
+struct UIHitGrid {
+    struct UIHitGrid* next;
+    bool stale; // rebuilt before the next hit test, the tree changed shape
+    int moves; // elements moved in place since the last hit test
+    UIRect bounds;
+    struct UIHitLevel levels[UI_HIT_LEVELS];
+    int level_count;
+    int count, element_capacity;
+    struct UIElement** order; // by key
+    UIRect* rects; // as bucketed
+    UIRect* clip; // what the ancestors leave visible, drawing clips children to their parent
+    int* handler; // key of the closest element above with a pointer handler, -1 for none
+    int cell_count, cell_capacity;
+    struct UIHitCell* cells; // one past the last for its start
+    int* keys;
+    int key_capacity;
+};
+
+static UIElement pointer_capture = NULL;
+static struct UIHitGrid* hit_grids = NULL;
+
+// pointer arrays of 1 to 64 entries are served from power of two pools
+#define UI_ARRAY_CLASSES 7
+
+static bool pools_ready = false;
+static struct Pool element_pools[UI_TYPE_COUNT];
+static struct Pool array_pools[UI_ARRAY_CLASSES];
+static size_t heap_array_bytes = 0;
+static size_t peak_bytes = 0;
+
+// named classes are shared by reference; an element overriding fields gets a
+// private pooled one on top of its class, so class updates still reach the rest
+struct UIStyleClass {
+    struct UIStyleSheet sheet;
+    struct UIStyleClass* base;
+    struct UIStyleClass* next;
+    char* name; // NULL for private copies
+    int overrides; // fields of sheet replacing the base's, private copies only
+    int refs;
+    bool listed;
+};
+
+static struct Pool style_pool;
+static struct UIStyleClass* style_classes = NULL;
+static UIStyleClass default_class = NULL;
+
+// subtrees that opted into caching render into an offscreen target
+struct UIRenderCache {
+    struct UIRenderCache* next;
+    UIElement owner;
+    const struct RenderBackend* backend;
+    RenderTarget target;
+    int width, height;
+    unsigned epoch;
+    bool valid;
+};
+
+static struct UIRenderCache* render_caches = NULL;
+static unsigned cache_epoch = 1; // bumped when shared styles change under every cache
+static bool cache_rendering = false;
 
 struct UICallbackTable {
     void (*ui_draw)(UIElement ui_element);
@@ -23,6 +147,7 @@ struct UICallbackTable {
     void (*ui_mouse_down)(UIElement ui_element, int button, int x, int y);
     void (*ui_mouse_up)(UIElement ui_element, int button, int x, int y);
     void (*ui_mouse_moved)(UIElement ui_element, int x, int y);
+    void (*ui_scroll)(UIElement ui_element, double dx, double dy);
     void (*ui_free)(UIElement ui_element);
 };
 
@@ -33,8 +158,19 @@ struct UIElement {
     struct UIElement* parent;
     struct UIElement** children;
     int child_count;
-    struct UIStyleSheet style;
+    int child_capacity;
+    UIStyleClass style;
     int _x, _y, _w, _h;
+    int layout_w, layout_h; // window size the subtree was last laid out for
+    int subtree_size; // elements, itself included
+    bool layout_dirty;
+    bool subtree_dirty;
+    struct UIHitGrid* hit_grid; // only built for tree roots
+    int hit_key; // in the grid of its tree, only valid where the grid maps it back
+    struct UIRenderCache* cache;
+    struct UIElement** dependents;
+    int dependent_count;
+    int dependent_capacity;
 };
 
 struct UIResizer {
@@ -51,6 +187,33 @@ struct UIButton {
     void (*on_click)(void* user_data);
     void* user_data;
     bool click_started;
+    char* label; // owned, NULL for none
+};
+
+// only the rows in the viewport exist, as children, the rest of the list is an index range
+struct UIScrollView {
+    UIListSource source;
+    long item_count;
+    int row_height;
+    double offset; // pixels scrolled from the top
+    long first; // item shown by active[0]
+    UIElement* active;
+    int active_count;
+    int active_capacity;
+    UIElement* spare; // detached rows waiting to be bound again
+    int spare_count;
+    int spare_capacity;
+};
+
+// only the visible lines are ever read from the buffer, which is not owned
+struct UITextArea {
+    TextBuffer buffer;
+    Highlighter highlighter; // NULL draws plain text
+    size_t top_line;
+    size_t top_offset; // start of top_line while version matches the buffer
+    unsigned long version;
+    bool top_known;
+    double scroll_carry; // touchpad scrolling below one line
 };
 
 static void dimensions(UITransform transform, int window_w, int window_h,
@@ -82,9 +245,605 @@ static void recalculate_dimensions(UIElement ui_element, int window_w, int windo
     ui_element->_h = h;
 }
 
+static bool inside_rect(UIRect rect, int x, int y) {
+    return x == CLAMP(rect.x, rect.x + rect.w, x) && y == CLAMP(rect.y, rect.y + rect.h, y);
+}
+
+static UIRect element_rect(UIElement ui_element) {
+    return (UIRect) {ui_element->_x, ui_element->_y, ui_element->_w, ui_element->_h};
+}
+
 static bool point_inside(UIElement ui_element, int x, int y) {
-    return x == CLAMP(ui_element->_x, ui_element->_x + ui_element->_w, x) &&
-           y == CLAMP(ui_element->_y, ui_element->_y + ui_element->_h, y);
+    return inside_rect(element_rect(ui_element), x, y);
+}
+
+static bool intersect_rect(UIRect a, UIRect b, UIRect* out) {
+    int x0 = MAX(a.x, b.x);
+    int y0 = MAX(a.y, b.y);
+    int x1 = MIN(a.x + a.w, b.x + b.w);
+    int y1 = MIN(a.y + a.h, b.y + b.h);
+    *out = (UIRect) {x0, y0, x1 - x0, y1 - y0};
+    return x1 > x0 && y1 > y0;
+}
+
+static UIRect union_rect(UIRect a, UIRect b) {
+    int x0 = MIN(a.x, b.x);
+    int y0 = MIN(a.y, b.y);
+    int x1 = MAX(a.x + a.w, b.x + b.w);
+    int y1 = MAX(a.y + a.h, b.y + b.h);
+    return (UIRect) {x0, y0, x1 - x0, y1 - y0};
+}
+
+static long rect_area(UIRect r) {
+    return (long) r.w * r.h;
+}
+
+static void add_damage(struct UIDamage* damage, UIRect rect) {
+    if (rect.w <= 0 || rect.h <= 0)
+        return;
+    UIRect overlap;
+    for (int i = 0; i < damage->count; i++) {
+        if (intersect_rect(damage->rects[i], rect, &overlap)) {
+            damage->rects[i] = union_rect(damage->rects[i], rect);
+            return;
+        }
+    }
+    if (damage->count < UI_MAX_DAMAGE_RECTS) {
+        damage->rects[damage->count++] = rect;
+        return;
+    }
+    // out of slots: grow the rect that gets the least bigger
+    int best = 0;
+    long best_growth = LONG_MAX;
+    for (int i = 0; i < damage->count; i++) {
+        long growth = rect_area(union_rect(damage->rects[i], rect)) - rect_area(damage->rects[i]);
+        if (growth < best_growth) {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    damage->rects[best] = union_rect(damage->rects[best], rect);
+}
+
+// returns the root of the tree, which was walked to anyway
+static UIElement invalidate_caches(UIElement ui_element) {
+    UIElement root = ui_element;
+    for (; ui_element; ui_element = ui_element->parent) {
+        if (ui_element->cache)
+            ui_element->cache->valid = false;
+        root = ui_element;
+    }
+    return root;
+}
+
+static void invalidate_hit_grid(UIElement root) {
+    if (root->hit_grid)
+        root->hit_grid->stale = true;
+}
+
+static void hit_grid_moved(struct UIHitGrid* grid, UIElement ui_element);
+
+static void damage_element(UIElement ui_element) {
+    add_damage(&damage_current, element_rect(ui_element));
+    invalidate_caches(ui_element);
+}
+
+static void element_moved(UIElement ui_element, UIRect old, UIRect new) {
+    add_damage(&damage_current, old);
+    add_damage(&damage_current, new);
+    UIElement root = invalidate_caches(ui_element);
+    if (root->hit_grid)
+        hit_grid_moved(root->hit_grid, ui_element);
+}
+
+static size_t element_size(enum UIType type);
+
+static void init_pools(void) {
+    for (int type = 0; type < UI_TYPE_COUNT; type++)
+        pool_init(&element_pools[type], element_size(type));
+    for (int i = 0; i < UI_ARRAY_CLASSES; i++)
+        pool_init(&array_pools[i], sizeof(UIElement) << i);
+    pool_init(&style_pool, sizeof(struct UIStyleClass));
+    pools_ready = true;
+}
+
+static size_t live_bytes(void) {
+    size_t live = heap_array_bytes;
+    for (int type = 0; type < UI_TYPE_COUNT; type++)
+        live += pool_live_bytes(&element_pools[type]);
+    for (int i = 0; i < UI_ARRAY_CLASSES; i++)
+        live += pool_live_bytes(&array_pools[i]);
+    live += pool_live_bytes(&style_pool);
+    return live;
+}
+
+static void track_peak(void) {
+    size_t live = live_bytes();
+    if (live > peak_bytes)
+        peak_bytes = live;
+}
+
+static UIElement alloc_element(enum UIType type) {
+    if (!pools_ready)
+        init_pools();
+    UIElement out = pool_alloc(&element_pools[type]);
+    track_peak();
+    return out;
+}
+
+static int array_class(int capacity) {
+    int class = 0;
+    while ((1 << class) < capacity)
+        class++;
+    return class;
+}
+
+static UIElement* alloc_array(int capacity) {
+    int class = array_class(capacity);
+    UIElement* out;
+    if (class < UI_ARRAY_CLASSES) {
+        if (!pools_ready)
+            init_pools();
+        out = pool_alloc(&array_pools[class]);
+    }
+    else {
+        out = malloc(sizeof(UIElement) * capacity);
+        heap_array_bytes += sizeof(UIElement) * capacity;
+    }
+    track_peak();
+    return out;
+}
+
+static void release_class(UIStyleClass style_class) {
+    while (style_class && --style_class->refs == 0) {
+        UIStyleClass base = style_class->base;
+        if (style_class->name) {
+            UIStyleClass* link = &style_classes;
+            while (*link != style_class)
+                link = &(*link)->next;
+            *link = style_class->next;
+            free(style_class->name);
+            free(style_class);
+        }
+        else
+            pool_free(&style_pool, style_class);
+        style_class = base;
+    }
+}
+
+static UIStyleClass create_class(const char* name, UIStyleSheet sheet) {
+    UIStyleClass out = malloc(sizeof(struct UIStyleClass));
+    out->sheet = *sheet;
+    out->base = NULL;
+    out->name = malloc(strlen(name) + 1);
+    strcpy(out->name, name);
+    out->refs = 1; // held by the registry until removed
+    out->listed = true;
+    out->next = style_classes;
+    style_classes = out;
+    return out;
+}
+
+static UIStyleClass get_default_class(void) {
+    if (!default_class) {
+        default_class = create_class("default", &(struct UIStyleSheet) {
+            .background_color = color32(0x20, 0x20, 0x20, 0x80),
+            .border_color = color32(0x20, 0x20, 0x20, 0xff),
+            .border_strengh = 2,
+            .color = color32(0xff, 0xff, 0xff, 0x80)
+        });
+    }
+    return default_class;
+}
+
+// the class as it is now with the element's own fields on top
+static struct UIStyleSheet resolve_style(UIElement ui_element) {
+    UIStyleClass style = ui_element->style;
+    if (style->name)
+        return style->sheet;
+    struct UIStyleSheet out = style->base->sheet;
+    if (style->overrides & UI_STYLE_COLOR)
+        out.color = style->sheet.color;
+    if (style->overrides & UI_STYLE_BACKGROUND_COLOR)
+        out.background_color = style->sheet.background_color;
+    if (style->overrides & UI_STYLE_BORDER_COLOR)
+        out.border_color = style->sheet.border_color;
+    if (style->overrides & UI_STYLE_BORDER_STRENGH)
+        out.border_strengh = style->sheet.border_strengh;
+    return out;
+}
+
+// marks fields as the element's own, the element's reference to the class moves to its private one
+static UIStyleSheet writable_style(UIElement ui_element, int fields) {
+    UIStyleClass style = ui_element->style;
+    if (style->name) {
+        if (!pools_ready)
+            init_pools();
+        UIStyleClass copy = pool_alloc(&style_pool);
+        copy->base = style;
+        copy->next = NULL;
+        copy->name = NULL;
+        copy->overrides = 0;
+        copy->refs = 1;
+        copy->listed = false;
+        ui_element->style = copy;
+        track_peak();
+    }
+    // fields that are not overridden are ignored, they only show the caller the current look
+    ui_element->style->sheet = resolve_style(ui_element);
+    ui_element->style->overrides |= fields;
+    return &ui_element->style->sheet;
+}
+
+static void free_array(UIElement* array, int capacity) {
+    if (!array)
+        return;
+    int class = array_class(capacity);
+    if (class < UI_ARRAY_CLASSES) {
+        pool_free(&array_pools[class], array);
+    }
+    else {
+        free(array);
+        heap_array_bytes -= sizeof(UIElement) * capacity;
+    }
+}
+
+static void append_to_array(UIElement** array, int* count, int* capacity, UIElement item) {
+    if (*count == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 1;
+        UIElement* copy = alloc_array(grown);
+        if (*count)
+            memcpy(copy, *array, sizeof(UIElement) * *count);
+        free_array(*array, *capacity);
+        *array = copy;
+        *capacity = grown;
+    }
+    (*array)[(*count)++] = item;
+}
+
+static void mark_layout_dirty(UIElement ui_element) {
+    ui_element->layout_dirty = true;
+    for (UIElement p = ui_element->parent; p && !p->subtree_dirty; p = p->parent)
+        p->subtree_dirty = true;
+}
+
+static void add_dependent(UIElement ui_element, UIElement dependent) {
+    append_to_array(&ui_element->dependents, &ui_element->dependent_count,
+                    &ui_element->dependent_capacity, dependent);
+}
+
+static void remove_dependent(UIElement ui_element, UIElement dependent) {
+    for (int i = 0; i < ui_element->dependent_count; i++) {
+        if (ui_element->dependents[i] == dependent) {
+            ui_element->dependents[i] = ui_element->dependents[--ui_element->dependent_count];
+            return;
+        }
+    }
+}
+
+// pixel-only transforms keep their rect when the window changes size
+static bool depends_on_window(UITransform transform, bool width_changed, bool height_changed) {
+    bool on_width = transform->x != 0 ||
+                    (transform->w != 0 && transform->min_w != transform->max_w);
+    bool on_height = transform->y != 0 ||
+                     (transform->h != 0 && transform->min_h != transform->max_h);
+    return (width_changed && on_width) || (height_changed && on_height);
+}
+
+static void mark_window_dependents(UIElement ui_element, bool width_changed, bool height_changed) {
+    if (depends_on_window(&ui_element->transform, width_changed, height_changed))
+        mark_layout_dirty(ui_element);
+    for (int i = 0; i < ui_element->child_count; i++)
+        mark_window_dependents(ui_element->children[i], width_changed, height_changed);
+}
+
+static void add_subtree_size(UIElement ui_element, int size) {
+    for (; ui_element; ui_element = ui_element->parent)
+        ui_element->subtree_size += size;
+}
+
+// the window size of a tree is kept by its root
+static UIElement tree_root(UIElement ui_element) {
+    while (ui_element->parent)
+        ui_element = ui_element->parent;
+    return ui_element;
+}
+
+static void note_window(int window_w, int window_h) {
+    screen_w = MAX(screen_w, window_w);
+    screen_h = MAX(screen_h, window_h);
+}
+
+static void layout_element(UIElement ui_element, const struct UILayoutContext* context) {
+    if (ui_element->layout_dirty) {
+        ui_element->layout_dirty = false;
+        UIRect old = element_rect(ui_element);
+        recalculate_dimensions(ui_element, context->window_w, context->window_h);
+        if (ui_element->callback->ui_resize)
+            ui_element->callback->ui_resize(ui_element, context->window_w, context->window_h);
+        layout_counter++;
+        UIRect new = element_rect(ui_element);
+        if (old.x != new.x || old.y != new.y || old.w != new.w || old.h != new.h) {
+            element_moved(ui_element, old, new);
+            for (int i = 0; i < ui_element->dependent_count; i++)
+                mark_layout_dirty(ui_element->dependents[i]);
+        }
+    }
+    if (ui_element->subtree_dirty) {
+        ui_element->subtree_dirty = false;
+        for (int i = 0; i < ui_element->child_count; i++)
+            layout_element(ui_element->children[i], context);
+    }
+}
+
+// a subtree split off to another worker, which reports back through these
+struct UILayoutMark {
+    UIElement parent;
+    bool moved; // caches from parent up are stale
+    bool left_dirty; // something below parent waits for the serial pass
+};
+
+// what one worker of a parallel pass produced, merged on the calling thread afterwards
+struct UILayoutWorker {
+    _Alignas(64) struct UIDamage damage;
+    int counter;
+    long moved;
+    struct UILayoutMark* marks;
+    int mark_count, mark_capacity;
+    UIElement* moved_dependencies; // moved elements that resizers depend on
+    int dependency_count, dependency_capacity;
+    bool lost; // out of memory for the above, the whole tree is gone over again
+};
+
+static struct UILayoutWorker* layout_workers = NULL;
+
+// the array with room for one more item, NULL with the old one left as it was
+static void* grow_worker_array(void* array, int count, int* capacity, size_t item_size) {
+    if (count < *capacity)
+        return array;
+    int grown = *capacity ? *capacity * 2 : 16;
+    void* copy = realloc(array, item_size * grown);
+    if (!copy) {
+        printf("[UI][ERROR] out of memory during a parallel layout\n");
+        return NULL;
+    }
+    *capacity = grown;
+    return copy;
+}
+
+static void add_mark(struct UILayoutWorker* state, struct UILayoutMark mark) {
+    struct UILayoutMark* marks = grow_worker_array(state->marks, state->mark_count,
+                                                   &state->mark_capacity, sizeof(mark));
+    if (!marks) {
+        state->lost = true;
+        return;
+    }
+    state->marks = marks;
+    marks[state->mark_count++] = mark;
+}
+
+static void add_moved_dependency(struct UILayoutWorker* state, UIElement ui_element) {
+    UIElement* moved = grow_worker_array(state->moved_dependencies, state->dependency_count,
+                                         &state->dependency_capacity, sizeof(UIElement));
+    if (!moved) {
+        state->lost = true;
+        return;
+    }
+    state->moved_dependencies = moved;
+    moved[state->dependency_count++] = ui_element;
+}
+
+static bool layout_children_parallel(const struct UILayoutContext* context, int worker,
+                                     UIElement owner, UIElement parent, long begin, long end);
+
+/*
+ * Lays out a subtree on a worker. Elements with a resize hook read other
+ * elements or change the tree, so they and their subtrees are left dirty for
+ * the serial pass, true when that happened. Caches are invalidated up to the
+ * owner of the task, the owner and above are done once the pass is over.
+ */
+static bool layout_element_parallel(const struct UILayoutContext* context, int worker,
+                                    UIElement owner, UIElement ui_element) {
+    struct UILayoutWorker* state = &layout_workers[worker];
+    if (ui_element->layout_dirty) {
+        if (ui_element->callback->ui_resize)
+            return true;
+        ui_element->layout_dirty = false;
+        UIRect old = element_rect(ui_element);
+        recalculate_dimensions(ui_element, context->window_w, context->window_h);
+        state->counter++;
+        UIRect new = element_rect(ui_element);
+        if (old.x != new.x || old.y != new.y || old.w != new.w || old.h != new.h) {
+            add_damage(&state->damage, old);
+            add_damage(&state->damage, new);
+            for (UIElement it = ui_element; it != owner; it = it->parent)
+                if (it->cache)
+                    it->cache->valid = false;
+            state->moved++;
+            if (ui_element->dependent_count)
+                add_moved_dependency(state, ui_element);
+        }
+    }
+    if (!ui_element->subtree_dirty)
+        return false;
+    ui_element->subtree_dirty = false;
+    bool left_dirty = layout_children_parallel(context, worker, owner, ui_element,
+                                               0, ui_element->child_count);
+    ui_element->subtree_dirty = left_dirty;
+    return left_dirty;
+}
+
+static void layout_range_task(const TaskPoolTask* task, int worker) {
+    UIElement parent = task->item;
+    struct UILayoutWorker* state = &layout_workers[worker];
+    long moved = state->moved;
+    bool left_dirty = layout_children_parallel(task->context, worker, parent, parent,
+                                               task->begin, task->end);
+    if (left_dirty || state->moved != moved)
+        add_mark(state, (struct UILayoutMark) {parent, state->moved != moved, left_dirty});
+}
+
+static bool layout_children_parallel(const struct UILayoutContext* context, int worker,
+                                     UIElement owner, UIElement parent, long begin, long end) {
+    // halves go to the deque while the range is over the grain, assuming siblings of similar size
+    while (end - begin > 1 &&
+           (end - begin) * (long) parent->subtree_size / parent->child_count > UI_PARALLEL_LAYOUT_GRAIN) {
+        long middle = begin + (end - begin) / 2;
+        task_pool_spawn(layout_pool, worker, &(TaskPoolTask) {
+            layout_range_task, context, parent, middle, end
+        });
+        end = middle;
+    }
+    bool left_dirty = false;
+    for (long i = begin; i < end; i++)
+        left_dirty |= layout_element_parallel(context, worker, owner, parent->children[i]);
+    return left_dirty;
+}
+
+static void layout_root_task(const TaskPoolTask* task, int worker) {
+    UIElement root = task->item;
+    struct UILayoutWorker* state = &layout_workers[worker];
+    long moved = state->moved;
+    // the flags of the root are its own, only caches above it are left over
+    layout_element_parallel(task->context, worker, root->parent, root);
+    if (state->moved != moved && root->parent)
+        add_mark(state, (struct UILayoutMark) {root->parent, true, false});
+}
+
+static bool start_layout_pool(void) {
+    if (layout_pool)
+        return true;
+    layout_pool = task_pool_create(layout_threads);
+    if (!layout_pool)
+        return false;
+    int threads = task_pool_threads(layout_pool);
+    layout_workers = aligned_alloc(_Alignof(struct UILayoutWorker), sizeof(struct UILayoutWorker) * threads);
+    if (!layout_workers) {
+        printf("[UI][ERROR] out of memory while starting %d layout threads\n", threads);
+        task_pool_free(layout_pool);
+        layout_pool = NULL;
+        return false;
+    }
+    memset(layout_workers, 0, sizeof(struct UILayoutWorker) * threads);
+    return true;
+}
+
+static void stop_layout_pool(void) {
+    if (!layout_pool)
+        return;
+    for (int i = 0; i < task_pool_threads(layout_pool); i++) {
+        free(layout_workers[i].marks);
+        free(layout_workers[i].moved_dependencies);
+    }
+    free(layout_workers);
+    layout_workers = NULL;
+    task_pool_free(layout_pool);
+    layout_pool = NULL;
+}
+
+// dirty flags and caches taken from the elements themselves, for when notes of a pass were lost
+static bool recover_layout_flags(UIElement ui_element) {
+    bool dirty = false;
+    for (int i = 0; i < ui_element->child_count; i++)
+        dirty |= recover_layout_flags(ui_element->children[i]);
+    ui_element->subtree_dirty = dirty;
+    if (ui_element->cache)
+        ui_element->cache->valid = false;
+    return dirty || ui_element->layout_dirty;
+}
+
+static void mark_all_dependents(UIElement ui_element) {
+    for (int i = 0; i < ui_element->dependent_count; i++)
+        mark_layout_dirty(ui_element->dependents[i]);
+    for (int i = 0; i < ui_element->child_count; i++)
+        mark_all_dependents(ui_element->children[i]);
+}
+
+/*
+ * Rects only depend on the transform and the window, so everything without a
+ * resize hook is laid out in parallel. What the workers could not do without
+ * touching shared state is done here afterwards: damage, caches and hit grids,
+ * dirtying the resizers of elements that moved, and running the hooks through
+ * the serial layout, which then sees the final rects of what they depend on.
+ */
+static void layout_parallel(UIElement ui_element, const struct UILayoutContext* context) {
+    PROFILE_SCOPE("layout_parallel");
+    int threads = task_pool_threads(layout_pool);
+    for (int i = 0; i < threads; i++) {
+        struct UILayoutWorker* state = &layout_workers[i];
+        state->damage.count = 0;
+        state->counter = 0;
+        state->moved = 0;
+        state->mark_count = 0;
+        state->dependency_count = 0;
+        state->lost = false;
+    }
+    task_pool_run(layout_pool, &(TaskPoolTask) {layout_root_task, context, ui_element, 0, 0});
+    bool moved = false, lost = false;
+    for (int i = 0; i < threads; i++) {
+        struct UILayoutWorker* state = &layout_workers[i];
+        layout_counter += state->counter;
+        moved |= state->moved != 0;
+        lost |= state->lost;
+        for (int r = 0; r < state->damage.count; r++)
+            add_damage(&damage_current, state->damage.rects[r]);
+        for (int m = 0; m < state->mark_count; m++) {
+            struct UILayoutMark mark = state->marks[m];
+            if (mark.moved)
+                invalidate_caches(mark.parent);
+            for (UIElement it = mark.parent; mark.left_dirty && it && it != ui_element->parent; it = it->parent)
+                it->subtree_dirty = true;
+        }
+    }
+    // only once every ancestor that should be dirty is again
+    for (int i = 0; i < threads; i++) {
+        struct UILayoutWorker* state = &layout_workers[i];
+        for (int d = 0; d < state->dependency_count; d++) {
+            UIElement moved_element = state->moved_dependencies[d];
+            for (int k = 0; k < moved_element->dependent_count; k++)
+                mark_layout_dirty(moved_element->dependents[k]);
+        }
+    }
+    if (lost) {
+        recover_layout_flags(ui_element);
+        invalidate_caches(ui_element);
+        mark_all_dependents(ui_element);
+    }
+    if (moved)
+        invalidate_hit_grid(tree_root(ui_element));
+}
+
+// the first element where two subtrees need layout, NULL when it is one path, like after a single edit
+static UIElement dirty_fork(UIElement ui_element) {
+    while (ui_element->subtree_dirty) {
+        UIElement dirty = NULL;
+        for (int i = 0; i < ui_element->child_count; i++) {
+            UIElement child = ui_element->children[i];
+            if (!child->layout_dirty && !child->subtree_dirty)
+                continue;
+            if (dirty)
+                return ui_element;
+            dirty = child;
+        }
+        if (!dirty)
+            break;
+        ui_element = dirty;
+    }
+    return NULL;
+}
+
+static void relayout(UIElement ui_element, const struct UILayoutContext* context) {
+    PROFILE_SCOPE("layout");
+    if (layout_threads != 1 && ui_element->subtree_size >= UI_PARALLEL_LAYOUT_MIN) {
+        // the path above the fork is left dirty for the serial pass below
+        UIElement fork = dirty_fork(ui_element);
+        if (fork && fork->subtree_size >= UI_PARALLEL_LAYOUT_MIN && start_layout_pool() &&
+            task_pool_threads(layout_pool) > 1)
+            layout_parallel(fork, context);
+    }
+    // relaying out an element can dirty dependents that were already visited
+    while (ui_element->layout_dirty || ui_element->subtree_dirty)
+        layout_element(ui_element, context);
 }
 
 static void init_ui_element(UIElement init, int window_w, int window_h) {
@@ -92,7 +851,19 @@ static void init_ui_element(UIElement init, int window_w, int window_h) {
 
     init->parent = NULL;
     init->child_count = 0;
+    init->child_capacity = 0;
     init->children = NULL;
+    init->dependent_count = 0;
+    init->dependent_capacity = 0;
+    init->dependents = NULL;
+    init->layout_dirty = true;
+    init->subtree_dirty = false;
+    init->hit_grid = NULL;
+    init->hit_key = -1;
+    init->cache = NULL;
+    init->layout_w = window_w;
+    init->layout_h = window_h;
+    init->subtree_size = 1;
 
     init->transform.x = 0;
     init->transform.y = 0;
@@ -105,14 +876,11 @@ static void init_ui_element(UIElement init, int window_w, int window_h) {
     init->transform.off_x = 0;
     init->transform.off_y = 0;
 
-    init->style.background_color = color32(0x20, 0x20, 0x20, 0x80);
-    init->style.border_color = color32(0x20, 0x20, 0x20, 0xff);
-    init->style.border_strengh = 2;
-    init->style.color = color32(0xff, 0xff, 0xff, 0x80);
+    init->style = get_default_class();
+    init->style->refs++;
+
+    note_window(window_w, window_h);
 
-    window_width = window_w;
-    window_height = window_h;
-    
     init->callback = NULL;
 
     recalculate_dimensions(init, window_w, window_h);
@@ -123,26 +891,10 @@ static void* get_extention_data(UIElement ui_element) {
 }
 
 static void basic_draw(UIElement ui_element) {
-    if (ui_element->style.border_strengh > 0) {
-        int t = ui_element->style.border_strengh;
-        int x = ui_element->_x;
-        int y = ui_element->_y;
-        int w = ui_element->_w;
-        int h = ui_element->_h;
-        glColor4ubv(ui_element->style.border_color.rgba);
-        glRecti(x,      y,
-                x + w,  y + t);
-        glRecti(x,      y + h,
-                x + w,  y + h - t);
-        glRecti(x,      y + t,
-                x + t,  y + h - t);
-        glRecti(x + w,  y + t,
-                x+w-t,  y + h - t);
-        glColor4ubv(ui_element->style.background_color.rgba);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glRecti(x + t, y + t,
-                x+w-t, y + h - t);
-    }
+    struct UIStyleSheet style = resolve_style(ui_element);
+    if (style.border_strengh > 0)
+        render_box(ui_element->_x, ui_element->_y, ui_element->_w, ui_element->_h,
+                   style.background_color, style.border_color, style.border_strengh);
 }
 
 const struct UICallbackTable canvas_table = {
@@ -150,11 +902,12 @@ const struct UICallbackTable canvas_table = {
     .ui_resize = NULL,
     .ui_mouse_down = NULL,
     .ui_mouse_up = NULL,
-    .ui_mouse_moved = NULL
+    .ui_mouse_moved = NULL,
+    .ui_scroll = NULL
 };
 
 UIElement ui_canvas(int window_w, int window_h) {
-    UIElement out = malloc(sizeof(struct UIElement));
+    UIElement out = alloc_element(UI_CANVAS);
     init_ui_element(out, window_w, window_h);
     out->type = UI_CANVAS;
     out->callback = &canvas_table;
@@ -164,7 +917,7 @@ UIElement ui_canvas(int window_w, int window_h) {
 static void resizer_draw(UIElement ui_element) {
     struct UIResizer* res = GET_EXTENTION_DATA(ui_element, UI_RESIZER);
     basic_draw(ui_element);
-    glColor4ubv(ui_element->style.color.rgba);
+    color32 color = resolve_style(ui_element).color;
     int x = ui_element->_x;
     int y = ui_element->_y;
     int w = ui_element->_w;
@@ -173,44 +926,46 @@ static void resizer_draw(UIElement ui_element) {
     if (res->direction == HORIZONTAL) {
         t = w * res->side_ration;
         for (int i = -2; i <= 2; i+=2)
-            glRecti(x + (w - t) / 2, y + (h - t) / 2 + i * t,
-                    x + (w + t) / 2, y + (h + t) / 2 + i * t);
+            render_rect(x + (w - t) / 2, y + (h - t) / 2 + i * t,
+                        x + (w + t) / 2, y + (h + t) / 2 + i * t, color);
     }
     else {
         t = h * res->side_ration;
         for (int i = -2; i <= 2; i+=2)
-            glRecti(x + (h - t) / 2 + i * t,  y + (w - t) / 2,
-                    x + (h + t) / 2 + i * t,  y + (w + t) / 2);
+            render_rect(x + (h - t) / 2 + i * t,  y + (w - t) / 2,
+                        x + (h + t) / 2 + i * t,  y + (w + t) / 2, color);
     }
 }
 
-static void position_resizer(UIElement ui_element) {
+static void position_resizer(UIElement ui_element, int window_w, int window_h) {
     struct UIResizer* resizer = GET_EXTENTION_DATA(ui_element, UI_RESIZER);
     if (resizer->connected_item1 != NULL) {
         if (resizer->direction == HORIZONTAL)
-            ui_element->transform.x = (resizer->connected_item1->_x + MAX(resizer->connected_item1->_w, 0)) / (double) window_width;
+            ui_element->transform.x = (resizer->connected_item1->_x + MAX(resizer->connected_item1->_w, 0)) / (double) window_w;
         else
-            ui_element->transform.y = (resizer->connected_item1->_y + MAX(resizer->connected_item1->_h, 0)) / (double) window_height;
+            ui_element->transform.y = (resizer->connected_item1->_y + MAX(resizer->connected_item1->_h, 0)) / (double) window_h;
     }
     else if (resizer->connected_item2 != NULL) {
         if (resizer->direction == HORIZONTAL)
-            ui_element->transform.x = (resizer->connected_item2->_x + MIN(resizer->connected_item2->_w, 0)) / (double) window_width;
+            ui_element->transform.x = (resizer->connected_item2->_x + MIN(resizer->connected_item2->_w, 0)) / (double) window_w;
         else
-            ui_element->transform.y = (resizer->connected_item2->_y + MIN(resizer->connected_item2->_h, 0)) / (double) window_height;
+            ui_element->transform.y = (resizer->connected_item2->_y + MIN(resizer->connected_item2->_h, 0)) / (double) window_h;
     }
 }
 
 static void resizer_resize(UIElement ui_element, int window_w, int window_h) {
-    (void) window_w; (void) window_h;
-    position_resizer(ui_element);
+    position_resizer(ui_element, window_w, window_h);
+    recalculate_dimensions(ui_element, window_w, window_h);
 }
 
 static void resizer_mouse_down(UIElement ui_element, int button, int x, int y) {
     struct UIResizer* resizer = GET_EXTENTION_DATA(ui_element, UI_RESIZER);
     if (button != 1)
         return;
-    if (point_inside(ui_element, x, y))
+    if (point_inside(ui_element, x, y)) {
         resizer->currently_grabbed = true;
+        ui_capture_pointer(ui_element);
+    }
 }
 
 static void resizer_mouse_up(UIElement ui_element, int button, int x, int y) {
@@ -219,6 +974,7 @@ static void resizer_mouse_up(UIElement ui_element, int button, int x, int y) {
     if (button != 1)
         return;
     resizer->currently_grabbed = false;
+    ui_release_pointer(ui_element);
 }
 
 static void resizer_mouse_moved(UIElement ui_element, int x, int y) {
@@ -228,8 +984,9 @@ static void resizer_mouse_moved(UIElement ui_element, int x, int y) {
             resizer->set_cursor(resizer->user_data, resizer->direction);
     }
     if (resizer->currently_grabbed) {
+        UIElement root = tree_root(ui_element);
         if (resizer->direction == HORIZONTAL) {
-            double nx = x / (double) window_width;
+            double nx = x / (double) root->layout_w;
             if (resizer->connected_item1) {
                 resizer->connected_item1->transform.w = nx - resizer->connected_item1->transform.x;
                 if (resizer->connected_item1->transform.w < 0)
@@ -242,7 +999,7 @@ static void resizer_mouse_moved(UIElement ui_element, int x, int y) {
             }
         }
         else {
-            double ny = y / (double) window_height;
+            double ny = y / (double) root->layout_h;
             if (resizer->connected_item1) {
                 resizer->connected_item1->transform.h = ny - resizer->connected_item1->transform.x;
                 if (resizer->connected_item1->transform.h < 0)
@@ -254,8 +1011,21 @@ static void resizer_mouse_moved(UIElement ui_element, int x, int y) {
                     resizer->connected_item2->transform.y = ny;
             }
         }
+        if (resizer->connected_item1)
+            mark_layout_dirty(resizer->connected_item1);
+        if (resizer->connected_item2)
+            mark_layout_dirty(resizer->connected_item2);
     }
-    position_resizer(ui_element);
+}
+
+// items freed first have already let go of the resizer, see forget_dependents
+static void resizer_free(UIElement ui_element) {
+    struct UIResizer* resizer = GET_EXTENTION_DATA(ui_element, UI_RESIZER);
+    if (resizer->connected_item1)
+        remove_dependent(resizer->connected_item1, ui_element);
+    if (resizer->connected_item2)
+        remove_dependent(resizer->connected_item2, ui_element);
+    resizer->connected_item1 = resizer->connected_item2 = NULL;
 }
 
 const struct UICallbackTable resizer_table = {
@@ -263,12 +1033,14 @@ const struct UICallbackTable resizer_table = {
     .ui_resize = resizer_resize,
     .ui_mouse_down = resizer_mouse_down,
     .ui_mouse_up = resizer_mouse_up,
-    .ui_mouse_moved = resizer_mouse_moved
+    .ui_mouse_moved = resizer_mouse_moved,
+    .ui_scroll = NULL,
+    .ui_free = resizer_free
 };
 
 UIElement ui_resizer(int window_w, int window_h, enum UIDirection direction,
                      UIElement item1, UIElement item2, double side) {
-    UIElement out = malloc(sizeof(struct UIElement) + sizeof(struct UIResizer));
+    UIElement out = alloc_element(UI_RESIZER);
     init_ui_element(out, window_w, window_h);
     out->type = UI_RESIZER;
     out->callback = &resizer_table;
@@ -278,6 +1050,12 @@ UIElement ui_resizer(int window_w, int window_h, enum UIDirection direction,
     resizer->direction = direction;
     resizer->side_ration = side;
     resizer->currently_grabbed = false;
+    resizer->set_cursor = NULL;
+    resizer->user_data = NULL;
+    if (item1)
+        add_dependent(item1, out);
+    if (item2)
+        add_dependent(item2, out);
 
     if (item1 != NULL) {
         int x = item1->_x;
@@ -308,6 +1086,7 @@ static void button_mouse_down(UIElement ui_element, int mbutton, int x, int y) {
     if (point_inside(ui_element, x, y)) {
         struct UIButton* button = get_extention_data(ui_element);
         button->click_started = true;
+        ui_capture_pointer(ui_element);
     }
 }
 
@@ -315,22 +1094,45 @@ static void button_mouse_up(UIElement ui_element, int mbutton, int x, int y) {
     if (mbutton != 1)
         return;
     struct UIButton* button = get_extention_data(ui_element);
-    if (button->click_started && point_inside(ui_element, x, y)) {
+    if (button->click_started && button->on_click && point_inside(ui_element, x, y)) {
         button->on_click(button->user_data);
     }
     button->click_started = false;
+    ui_release_pointer(ui_element);
+}
+
+// the label is centered in the button with the style color
+static void button_draw(UIElement ui_element) {
+    struct UIButton* button = GET_EXTENTION_DATA(ui_element, UI_BUTTON);
+    basic_draw(ui_element);
+    if (!button->label)
+        return;
+    TextFont font = text_default_font();
+    int size = MIN(UI_LABEL_SIZE, ui_element->_h);
+    int width = text_width(font, size, button->label);
+    text_draw(font, size, ui_element->_x + (ui_element->_w - width) / 2,
+              ui_element->_y + (ui_element->_h - text_line_height(font, size)) / 2,
+              button->label, resolve_style(ui_element).color);
+}
+
+static void button_free(UIElement ui_element) {
+    struct UIButton* button = GET_EXTENTION_DATA(ui_element, UI_BUTTON);
+    free(button->label);
+    button->label = NULL;
 }
 
 const struct UICallbackTable button_table = {
-    .ui_draw = basic_draw,
+    .ui_draw = button_draw,
     .ui_resize = NULL,
     .ui_mouse_down = button_mouse_down,
     .ui_mouse_up = button_mouse_up,
-    .ui_mouse_moved = NULL
+    .ui_mouse_moved = NULL,
+    .ui_scroll = NULL,
+    .ui_free = button_free
 };
 
 UIElement ui_button(int window_w, int window_h, void (*on_click)(void*), void* user_data) {
-    UIElement out = malloc(sizeof(struct UIElement) + sizeof(struct UIButton));
+    UIElement out = alloc_element(UI_BUTTON);
     init_ui_element(out, window_w, window_h);
     out->type = UI_BUTTON;
     out->callback = &button_table;
@@ -338,98 +1140,1132 @@ UIElement ui_button(int window_w, int window_h, void (*on_click)(void*), void* u
     button->on_click = on_click;
     button->user_data = user_data;
     button->click_started = false;
+    button->label = NULL;
     return out;
 }
 
-void ui_resizer_set_curser_func(UIElement ui_element, void (*curser_func)
-                                (void* user_data, enum UIDirection),
-                                void* user_data) {
-    struct UIResizer* resizer = GET_EXTENTION_DATA(ui_element, UI_RESIZER);
-    resizer->set_cursor = curser_func;
-    resizer->user_data = user_data;
+void ui_button_set_label(UIElement ui_element, const char* label) {
+    struct UIButton* button = GET_EXTENTION_DATA(ui_element, UI_BUTTON);
+    free(button->label);
+    button->label = NULL;
+    if (label && !(button->label = strdup(label)))
+        printf("[UI][ERROR] out of memory while setting a button label\n");
+    damage_element(ui_element);
 }
 
-void ui_draw(UIElement ui_element) {
-    recalculate_dimensions(ui_element,window_width, window_height); // TODO: find a clean solution for this
-    bool scissors = glIsEnabled(GL_SCISSOR_TEST);
-    int scissors_box[4];
-    if (scissors)
-        glGetIntegerv(GL_SCISSOR_BOX, scissors_box);
-    else
-        glEnable(GL_SCISSOR_TEST);
-    glScissor(ui_element->_x, ui_element->_y, ui_element->_w, ui_element->_h);
-    if (ui_element->callback->ui_draw)
-        ui_element->callback->ui_draw(ui_element);
-    for (int i = 0; i < ui_element->child_count; i++)
-        ui_draw(ui_element->children[i]);
-    if (scissors)
-        glScissor(scissors_box[0], scissors_box[1], scissors_box[2], scissors_box[3]);
-    else
-        glDisable(GL_SCISSOR_TEST);
+const char* ui_button_get_label(UIElement ui_element) {
+    return ((struct UIButton*) GET_EXTENTION_DATA(ui_element, UI_BUTTON))->label;
 }
 
-void ui_resize(UIElement ui_element, int window_w, int window_h) {
-    window_width = window_w;
-    window_height = window_h;
-    recalculate_dimensions(ui_element, window_w, window_h);
-    if (ui_element->callback->ui_resize)
-        ui_element->callback->ui_resize(ui_element, window_w, window_h);
-    for (int i = 0; i < ui_element->child_count; i++)
-        ui_resize(ui_element->children[i], window_w, window_h);
+static void free_element(UIElement ui_element);
+
+static long scroll_content_height(struct UIScrollView* list) {
+    return list->item_count * (long) list->row_height;
 }
 
-void ui_mouse_down(UIElement ui_element, int button, int x, int y) {
-    if (ui_element->callback->ui_mouse_down)
-        ui_element->callback->ui_mouse_down(ui_element, button, x, y);
-    for (int i = 0; i < ui_element->child_count; i++)
-        ui_mouse_down(ui_element->children[i], button, x, y);
+static double scroll_max_offset(UIElement ui_element, struct UIScrollView* list) {
+    return MAX(scroll_content_height(list) - ui_element->_h, 0L);
 }
 
-void ui_mouse_up(UIElement ui_element, int button, int x, int y) {
-    if (ui_element->callback->ui_mouse_up)
-        ui_element->callback->ui_mouse_up(ui_element, button, x, y);
-    for (int i = 0; i < ui_element->child_count; i++)
-        ui_mouse_up(ui_element->children[i], button, x, y);
+static int scroll_row_width(UIElement ui_element, struct UIScrollView* list) {
+    if (scroll_content_height(list) > ui_element->_h)
+        return MAX(ui_element->_w - UI_SCROLLBAR_WIDTH, 0);
+    return ui_element->_w;
 }
 
-void ui_mouse_moved(UIElement ui_element, int x, int y) {
-    if (ui_element->callback->ui_mouse_moved)
-        ui_element->callback->ui_mouse_moved(ui_element, x, y);
-    for (int i = 0; i < ui_element->child_count; i++)
-        ui_mouse_moved(ui_element->children[i], x, y);
+static void place_row(UIElement ui_element, struct UIScrollView* list, UIElement row, long index) {
+    // relative to the top edge so the long arithmetic stays exact for huge lists
+    long scrolled = (long) list->offset;
+    int top = ui_element->_y + ui_element->_h - (int) (index * list->row_height - scrolled);
+    struct UITransform transform = {
+        .min_w = scroll_row_width(ui_element, list),
+        .max_w = scroll_row_width(ui_element, list),
+        .min_h = list->row_height,
+        .max_h = list->row_height,
+        .off_x = ui_element->_x,
+        .off_y = top - list->row_height
+    };
+    if (memcmp(&row->transform, &transform, sizeof(transform)) != 0) {
+        row->transform = transform;
+        mark_layout_dirty(row);
+    }
 }
 
-void ui_set_parent(UIElement ui_element, UIElement parent) {
-    if (ui_element->parent) {
-        UIElement old_parent = ui_element->parent;
-        bool move = false;
-        for (int i = 0; i < ui_element->parent->child_count + 1; i++) {
-            if (move)
-                old_parent->children[i-1] = old_parent->children[i];
-            else
-                move = ui_element->parent->children[i] == ui_element;
-        }
-        old_parent->child_count--;
+static UIElement take_row(UIElement ui_element, struct UIScrollView* list) {
+    if (list->spare_count)
+        return list->spare[--list->spare_count];
+    UIElement root = tree_root(ui_element);
+    if (list->source.create_row)
+        return list->source.create_row(list->source.user_data, root->layout_w, root->layout_h);
+    return ui_canvas(root->layout_w, root->layout_h);
+}
+
+static void recycle_row(struct UIScrollView* list, UIElement row) {
+    ui_set_parent(row, NULL);
+    append_to_array(&list->spare, &list->spare_count, &list->spare_capacity, row);
+}
+
+static void reverse_rows(UIElement* rows, int from, int to) {
+    for (to--; from < to; from++, to--) {
+        UIElement row = rows[from];
+        rows[from] = rows[to];
+        rows[to] = row;
     }
-    if (parent) {
-        parent->children = realloc(parent->children, sizeof(UIElement) * (parent->child_count + 1));
-        parent->children[parent->child_count] = ui_element;
-        parent->child_count++;
+}
+
+// rows[i] becomes the row that was at i + shift, wrapping around
+static void rotate_rows(UIElement* rows, int count, int shift) {
+    shift = (shift % count + count) % count;
+    reverse_rows(rows, 0, shift);
+    reverse_rows(rows, shift, count);
+    reverse_rows(rows, 0, count);
+}
+
+/*
+ * Brings the active rows in line with the viewport. Rows that stay visible
+ * keep their binding, the ones that scrolled out stay children and are
+ * bound again, in place, for the items that scrolled in. Rows only come
+ * from or go to the spare list when the number of visible rows changes.
+ */
+static void update_rows(UIElement ui_element) {
+    struct UIScrollView* list = GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW);
+    list->offset = CLAMP(0.0, scroll_max_offset(ui_element, list), list->offset);
+    long first = 0, last = 0;
+    if (list->item_count > 0 && list->row_height > 0 && ui_element->_h > 0) {
+        // the same number of rows at every offset, so scrolling never adds or drops one
+        long window = ui_element->_h / list->row_height + 2 + 2 * UI_SCROLL_OVERSCAN;
+        first = (long) list->offset / list->row_height - UI_SCROLL_OVERSCAN;
+        first = CLAMP(0L, MAX(list->item_count - window, 0L), first);
+        last = MIN(first + window, list->item_count);
     }
-    ui_element->parent = parent;
+    int count = last - first;
+    // active[bound_from..bound_to) still show the item their new position asks for
+    int bound_from = 0, bound_to = 0;
+    long shift = first - list->first;
+    if (list->active_count && labs(shift) < list->active_count) {
+        rotate_rows(list->active, list->active_count, shift);
+        bound_from = shift < 0 ? -shift : 0;
+        bound_to = shift < 0 ? list->active_count : list->active_count - shift;
+    }
+    while (list->active_count > count)
+        recycle_row(list, list->active[--list->active_count]);
+    while (list->active_count < count) {
+        UIElement row = take_row(ui_element, list);
+        ui_set_parent(row, ui_element);
+        append_to_array(&list->active, &list->active_count, &list->active_capacity, row);
+    }
+    for (int i = 0; i < count; i++) {
+        if ((i < bound_from || i >= bound_to) && list->source.bind_row)
+            list->source.bind_row(list->source.user_data, list->active[i], first + i);
+        place_row(ui_element, list, list->active[i], first + i);
+    }
+    list->first = first;
 }
 
-void ui_free(UIElement ui_element) {
-    if (ui_element->callback->ui_free)
-        ui_element->callback->ui_free(ui_element);
-    for (int i = 0; i < ui_element->child_count; i++)
-        ui_free(ui_element->children[i]);
-    free(ui_element);
+static void scroll_view_draw(UIElement ui_element) {
+    struct UIScrollView* list = GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW);
+    basic_draw(ui_element);
+    long content = scroll_content_height(list);
+    int h = ui_element->_h;
+    if (content <= h)
+        return;
+    int thumb = MAX((int) ((double) h * h / content), MIN(UI_SCROLLBAR_MIN_THUMB, h));
+    int top = ui_element->_y + h - (int) (list->offset / scroll_max_offset(ui_element, list) * (h - thumb));
+    int x = ui_element->_x + ui_element->_w - UI_SCROLLBAR_WIDTH;
+    render_rect(x, top - thumb, x + UI_SCROLLBAR_WIDTH, top, resolve_style(ui_element).color);
 }
 
-static int* find_param_i(UIElement ui_element, int param) {
-    switch (param) {
-    case UI_CHILD_COUNT:
+static void scroll_view_resize(UIElement ui_element, int window_w, int window_h) {
+    (void) window_w; (void) window_h;
+    update_rows(ui_element);
+}
+
+static void scroll_view_scroll(UIElement ui_element, double dx, double dy) {
+    (void) dx;
+    struct UIScrollView* list = GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW);
+    // wheel up moves the content down, fractional steps come from touchpads
+    ui_scroll_view_set_offset(ui_element, list->offset - dy * UI_SCROLL_STEP);
+}
+
+static void scroll_view_free(UIElement ui_element) {
+    struct UIScrollView* list = GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW);
+    for (int i = 0; i < list->spare_count; i++)
+        free_element(list->spare[i]);
+    free_array(list->spare, list->spare_capacity);
+    free_array(list->active, list->active_capacity);
+    list->spare = list->active = NULL;
+    list->spare_count = list->active_count = 0;
+}
+
+const struct UICallbackTable scroll_view_table = {
+    .ui_draw = scroll_view_draw,
+    .ui_resize = scroll_view_resize,
+    .ui_mouse_down = NULL,
+    .ui_mouse_up = NULL,
+    .ui_mouse_moved = NULL,
+    .ui_scroll = scroll_view_scroll,
+    .ui_free = scroll_view_free
+};
+
+UIElement ui_scroll_view(int window_w, int window_h, int row_height, UIListSource source) {
+    UIElement out = alloc_element(UI_SCROLL_VIEW);
+    init_ui_element(out, window_w, window_h);
+    out->type = UI_SCROLL_VIEW;
+    out->callback = &scroll_view_table;
+    struct UIScrollView* list = get_extention_data(out);
+    list->source = source;
+    list->item_count = 0;
+    list->row_height = MAX(row_height, 1);
+    list->offset = 0;
+    list->first = 0;
+    list->active = list->spare = NULL;
+    list->active_count = list->active_capacity = 0;
+    list->spare_count = list->spare_capacity = 0;
+    return out;
+}
+
+void ui_scroll_view_set_count(UIElement ui_element, long item_count) {
+    struct UIScrollView* list = GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW);
+    list->item_count = MAX(item_count, 0L);
+    update_rows(ui_element);
+    damage_element(ui_element);
+}
+
+long ui_scroll_view_get_count(UIElement ui_element) {
+    return ((struct UIScrollView*) GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW))->item_count;
+}
+
+void ui_scroll_view_set_offset(UIElement ui_element, double offset) {
+    struct UIScrollView* list = GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW);
+    double clamped = CLAMP(0.0, scroll_max_offset(ui_element, list), offset);
+    if (clamped == list->offset)
+        return;
+    list->offset = clamped;
+    update_rows(ui_element);
+    // the scrollbar moves even when no row does
+    damage_element(ui_element);
+}
+
+double ui_scroll_view_get_offset(UIElement ui_element) {
+    return ((struct UIScrollView*) GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW))->offset;
+}
+
+// binds every visible row again, for when the items behind them changed
+void ui_scroll_view_refresh(UIElement ui_element) {
+    struct UIScrollView* list = GET_EXTENTION_DATA(ui_element, UI_SCROLL_VIEW);
+    if (list->source.bind_row)
+        for (int i = 0; i < list->active_count; i++)
+            list->source.bind_row(list->source.user_data, list->active[i], list->first + i);
+    damage_element(ui_element);
+}
+
+// finds the top line again after an edit, or after it was deleted
+static bool text_area_top(struct UITextArea* area, size_t* offset) {
+    if (!area->buffer)
+        return false;
+    unsigned long version = text_buffer_version(area->buffer);
+    if (!area->top_known || area->version != version) {
+        if (!text_buffer_line_start(area->buffer, area->top_line, &area->top_offset)) {
+            area->top_line = text_buffer_line_of(area->buffer, text_buffer_length(area->buffer));
+            text_buffer_line_start(area->buffer, area->top_line, &area->top_offset);
+        }
+        area->version = version;
+        area->top_known = true;
+    }
+    *offset = area->top_offset;
+    return true;
+}
+
+// at most the bytes that fit, tabs expanded and carriage returns dropped, returns the column after
+static int text_area_run(const char* raw, size_t length, int column, int columns, char* out) {
+    char* at = out;
+    for (size_t i = 0; i < length && column < columns; i++) {
+        unsigned char c = raw[i];
+        if (c == '\t') {
+            do
+                *at++ = ' ';
+            while (++column % UI_TEXT_AREA_TAB && column < columns);
+            continue;
+        }
+        if (c == '\r')
+            continue;
+        *at++ = c < ' ' ? ' ' : c;
+        // continuation bytes share the column of their lead byte
+        if ((c & 0xC0) != 0x80)
+            column++;
+    }
+    *at = '\0';
+    return column;
+}
+
+struct TextAreaLine {
+    TextFont font;
+    int x, y, advance, columns;
+    char* shown;
+};
+
+static int draw_run(struct TextAreaLine* line, const char* raw, size_t length, int column, color32 color) {
+    if (!length || column >= line->columns)
+        return column;
+    int end = text_area_run(raw, length, column, line->columns, line->shown);
+    text_draw(line->font, UI_TEXT_AREA_SIZE, line->x + column * line->advance, line->y, line->shown, color);
+    return end;
+}
+
+// spans may still be those of the line before an edit, so they are cut to its length
+static void draw_highlighted(struct TextAreaLine* line, const char* raw, size_t length,
+                             const HighlightSpan* spans, int span_count, color32 color) {
+    int column = 0;
+    size_t at = 0;
+    for (int i = 0; i < span_count && at < length; i++) {
+        size_t start = MIN((size_t) spans[i].start, length);
+        size_t end = MIN(start + spans[i].length, length);
+        column = draw_run(line, raw + at, start - at, column, color);
+        column = draw_run(line, raw + start, end - start, column, highlight_color(spans[i].kind));
+        at = end;
+    }
+    draw_run(line, raw + at, length - at, column, color);
+}
+
+static void text_area_draw(UIElement ui_element) {
+    struct UITextArea* area = GET_EXTENTION_DATA(ui_element, UI_TEXT_AREA);
+    basic_draw(ui_element);
+    size_t offset;
+    if (!text_area_top(area, &offset))
+        return;
+    TextFont font = text_default_font();
+    int line_h = text_line_height(font, UI_TEXT_AREA_SIZE);
+    int advance = MAX(text_width(font, UI_TEXT_AREA_SIZE, " "), 1);
+    int columns = CLAMP(0, UI_TEXT_AREA_MAX_COLUMNS, (ui_element->_w - UI_SCROLLBAR_WIDTH) / advance);
+    int rows = (ui_element->_h + line_h - 1) / line_h;
+    int top = ui_element->_y + ui_element->_h;
+    color32 color = resolve_style(ui_element).color;
+    // a multi byte character needs up to four bytes for its column
+    char raw[UI_TEXT_AREA_MAX_COLUMNS * 4 + 1];
+    char shown[UI_TEXT_AREA_MAX_COLUMNS * 4 + 1];
+    size_t wanted = columns * 4 + 1;
+    struct TextAreaLine line = {font, ui_element->_x, 0, advance, columns, shown};
+    if (area->highlighter)
+        highlight_set_visible(area->highlighter, area->top_line, rows);
+    for (int row = 0; row < rows; row++) {
+        size_t got = text_buffer_read(area->buffer, offset, raw, wanted);
+        char* newline = memchr(raw, '\n', got);
+        size_t length = newline ? (size_t) (newline - raw) : got;
+        const HighlightSpan* spans = NULL;
+        int span_count = area->highlighter ? highlight_line(area->highlighter, area->top_line + row, &spans) : -1;
+        line.y = top - (row + 1) * line_h;
+        draw_highlighted(&line, raw, length, spans, MAX(span_count, 0), color);
+        if (newline)
+            offset += newline - raw + 1;
+        else if (got < wanted || !text_buffer_line_start(area->buffer, area->top_line + row + 1, &offset))
+            break;
+    }
+    // the thumb follows the estimated line count, it settles as more of the file gets counted
+    size_t lines = text_buffer_line_count(area->buffer, NULL);
+    int h = ui_element->_h;
+    if (lines <= (size_t) rows || h <= 0)
+        return;
+    int thumb = MAX((int) ((double) h * rows / lines), MIN(UI_SCROLLBAR_MIN_THUMB, h));
+    double position = MIN((double) area->top_line / (lines - rows), 1.0);
+    int thumb_top = top - (int) (position * (h - thumb));
+    int x = ui_element->_x + ui_element->_w - UI_SCROLLBAR_WIDTH;
+    render_rect(x, thumb_top - thumb, x + UI_SCROLLBAR_WIDTH, thumb_top, color);
+}
+
+static void text_area_scroll(UIElement ui_element, double dx, double dy) {
+    (void) dx;
+    struct UITextArea* area = GET_EXTENTION_DATA(ui_element, UI_TEXT_AREA);
+    area->scroll_carry -= dy * UI_TEXT_AREA_SCROLL_LINES;
+    long lines = (long) area->scroll_carry;
+    if (!lines)
+        return;
+    area->scroll_carry -= lines;
+    if (lines < 0 && (size_t) -lines > area->top_line)
+        ui_text_area_scroll_to_line(ui_element, 0);
+    else
+        ui_text_area_scroll_to_line(ui_element, area->top_line + lines);
+}
+
+const struct UICallbackTable text_area_table = {
+    .ui_draw = text_area_draw,
+    .ui_resize = NULL,
+    .ui_mouse_down = NULL,
+    .ui_mouse_up = NULL,
+    .ui_mouse_moved = NULL,
+    .ui_scroll = text_area_scroll,
+    .ui_free = NULL
+};
+
+UIElement ui_text_area(int window_w, int window_h, TextBuffer buffer) {
+    UIElement out = alloc_element(UI_TEXT_AREA);
+    init_ui_element(out, window_w, window_h);
+    out->type = UI_TEXT_AREA;
+    out->callback = &text_area_table;
+    struct UITextArea* area = get_extention_data(out);
+    area->buffer = buffer;
+    area->highlighter = NULL;
+    area->top_line = 0;
+    area->top_offset = 0;
+    area->version = 0;
+    area->top_known = false;
+    area->scroll_carry = 0;
+    return out;
+}
+
+void ui_text_area_set_buffer(UIElement ui_element, TextBuffer buffer) {
+    struct UITextArea* area = GET_EXTENTION_DATA(ui_element, UI_TEXT_AREA);
+    area->buffer = buffer;
+    area->top_line = 0;
+    area->top_known = false;
+    damage_element(ui_element);
+}
+
+// the highlighter has to be made for the buffer shown, neither is owned
+void ui_text_area_set_highlighter(UIElement ui_element, Highlighter highlighter) {
+    struct UITextArea* area = GET_EXTENTION_DATA(ui_element, UI_TEXT_AREA);
+    area->highlighter = highlighter;
+    damage_element(ui_element);
+}
+
+TextBuffer ui_text_area_get_buffer(UIElement ui_element) {
+    return ((struct UITextArea*) GET_EXTENTION_DATA(ui_element, UI_TEXT_AREA))->buffer;
+}
+
+// past the last line it stops on the last line, which counts the whole buffer once
+void ui_text_area_scroll_to_line(UIElement ui_element, size_t line) {
+    struct UITextArea* area = GET_EXTENTION_DATA(ui_element, UI_TEXT_AREA);
+    if (!area->buffer || (area->top_known && line == area->top_line))
+        return;
+    area->top_line = line;
+    area->top_known = false;
+    size_t offset;
+    text_area_top(area, &offset);
+    damage_element(ui_element);
+}
+
+size_t ui_text_area_get_line(UIElement ui_element) {
+    return ((struct UITextArea*) GET_EXTENTION_DATA(ui_element, UI_TEXT_AREA))->top_line;
+}
+
+// the buffer was edited, the top line is looked up again when drawn
+void ui_text_area_refresh(UIElement ui_element) {
+    damage_element(ui_element);
+}
+
+static size_t element_size(enum UIType type) {
+    switch (type) {
+    case UI_RESIZER:
+        return sizeof(struct UIElement) + sizeof(struct UIResizer);
+    case UI_BUTTON:
+        return sizeof(struct UIElement) + sizeof(struct UIButton);
+    case UI_SCROLL_VIEW:
+        return sizeof(struct UIElement) + sizeof(struct UIScrollView);
+    case UI_TEXT_AREA:
+        return sizeof(struct UIElement) + sizeof(struct UITextArea);
+    default:
+        return sizeof(struct UIElement);
+    }
+}
+
+void ui_resizer_set_curser_func(UIElement ui_element, void (*curser_func)
+                                (void* user_data, enum UIDirection),
+                                void* user_data) {
+    struct UIResizer* resizer = GET_EXTENTION_DATA(ui_element, UI_RESIZER);
+    resizer->set_cursor = curser_func;
+    resizer->user_data = user_data;
+}
+
+static void set_scissor(UIRect clip) {
+    if (scissor_known && clip.x == scissor_box.x && clip.y == scissor_box.y &&
+        clip.w == scissor_box.w && clip.h == scissor_box.h)
+        return;
+    render_set_clip(clip.x, clip.y, clip.w, clip.h);
+    scissor_box = clip;
+    scissor_known = true;
+}
+
+static void draw_element(UIElement ui_element, UIRect parent_clip);
+
+#ifdef PROFILE
+static const char* const draw_scope_names[UI_TYPE_COUNT] = {
+    [UI_NO_TYPE] = "draw:none",
+    [UI_CANVAS] = "draw:canvas",
+    [UI_RESIZER] = "draw:resizer",
+    [UI_BUTTON] = "draw:button",
+    [UI_SCROLL_VIEW] = "draw:scroll_view",
+    [UI_TEXT_AREA] = "draw:text_area",
+};
+#endif
+
+static void draw_contents(UIElement ui_element, UIRect clip) {
+    if (ui_element->callback->ui_draw) {
+        PROFILE_SCOPE(draw_scope_names[ui_element->type]);
+        set_scissor(clip);
+        ui_element->callback->ui_draw(ui_element);
+    }
+    for (int i = 0; i < ui_element->child_count; i++)
+        draw_element(ui_element->children[i], clip);
+}
+
+static bool refresh_cache(UIElement ui_element) {
+    struct UIRenderCache* cache = ui_element->cache;
+    const struct RenderBackend* backend = render_current_backend();
+    UIRect rect = element_rect(ui_element);
+    if (cache->target && (cache->backend != backend ||
+                          cache->width != rect.w || cache->height != rect.h)) {
+        cache->backend->free_target(cache->target);
+        cache->target = NULL;
+    }
+    if (!cache->target) {
+        cache->target = render_create_target(rect.w, rect.h);
+        if (!cache->target)
+            return false;
+        cache->backend = backend;
+        cache->width = rect.w;
+        cache->height = rect.h;
+        cache->valid = false;
+    }
+    if (cache->valid && cache->epoch == cache_epoch)
+        return true;
+    // the whole subtree is rendered, not just the damaged part of it
+    render_begin_target(cache->target, rect.x, rect.y);
+    cache_rendering = true;
+    scissor_known = false;
+    draw_contents(ui_element, rect);
+    cache_rendering = false;
+    render_end_target();
+    scissor_known = false;
+    cache->valid = true;
+    cache->epoch = cache_epoch;
+    return true;
+}
+
+// children are clipped to their parent, so a subtree outside its clip is skipped whole
+static void draw_element(UIElement ui_element, UIRect parent_clip) {
+    UIRect clip;
+    if (!intersect_rect(element_rect(ui_element), parent_clip, &clip))
+        return;
+    if (ui_element->cache && !cache_rendering && render_supports_targets() &&
+        refresh_cache(ui_element)) {
+        set_scissor(clip);
+        render_draw_target(ui_element->cache->target, ui_element->_x, ui_element->_y);
+        return;
+    }
+    draw_contents(ui_element, clip);
+}
+
+void ui_draw(UIElement ui_element) {
+    PROFILE_SCOPE("ui_draw");
+    if (!ui_element->parent)
+        ui_relayout(ui_element);
+    // the caller may have moved the scissor box since the last draw
+    scissor_known = false;
+    UIElement root = tree_root(ui_element);
+    draw_element(ui_element, draw_clip_active ? draw_clip :
+                 (UIRect) {0, 0, root->layout_w, root->layout_h});
+    render_flush();
+    if (draw_clip_active)
+        render_set_clip(draw_clip.x, draw_clip.y, draw_clip.w, draw_clip.h);
+    else
+        render_disable_clip();
+}
+
+void ui_draw_region(UIElement ui_element, UIRect region) {
+    draw_clip_active = true;
+    draw_clip = region;
+    ui_draw(ui_element);
+    draw_clip_active = false;
+}
+
+void ui_resize(UIElement ui_element, int window_w, int window_h) {
+    PROFILE_SCOPE("ui_resize");
+    note_window(window_w, window_h);
+    bool width_changed = ui_element->layout_w != window_w;
+    bool height_changed = ui_element->layout_h != window_h;
+    ui_element->layout_w = window_w;
+    ui_element->layout_h = window_h;
+    if (width_changed || height_changed)
+        mark_window_dependents(ui_element, width_changed, height_changed);
+    relayout(ui_element, &(struct UILayoutContext) {window_w, window_h});
+}
+
+void ui_relayout(UIElement ui_element) {
+    UIElement root = tree_root(ui_element);
+    relayout(ui_element, &(struct UILayoutContext) {root->layout_w, root->layout_h});
+}
+
+void ui_set_layout_threads(int threads) {
+    if (threads == layout_threads)
+        return;
+    stop_layout_pool();
+    layout_threads = MAX(threads, 0);
+}
+
+void ui_layout_store_gather(UIElement ui_element, UILayoutStore store) {
+    layout_store_clear(store);
+    layout_store_begin_level(store);
+    layout_store_push(store, ui_element, &ui_element->transform);
+    // the previous level doubles as the queue for the next one
+    for (int level = 0; level < store->level_count; level++) {
+        int end = store->level_start[level + 1];
+        bool started = false;
+        for (int i = store->level_start[level]; i < end; i++) {
+            UIElement parent = store->elements[i];
+            for (int c = 0; c < parent->child_count; c++) {
+                if (!started) {
+                    layout_store_begin_level(store);
+                    started = true;
+                }
+                layout_store_push(store, parent->children[c], &parent->children[c]->transform);
+            }
+        }
+    }
+}
+
+void ui_layout_store_apply(UILayoutStore store, int window_w, int window_h) {
+    note_window(window_w, window_h);
+    for (int level = 0; level < store->level_count; level++) {
+        int first = store->level_start[level];
+        layout_store_compute(store, first, store->level_start[level + 1] - first,
+                             window_w, window_h);
+    }
+    for (int i = 0; i < store->count; i++) {
+        UIElement ui_element = store->elements[i];
+        UIRect old = element_rect(ui_element);
+        ui_element->_x = store->out_x[i];
+        ui_element->_y = store->out_y[i];
+        ui_element->_w = store->out_w[i];
+        ui_element->_h = store->out_h[i];
+        ui_element->layout_dirty = false;
+        ui_element->subtree_dirty = false;
+        ui_element->layout_w = window_w;
+        ui_element->layout_h = window_h;
+        layout_counter++;
+        UIRect new = element_rect(ui_element);
+        if (old.x != new.x || old.y != new.y || old.w != new.w || old.h != new.h)
+            element_moved(ui_element, old, new);
+    }
+    // hooks like resizer positioning read the rects of other elements
+    for (int i = 0; i < store->count; i++) {
+        UIElement ui_element = store->elements[i];
+        if (!ui_element->callback->ui_resize)
+            continue;
+        UIRect old = element_rect(ui_element);
+        ui_element->callback->ui_resize(ui_element, window_w, window_h);
+        UIRect new = element_rect(ui_element);
+        if (old.x != new.x || old.y != new.y || old.w != new.w || old.h != new.h)
+            element_moved(ui_element, old, new);
+    }
+}
+
+int ui_take_layout_count(void) {
+    int count = layout_counter;
+    layout_counter = 0;
+    return count;
+}
+
+static bool has_pointer_handler(UIElement ui_element) {
+    const struct UICallbackTable* callback = ui_element->callback;
+    return callback->ui_mouse_down || callback->ui_mouse_up ||
+           callback->ui_mouse_moved || callback->ui_scroll;
+}
+
+// unlike intersect_rect an empty result is kept, with a negative size nothing is inside it
+static UIRect clip_rect(UIRect a, UIRect b) {
+    int x0 = MAX(a.x, b.x);
+    int y0 = MAX(a.y, b.y);
+    return (UIRect) {x0, y0, MIN(a.x + a.w, b.x + b.w) - x0, MIN(a.y + a.h, b.y + b.h) - y0};
+}
+
+static bool inside_clip(UIRect clip, int x, int y) {
+    return x >= clip.x && y >= clip.y && x <= clip.x + clip.w && y <= clip.y + clip.h;
+}
+
+// keys follow draw order, every element also knows its clip and the closest handler above it
+static void index_elements(struct UIHitGrid* grid, UIElement ui_element, UIRect clip, int handler) {
+    int key = grid->count++;
+    grid->order[key] = ui_element;
+    grid->rects[key] = element_rect(ui_element);
+    grid->clip[key] = clip;
+    grid->handler[key] = handler;
+    grid->bounds = key ? union_rect(grid->bounds, grid->rects[key]) : grid->rects[key];
+    ui_element->hit_key = key;
+    clip = clip_rect(clip, grid->rects[key]);
+    if (has_pointer_handler(ui_element))
+        handler = key;
+    for (int i = 0; i < ui_element->child_count; i++)
+        index_elements(grid, ui_element->children[i], clip, handler);
+}
+
+// the finest level has about one cell per element, every next one has cells twice as big
+static void size_levels(struct UIHitGrid* grid) {
+    int w = MAX(grid->bounds.w, 0), h = MAX(grid->bounds.h, 0);
+    int cell_size = UI_HIT_MIN_CELL;
+    while (cell_size < INT_MAX / 4 && (long) (w / cell_size + 1) * (h / cell_size + 1) > grid->count)
+        cell_size *= 2;
+    grid->level_count = 0;
+    grid->cell_count = 0;
+    for (;;) {
+        struct UIHitLevel* level = &grid->levels[grid->level_count++];
+        level->cell_size = cell_size;
+        level->cols = w / cell_size + 1;
+        level->rows = h / cell_size + 1;
+        level->first_cell = grid->cell_count;
+        level->elements = 0;
+        grid->cell_count += level->cols * level->rows;
+        if (MAX(w, h) <= UI_HIT_SPAN * (long) cell_size || grid->level_count == UI_HIT_LEVELS ||
+            cell_size >= INT_MAX / 4)
+            return;
+        cell_size *= 2;
+    }
+}
+
+// cells of the level where rect spans at most UI_HIT_SPAN of them along each axis
+static struct UIHitLevel* cell_range(struct UIHitGrid* grid, UIRect rect,
+                                     int* c0, int* r0, int* c1, int* r1) {
+    int extent = MAX(rect.w, rect.h);
+    struct UIHitLevel* level = grid->levels;
+    while (level < grid->levels + grid->level_count - 1 && extent > UI_HIT_SPAN * (long) level->cell_size)
+        level++;
+    // point_inside accepts the far edge too, so the range is inclusive
+    *c0 = CLAMP(0, level->cols - 1, (rect.x - grid->bounds.x) / level->cell_size);
+    *r0 = CLAMP(0, level->rows - 1, (rect.y - grid->bounds.y) / level->cell_size);
+    *c1 = CLAMP(0, level->cols - 1, (rect.x + MAX(rect.w, 0) - grid->bounds.x) / level->cell_size);
+    *r1 = CLAMP(0, level->rows - 1, (rect.y + MAX(rect.h, 0) - grid->bounds.y) / level->cell_size);
+    return level;
+}
+
+// the array with room for needed items, NULL with the old one left as it was
+static void* grow_grid_array(void* array, int needed, int* capacity, size_t item_size) {
+    if (needed <= *capacity)
+        return array;
+    int grown = MAX(needed, *capacity * 2);
+    void* copy = realloc(array, item_size * grown);
+    if (!copy) {
+        printf("[UI][ERROR] out of memory while building a hit grid\n");
+        return NULL;
+    }
+    *capacity = grown;
+    return copy;
+}
+
+static bool reserve_elements(struct UIHitGrid* grid, int count) {
+    int capacity = grid->element_capacity;
+    UIElement* order = grow_grid_array(grid->order, count, &capacity, sizeof(UIElement));
+    if (order)
+        grid->order = order;
+    capacity = grid->element_capacity;
+    UIRect* rects = grow_grid_array(grid->rects, count, &capacity, sizeof(UIRect));
+    if (rects)
+        grid->rects = rects;
+    capacity = grid->element_capacity;
+    UIRect* clip = grow_grid_array(grid->clip, count, &capacity, sizeof(UIRect));
+    if (clip)
+        grid->clip = clip;
+    capacity = grid->element_capacity;
+    int* handler = grow_grid_array(grid->handler, count, &capacity, sizeof(int));
+    if (!order || !rects || !clip || !handler)
+        return false;
+    grid->handler = handler;
+    grid->element_capacity = capacity;
+    return true;
+}
+
+static bool reserve_cells(struct UIHitGrid* grid) {
+    struct UIHitCell* cells = grow_grid_array(grid->cells, grid->cell_count + 1, &grid->cell_capacity,
+                                              sizeof(struct UIHitCell));
+    if (!cells)
+        return false;
+    grid->cells = cells;
+    return true;
+}
+
+static void release_hit_grid(struct UIHitGrid* grid) {
+    free(grid->order);
+    free(grid->rects);
+    free(grid->clip);
+    free(grid->handler);
+    free(grid->cells);
+    free(grid->keys);
+    free(grid);
+}
+
+static void free_hit_grid(UIElement ui_element) {
+    struct UIHitGrid* grid = ui_element->hit_grid;
+    if (!grid)
+        return;
+    struct UIHitGrid** link = &hit_grids;
+    while (*link != grid)
+        link = &(*link)->next;
+    *link = grid->next;
+    release_hit_grid(grid);
+    ui_element->hit_grid = NULL;
+}
+
+// buckets the tree in draw order, a cell gets some spare room for elements moving in later
+static bool build_hit_grid(UIElement root) {
+    struct UIHitGrid* grid = root->hit_grid;
+    if (!grid) {
+        grid = calloc(1, sizeof(struct UIHitGrid));
+        if (!grid) {
+            printf("[UI][ERROR] out of memory while building a hit grid\n");
+            return false;
+        }
+        grid->next = hit_grids;
+        hit_grids = grid;
+        root->hit_grid = grid;
+    }
+    grid->stale = true;
+    grid->moves = 0;
+    grid->count = 0;
+    if (!reserve_elements(grid, root->subtree_size))
+        return false;
+    index_elements(grid, root, element_rect(root), -1);
+    size_levels(grid);
+    if (!reserve_cells(grid))
+        return false;
+    struct UIHitCell* cells = grid->cells;
+    memset(cells, 0, sizeof(struct UIHitCell) * (grid->cell_count + 1));
+    int c0, r0, c1, r1;
+    for (int key = 0; key < grid->count; key++) {
+        struct UIHitLevel* level = cell_range(grid, grid->rects[key], &c0, &r0, &c1, &r1);
+        level->elements++;
+        for (int r = r0; r <= r1; r++)
+            for (int c = c0; c <= c1; c++)
+                cells[level->first_cell + r * level->cols + c].used++;
+    }
+    for (int i = 0; i < grid->cell_count; i++) {
+        cells[i + 1].start = cells[i].start + cells[i].used + cells[i].used / UI_HIT_SLACK + 1;
+        cells[i].used = 0;
+    }
+    int* keys = grow_grid_array(grid->keys, cells[grid->cell_count].start, &grid->key_capacity, sizeof(int));
+    if (!keys)
+        return false;
+    grid->keys = keys;
+    for (int key = 0; key < grid->count; key++) {
+        struct UIHitLevel* level = cell_range(grid, grid->rects[key], &c0, &r0, &c1, &r1);
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                struct UIHitCell* cell = &cells[level->first_cell + r * level->cols + c];
+                keys[cell->start + cell->used++] = key;
+            }
+        }
+    }
+    grid->stale = false;
+    return true;
+}
+
+// the first slot in the cell whose key is not below key
+static int cell_slot(struct UIHitGrid* grid, struct UIHitCell* cell, int key) {
+    int lo = cell->start, hi = lo + cell->used;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (grid->keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static bool grid_remove(struct UIHitGrid* grid, int key) {
+    int c0, r0, c1, r1;
+    struct UIHitLevel* level = cell_range(grid, grid->rects[key], &c0, &r0, &c1, &r1);
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            struct UIHitCell* cell = &grid->cells[level->first_cell + r * level->cols + c];
+            int slot = cell_slot(grid, cell, key);
+            int end = cell->start + cell->used;
+            if (slot == end || grid->keys[slot] != key)
+                return false;
+            memmove(grid->keys + slot, grid->keys + slot + 1, sizeof(int) * (end - slot - 1));
+            cell->used--;
+        }
+    }
+    level->elements--;
+    return true;
+}
+
+static bool grid_insert(struct UIHitGrid* grid, int key) {
+    int c0, r0, c1, r1;
+    struct UIHitLevel* level = cell_range(grid, grid->rects[key], &c0, &r0, &c1, &r1);
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            struct UIHitCell* cell = &grid->cells[level->first_cell + r * level->cols + c];
+            int end = cell->start + cell->used;
+            if (end == cell[1].start)
+                return false;
+            int slot = cell_slot(grid, cell, key);
+            memmove(grid->keys + slot + 1, grid->keys + slot, sizeof(int) * (end - slot));
+            grid->keys[slot] = key;
+            cell->used++;
+        }
+    }
+    level->elements++;
+    return true;
+}
+
+static bool grid_holds(struct UIHitGrid* grid, UIElement ui_element) {
+    int key = ui_element->hit_key;
+    return !grid->stale && key >= 0 && key < grid->count && grid->order[key] == ui_element;
+}
+
+static bool rect_within(UIRect rect, UIRect bounds) {
+    return rect.x >= bounds.x && rect.y >= bounds.y &&
+           rect.x + MAX(rect.w, 0) <= bounds.x + bounds.w &&
+           rect.y + MAX(rect.h, 0) <= bounds.y + bounds.h;
+}
+
+// moves the element between the cells of its old and new rect, the tree keeps its shape
+static void hit_grid_moved(struct UIHitGrid* grid, UIElement ui_element) {
+    if (grid->stale)
+        return;
+    UIRect rect = element_rect(ui_element);
+    // past this many moves between two hit tests a rebuild is cheaper,
+    // and the clips of everything below a moved parent change with it
+    if (!grid_holds(grid, ui_element) || ui_element->child_count || !rect_within(rect, grid->bounds) ||
+        ++grid->moves > grid->count / 2 + UI_HIT_MIN_MOVES) {
+        grid->stale = true;
+        return;
+    }
+    int key = ui_element->hit_key;
+    if (!grid_remove(grid, key)) {
+        grid->stale = true;
+        return;
+    }
+    grid->rects[key] = rect;
+    // a full cell takes a rebuild, which gives every cell room again
+    if (!grid_insert(grid, key))
+        grid->stale = true;
+}
+
+static struct UIHitGrid* fresh_hit_grid(UIElement root) {
+    ui_relayout(root);
+    if ((!root->hit_grid || root->hit_grid->stale) && !build_hit_grid(root))
+        return NULL;
+    root->hit_grid->moves = 0;
+    return root->hit_grid;
+}
+
+UIElement ui_hit_test(UIElement ui_element, int x, int y) {
+    struct UIHitGrid* grid = fresh_hit_grid(ui_element);
+    if (!grid || x < grid->bounds.x || y < grid->bounds.y)
+        return NULL;
+    // every level has its own topmost hit, the one drawn last wins
+    int best = -1;
+    for (int l = 0; l < grid->level_count; l++) {
+        struct UIHitLevel* level = &grid->levels[l];
+        // long, bounds stretched by an element far off screen may not fit an int
+        long c = ((long) x - grid->bounds.x) / level->cell_size;
+        long r = ((long) y - grid->bounds.y) / level->cell_size;
+        if (c >= level->cols || r >= level->rows)
+            return NULL;
+        if (!level->elements)
+            continue;
+        struct UIHitCell* cell = &grid->cells[level->first_cell + r * level->cols + c];
+        for (int i = cell->start + cell->used - 1; i >= cell->start && grid->keys[i] > best; i--) {
+            int key = grid->keys[i];
+            // parts clipped away by an ancestor, like overscan rows of a scroll view, are not hit
+            if (inside_rect(grid->rects[key], x, y) && inside_clip(grid->clip[key], x, y)) {
+                best = key;
+                break;
+            }
+        }
+    }
+    return best >= 0 ? grid->order[best] : NULL;
+}
+
+// events bubble past elements without any pointer handler in one step
+static UIElement bubble(UIElement root, UIElement target) {
+    struct UIHitGrid* grid = root->hit_grid;
+    if (!grid || !grid_holds(grid, target))
+        return target->parent;
+    int key = grid->handler[target->hit_key];
+    return key >= 0 ? grid->order[key] : NULL;
+}
+
+static bool in_tree(UIElement ui_element, UIElement root) {
+    if (root->hit_grid && !root->hit_grid->stale)
+        return grid_holds(root->hit_grid, ui_element);
+    for (; ui_element; ui_element = ui_element->parent)
+        if (ui_element == root)
+            return true;
+    return false;
+}
+
+void ui_capture_pointer(UIElement ui_element) {
+    pointer_capture = ui_element;
+}
+
+void ui_release_pointer(UIElement ui_element) {
+    if (pointer_capture == ui_element)
+        pointer_capture = NULL;
+}
+
+UIElement ui_pointer_capture(void) {
+    return pointer_capture;
+}
+
+void ui_mouse_down(UIElement ui_element, int button, int x, int y) {
+    PROFILE_SCOPE("ui_mouse_down");
+    UIElement capture = pointer_capture;
+    UIElement target = ui_hit_test(ui_element, x, y);
+    if (capture && capture != target && in_tree(capture, ui_element) &&
+        capture->callback->ui_mouse_down)
+        capture->callback->ui_mouse_down(capture, button, x, y);
+    // unhandled events bubble up to the closest ancestor with a handler
+    while (target && !target->callback->ui_mouse_down)
+        target = bubble(ui_element, target);
+    if (target)
+        target->callback->ui_mouse_down(target, button, x, y);
+}
+
+void ui_mouse_up(UIElement ui_element, int button, int x, int y) {
+    PROFILE_SCOPE("ui_mouse_up");
+    UIElement capture = pointer_capture;
+    UIElement target = ui_hit_test(ui_element, x, y);
+    if (capture && capture != target && in_tree(capture, ui_element) &&
+        capture->callback->ui_mouse_up)
+        capture->callback->ui_mouse_up(capture, button, x, y);
+    while (target && !target->callback->ui_mouse_up)
+        target = bubble(ui_element, target);
+    if (target)
+        target->callback->ui_mouse_up(target, button, x, y);
+}
+
+void ui_mouse_moved(UIElement ui_element, int x, int y) {
+    PROFILE_SCOPE("ui_mouse_moved");
+    UIElement target = pointer_capture;
+    // while the pointer is captured, moves only go to the capturing element
+    if (target && !in_tree(target, ui_element))
+        return;
+    if (!target)
+        target = ui_hit_test(ui_element, x, y);
+    while (target && !target->callback->ui_mouse_moved)
+        target = bubble(ui_element, target);
+    if (target)
+        target->callback->ui_mouse_moved(target, x, y);
+}
+
+void ui_scroll(UIElement ui_element, double dx, double dy, int x, int y) {
+    PROFILE_SCOPE("ui_scroll");
+    UIElement target = ui_hit_test(ui_element, x, y);
+    while (target && !target->callback->ui_scroll)
+        target = bubble(ui_element, target);
+    if (target)
+        target->callback->ui_scroll(target, dx, dy);
+}
+
+void ui_set_parent(UIElement ui_element, UIElement parent) {
+    if (ui_element->parent) {
+        UIElement old_parent = ui_element->parent;
+        int i = 0;
+        while (old_parent->children[i] != ui_element)
+            i++;
+        memmove(old_parent->children + i, old_parent->children + i + 1,
+                sizeof(UIElement) * (old_parent->child_count - i - 1));
+        old_parent->child_count--;
+        add_subtree_size(old_parent, -ui_element->subtree_size);
+        invalidate_hit_grid(invalidate_caches(old_parent));
+    }
+    if (parent)
+        append_to_array(&parent->children, &parent->child_count,
+                        &parent->child_capacity, ui_element);
+    ui_element->parent = parent;
+    add_subtree_size(parent, ui_element->subtree_size);
+    if (parent) {
+        free_hit_grid(ui_element);
+        invalidate_hit_grid(tree_root(parent));
+    }
+    mark_layout_dirty(ui_element);
+    damage_element(ui_element);
+}
+
+UIElement ui_get_parent(UIElement ui_element) {
+    return ui_element->parent;
+}
+
+// resizers that outlive the element they are attached to stop following it
+static void forget_dependents(UIElement ui_element) {
+    for (int i = 0; i < ui_element->dependent_count; i++) {
+        struct UIResizer* resizer = GET_EXTENTION_DATA(ui_element->dependents[i], UI_RESIZER);
+        if (resizer->connected_item1 == ui_element)
+            resizer->connected_item1 = NULL;
+        if (resizer->connected_item2 == ui_element)
+            resizer->connected_item2 = NULL;
+    }
+    ui_element->dependent_count = 0;
+}
+
+static void free_element(UIElement ui_element) {
+    if (ui_element->callback->ui_free)
+        ui_element->callback->ui_free(ui_element);
+    forget_dependents(ui_element);
+    for (int i = 0; i < ui_element->child_count; i++)
+        free_element(ui_element->children[i]);
+    damage_element(ui_element);
+    if (pointer_capture == ui_element)
+        pointer_capture = NULL;
+    free_hit_grid(ui_element);
+    ui_set_cached(ui_element, false);
+    free_array(ui_element->children, ui_element->child_capacity);
+    free_array(ui_element->dependents, ui_element->dependent_capacity);
+    release_class(ui_element->style);
+    pool_free(&element_pools[ui_element->type], ui_element);
+}
+
+void ui_free(UIElement ui_element) {
+    if (ui_element->parent)
+        ui_set_parent(ui_element, NULL);
+    free_element(ui_element);
+}
+
+void ui_release_all(void) {
+    stop_layout_pool();
+    while (render_caches)
+        ui_set_cached(render_caches->owner, false);
+    while (hit_grids) {
+        struct UIHitGrid* next = hit_grids->next;
+        release_hit_grid(hit_grids);
+        hit_grids = next;
+    }
+    if (pools_ready) {
+        for (int type = 0; type < UI_TYPE_COUNT; type++)
+            pool_release(&element_pools[type]);
+        for (int i = 0; i < UI_ARRAY_CLASSES; i++)
+            pool_release(&array_pools[i]);
+        pool_release(&style_pool);
+    }
+    while (style_classes) {
+        UIStyleClass next = style_classes->next;
+        free(style_classes->name);
+        free(style_classes);
+        style_classes = next;
+    }
+    default_class = NULL;
+    pointer_capture = NULL;
+}
+
+void ui_memory_stats(size_t* live, size_t* peak, size_t* reserved) {
+    size_t pooled = heap_array_bytes;
+    if (pools_ready) {
+        for (int type = 0; type < UI_TYPE_COUNT; type++)
+            pooled += element_pools[type].reserved_bytes;
+        for (int i = 0; i < UI_ARRAY_CLASSES; i++)
+            pooled += array_pools[i].reserved_bytes;
+        pooled += style_pool.reserved_bytes;
+    }
+    if (live)
+        *live = pools_ready ? live_bytes() : 0;
+    if (peak)
+        *peak = peak_bytes;
+    if (reserved)
+        *reserved = pooled;
+}
+
+static int* find_param_i(UIElement ui_element, int param) {
+    switch (param) {
+    case UI_CHILD_COUNT:
         return &ui_element->child_count;
     case UI_MIN_WIDTH:
         return &ui_element->transform.min_w;
@@ -450,8 +2286,10 @@ static int* find_param_i(UIElement ui_element, int param) {
 
 void ui_set_i(UIElement ui_element, int param, int val) {
     int* ptr = find_param_i(ui_element, param);
-    if (ptr)
+    if (ptr) {
         *ptr = val;
+        mark_layout_dirty(ui_element);
+    }
     else
         printf("[UI][WARNING] trying to set invalid parameter set with type int\n");
 }
@@ -482,8 +2320,10 @@ static double* find_param_d(UIElement ui_element, int param) {
 
 void ui_set_d(UIElement ui_element, int param, double val) {
     double* ptr = find_param_d(ui_element, param);
-    if (ptr)
+    if (ptr) {
         *ptr = val;
+        mark_layout_dirty(ui_element);
+    }
     else
         printf("[UI][WARNING] trying to set invalid parameter set with type double\n");
 }
@@ -497,85 +2337,378 @@ double ui_get_d(UIElement ui_element, int param) {
     return 0;
 }
 
+void ui_set_transform(UIElement ui_element, UITransform transform) {
+    ui_element->transform = *transform;
+    mark_layout_dirty(ui_element);
+}
+
+// as of the last layout
+UIRect ui_get_rect(UIElement ui_element) {
+    return element_rect(ui_element);
+}
+
 UIStyleSheet ui_access_stylesheet(UIElement ui_element) {
-    return &ui_element->style;
+    // the sheet is handed out for writing, so its area has to be redrawn
+    damage_element(ui_element);
+    return writable_style(ui_element, UI_STYLE_ALL);
 }
 
-static void parse_param_as_int(int* out, const char* valstr) {
-    int val;
-    if (sscanf(valstr, "%d", &val) != 1) {
-        printf("[UI][WARNING] invalid value \"%s\"\n", valstr);
+void ui_override_style(UIElement ui_element, UIStyleSheet values, int fields) {
+    if (!fields)
         return;
-    }
-    *out = val;
+    UIStyleSheet sheet = writable_style(ui_element, fields);
+    if (fields & UI_STYLE_COLOR)
+        sheet->color = values->color;
+    if (fields & UI_STYLE_BACKGROUND_COLOR)
+        sheet->background_color = values->background_color;
+    if (fields & UI_STYLE_BORDER_COLOR)
+        sheet->border_color = values->border_color;
+    if (fields & UI_STYLE_BORDER_STRENGH)
+        sheet->border_strengh = values->border_strengh;
+    damage_element(ui_element);
+}
+
+struct UIStyleSheet ui_get_style(UIElement ui_element) {
+    return resolve_style(ui_element);
 }
 
-static void parse_param_as_double(double* out, const char* valstr) {
-    double val;
-    if (sscanf(valstr, "%lf", &val) != 1) {
-        printf("[UI][WARNING] invalid value \"%s\"\n", valstr);
+UIStyleClass ui_style_class(const char* name) {
+    UIStyleClass fallback = get_default_class();
+    for (UIStyleClass it = style_classes; it; it = it->next)
+        if (it->listed && strcmp(it->name, name) == 0)
+            return it;
+    // new classes start out as a copy of the default look
+    return create_class(name, &fallback->sheet);
+}
+
+void ui_style_class_update(UIStyleClass style_class, UIStyleSheet sheet) {
+    style_class->sheet = *sheet;
+    ui_damage(0, 0, screen_w, screen_h);
+    cache_epoch++;
+}
+
+struct UIStyleSheet ui_style_class_get(UIStyleClass style_class) {
+    return style_class->sheet;
+}
+
+void ui_style_class_remove(UIStyleClass style_class) {
+    if (!style_class->listed)
         return;
+    style_class->listed = false;
+    if (style_class == default_class)
+        default_class = NULL;
+    release_class(style_class);
+}
+
+void ui_set_style_class(UIElement ui_element, UIStyleClass style_class) {
+    style_class->refs++;
+    release_class(ui_element->style);
+    ui_element->style = style_class;
+    damage_element(ui_element);
+}
+
+UIStyleClass ui_get_style_class(UIElement ui_element) {
+    UIStyleClass style = ui_element->style;
+    return style->name ? style : style->base;
+}
+
+void ui_set_cached(UIElement ui_element, bool cached) {
+    struct UIRenderCache* cache = ui_element->cache;
+    if (cached && !cache) {
+        cache = calloc(1, sizeof(struct UIRenderCache));
+        cache->owner = ui_element;
+        cache->next = render_caches;
+        render_caches = cache;
+        ui_element->cache = cache;
+    }
+    else if (!cached && cache) {
+        struct UIRenderCache** link = &render_caches;
+        while (*link != cache)
+            link = &(*link)->next;
+        *link = cache->next;
+        if (cache->target)
+            cache->backend->free_target(cache->target);
+        free(cache);
+        ui_element->cache = NULL;
+    }
+}
+
+void ui_invalidate(UIElement ui_element) {
+    damage_element(ui_element);
+    mark_layout_dirty(ui_element);
+}
+
+void ui_damage(int x, int y, int w, int h) {
+    add_damage(&damage_current, (UIRect) {x, y, w, h});
+}
+
+bool ui_has_damage(void) {
+    return damage_current.count > 0;
+}
+
+int ui_take_damage(UIRect out[UI_MAX_DAMAGE_RECTS]) {
+    // the back buffer still holds the frame before last, so whatever
+    // changed since then has to be repainted as well
+    struct UIDamage frame = damage_previous;
+    for (int i = 0; i < damage_current.count; i++)
+        add_damage(&frame, damage_current.rects[i]);
+    damage_previous = damage_current;
+    damage_current.count = 0;
+    for (int i = 0; i < frame.count; i++)
+        out[i] = frame.rects[i];
+    return frame.count;
+}
+
+enum StyleKey {
+    STYLE_X, STYLE_Y, STYLE_W, STYLE_H,
+    STYLE_MIN_W, STYLE_MAX_W, STYLE_MIN_H, STYLE_MAX_H, STYLE_OFF_X, STYLE_OFF_Y,
+    STYLE_COLOR, STYLE_BACKGROUND_COLOR, STYLE_BORDER_COLOR,
+    STYLE_BORDER_STRENGH,
+    STYLE_INVALID
+};
+
+struct StyleDecl {
+    enum StyleKey key;
+    union {
+        double d;
+        int i;
+        color32 c;
+    };
+};
+
+#define KEY_IS(key, literal) (memcmp(key, literal, sizeof(literal) - 1) == 0)
+
+// dispatches on length and one or two distinguishing characters, then confirms
+static enum StyleKey style_key(const char* key, int length) {
+    enum StyleKey candidate = STYLE_INVALID;
+    switch (length) {
+    case 1:
+        switch (key[0]) {
+        case 'x': return STYLE_X;
+        case 'y': return STYLE_Y;
+        case 'w': return STYLE_W;
+        case 'h': return STYLE_H;
+        default: return STYLE_INVALID;
+        }
+    case 5:
+        switch (key[0] + (key[4] << 8)) {
+        case 'm' + ('w' << 8): candidate = key[1] == 'i' ? STYLE_MIN_W : STYLE_MAX_W; break;
+        case 'm' + ('h' << 8): candidate = key[1] == 'i' ? STYLE_MIN_H : STYLE_MAX_H; break;
+        case 'o' + ('x' << 8): candidate = STYLE_OFF_X; break;
+        case 'o' + ('y' << 8): candidate = STYLE_OFF_Y; break;
+        case 'c' + ('r' << 8): candidate = STYLE_COLOR; break;
+        default: return STYLE_INVALID;
+        }
+        break;
+    case 12:
+        candidate = STYLE_BORDER_COLOR;
+        break;
+    case 14:
+    case 15:
+        candidate = STYLE_BORDER_STRENGH;
+        break;
+    case 16:
+        candidate = STYLE_BACKGROUND_COLOR;
+        break;
+    default:
+        return STYLE_INVALID;
+    }
+    static const char* const names[] = {
+        [STYLE_MIN_W] = "min_w", [STYLE_MAX_W] = "max_w",
+        [STYLE_MIN_H] = "min_h", [STYLE_MAX_H] = "max_h",
+        [STYLE_OFF_X] = "off_x", [STYLE_OFF_Y] = "off_y",
+        [STYLE_COLOR] = "color",
+        [STYLE_BACKGROUND_COLOR] = "background_color",
+        [STYLE_BORDER_COLOR] = "border_color",
+    };
+    if (candidate == STYLE_BORDER_STRENGH)
+        return (length == 14 && KEY_IS(key, "border_strengh")) ||
+               (length == 15 && KEY_IS(key, "border_strength")) ? candidate : STYLE_INVALID;
+    return memcmp(key, names[candidate], length) == 0 ? candidate : STYLE_INVALID;
+}
+
+#undef KEY_IS
+
+static bool parse_int(const char* str, const char* end, int* out) {
+    bool negative = str < end && *str == '-';
+    if (str < end && (*str == '-' || *str == '+'))
+        str++;
+    if (str == end)
+        return false;
+    long long val = 0;
+    for (; str < end; str++) {
+        if (*str < '0' || *str > '9')
+            return false;
+        val = val * 10 + (*str - '0');
+        if (val > (long long) INT_MAX + 1)
+            return false;
     }
+    val = negative ? -val : val;
+    if (val > INT_MAX)
+        return false;
     *out = val;
+    return true;
 }
 
-static void parse_param_as_color(color32* out, const char* valstr) {
-    char val[8] = "000000FF";
-    if (sscanf(valstr, "%8c", val) != 1 || sscanf(valstr, "%6c", val) != 1) {
-        printf("[UI][WARNING] invalid value \"%s\"\n", valstr);
-        return;
+static bool parse_double(const char* str, const char* end, double* out) {
+    char* parsed;
+    // the value is followed by ';', whitespace or the terminator, all of which stop strtod
+    double val = strtod(str, &parsed);
+    if (parsed != end || str == end)
+        return false;
+    *out = val;
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// RRGGBB or RRGGBBAA, optionally prefixed by '#'; alpha defaults to FF
+static bool parse_color(const char* str, const char* end, color32* out) {
+    if (str < end && *str == '#')
+        str++;
+    int digits = end - str;
+    if (digits != 6 && digits != 8)
+        return false;
+    color32 color = color32(0, 0, 0, 0xff);
+    for (int i = 0; i < digits; i += 2) {
+        int hi = hex_value(str[i]);
+        int lo = hex_value(str[i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        color.rgba[i >> 1] = (hi << 4) | lo;
     }
-    for (int i = 0; i < 4; i++) {
-        int p = i << 1;
-        out->rgba[i] = (val[p] << 4) + val[p+1];
+    *out = color;
+    return true;
+}
+
+static bool is_style_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_key_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+// reads the next valid declaration in place, warning about and skipping broken ones
+static bool next_style_decl(const char** cursor, struct StyleDecl* decl) {
+    const char* p = *cursor;
+    for (;;) {
+        while (*p == ';' || is_style_space(*p))
+            p++;
+        if (!*p) {
+            *cursor = p;
+            return false;
+        }
+        const char* decl_start = p;
+        const char* key = p;
+        while (is_key_char(*p))
+            p++;
+        int key_length = p - key;
+        while (is_style_space(*p))
+            p++;
+        bool has_equals = *p == '=';
+        if (has_equals)
+            p++;
+        while (is_style_space(*p))
+            p++;
+        const char* value = p;
+        while (*p && *p != ';')
+            p++;
+        const char* value_end = p;
+        while (value_end > value && is_style_space(value_end[-1]))
+            value_end--;
+        if (!key_length || !has_equals || value == value_end) {
+            printf("[UI][WARNING] invalid style format \"%.*s\"\n", (int) (p - decl_start), decl_start);
+            continue;
+        }
+        decl->key = style_key(key, key_length);
+        bool valid;
+        switch (decl->key) {
+        case STYLE_X: case STYLE_Y: case STYLE_W: case STYLE_H:
+            valid = parse_double(value, value_end, &decl->d);
+            break;
+        case STYLE_COLOR: case STYLE_BACKGROUND_COLOR: case STYLE_BORDER_COLOR:
+            valid = parse_color(value, value_end, &decl->c);
+            break;
+        case STYLE_INVALID:
+            printf("[UI][WARNING] invalid style name \"%.*s\"\n", key_length, key);
+            continue;
+        default:
+            valid = parse_int(value, value_end, &decl->i);
+            break;
+        }
+        if (!valid) {
+            printf("[UI][WARNING] invalid value \"%.*s\"\n", (int) (value_end - value), value);
+            continue;
+        }
+        *cursor = p;
+        return true;
     }
 }
 
-static void parse_single_style(UIElement ui_element, const char* style) {
-    char key[256], val[256];
-    if (sscanf(style, " %255[a-zA-Z0-9_] = %255s ", key, val) != 2) {
-        printf("[UI][WARNING] invalid style format \"%s\"\n", style);
-        return;
+static void apply_style_decl(UIElement ui_element, const struct StyleDecl* decl) {
+    struct UITransform* t = &ui_element->transform;
+    switch (decl->key) {
+    case STYLE_X: t->x = decl->d; break;
+    case STYLE_Y: t->y = decl->d; break;
+    case STYLE_W: t->w = decl->d; break;
+    case STYLE_H: t->h = decl->d; break;
+    case STYLE_MIN_W: t->min_w = decl->i; break;
+    case STYLE_MAX_W: t->max_w = decl->i; break;
+    case STYLE_MIN_H: t->min_h = decl->i; break;
+    case STYLE_MAX_H: t->max_h = decl->i; break;
+    case STYLE_OFF_X: t->off_x = decl->i; break;
+    case STYLE_OFF_Y: t->off_y = decl->i; break;
+    case STYLE_COLOR: writable_style(ui_element, UI_STYLE_COLOR)->color = decl->c; break;
+    case STYLE_BACKGROUND_COLOR:
+        writable_style(ui_element, UI_STYLE_BACKGROUND_COLOR)->background_color = decl->c;
+        break;
+    case STYLE_BORDER_COLOR: writable_style(ui_element, UI_STYLE_BORDER_COLOR)->border_color = decl->c; break;
+    case STYLE_BORDER_STRENGH:
+        writable_style(ui_element, UI_STYLE_BORDER_STRENGH)->border_strengh = decl->i;
+        break;
+    case STYLE_INVALID: break;
     }
-    if (strcmp(key, "x") == 0)
-        parse_param_as_double(&ui_element->transform.x, val);
-    else if (strcmp(key, "y") == 0)
-        parse_param_as_double(&ui_element->transform.y, val);
-    else if (strcmp(key, "w") == 0)
-        parse_param_as_double(&ui_element->transform.w, val);
-    else if (strcmp(key, "h") == 0)
-        parse_param_as_double(&ui_element->transform.h, val);
-    else if (strcmp(key, "min_w") == 0)
-        parse_param_as_int(&ui_element->transform.min_w, val);
-    else if (strcmp(key, "max_w") == 0)
-        parse_param_as_int(&ui_element->transform.max_w, val);
-    else if (strcmp(key, "min_h") == 0)
-        parse_param_as_int(&ui_element->transform.min_h, val);
-    else if (strcmp(key, "max_h") == 0)
-        parse_param_as_int(&ui_element->transform.max_h, val);
-    else if (strcmp(key, "off_x") == 0)
-        parse_param_as_int(&ui_element->transform.off_x, val);
-    else if (strcmp(key, "off_y") == 0)
-        parse_param_as_int(&ui_element->transform.off_y, val);
-    else if (strcmp(key, "color") == 0)
-        parse_param_as_color(&ui_element->style.color, val);
-    else if (strcmp(key, "background_color") == 0)
-        parse_param_as_color(&ui_element->style.background_color, val);
-    else if (strcmp(key, "border_color") == 0)
-        parse_param_as_color(&ui_element->style.border_color, val);
-    else if (strcmp(key, "border_strengh") == 0)
-        parse_param_as_int(&ui_element->style.border_strengh, val);
-    else
-        printf("[UI][WARNING] invalid style name \"%s\"\n", key);
 }
 
 void ui_parse_style(UIElement ui_element, const char* style) {
-    char* copy = malloc(strlen(style) + 1);
-    strcpy(copy, style);
-    char* strtok_r_state;
-    char* current = strtok_r(copy, ";", &strtok_r_state);
-    do  {
-        parse_single_style(ui_element, current);
-    } while((current = strtok_r(NULL, ";", &strtok_r_state)));
-    free(copy);
-}
\ No newline at end of file
+    struct StyleDecl decl;
+    while (next_style_decl(&style, &decl))
+        apply_style_decl(ui_element, &decl);
+    ui_invalidate(ui_element);
+}
+
+#define UI_STYLE_BATCH_DECLS 32
+
+void ui_parse_style_batch(UIElement* ui_elements, const char* const* styles, int count) {
+    struct StyleDecl decls[UI_STYLE_BATCH_DECLS];
+    const char* parsed = NULL;
+    int decl_count = 0;
+    for (int i = 0; i < count; i++) {
+        // runs of elements sharing one style string are parsed once
+        if (styles[i] != parsed) {
+            const char* cursor = styles[i];
+            decl_count = 0;
+            while (decl_count < UI_STYLE_BATCH_DECLS && next_style_decl(&cursor, &decls[decl_count]))
+                decl_count++;
+            parsed = *cursor ? NULL : styles[i];
+            if (!parsed) {
+                // too long to cache, fall back to streaming this one
+                ui_parse_style(ui_elements[i], styles[i]);
+                continue;
+            }
+        }
+        for (int d = 0; d < decl_count; d++)
+            apply_style_decl(ui_elements[i], &decls[d]);
+        ui_invalidate(ui_elements[i]);
+    }
+}
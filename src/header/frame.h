@@ -0,0 +1,34 @@
+#ifndef FRAME_H
+#define FRAME_H
+#include <stdbool.h>
+
+struct FrameStats {
+    unsigned long frames;
+    unsigned long wakeups;
+    double busy_seconds; // time spent outside of event waits
+    double idle_seconds; // time spent blocked in event waits
+    // over the most recent FRAME_STAT_WINDOW frames
+    double frame_ms_avg, frame_ms_p95, frame_ms_max;
+    double interval_ms_avg, interval_ms_p95, interval_ms_max;
+};
+
+#define FRAME_STAT_WINDOW 256
+
+void frame_init(bool vsync, double fps_cap);
+void frame_set_fps_cap(double fps_cap);
+// while any animation runs the loop wakes every frame slot instead of waiting for input
+void frame_begin_animation(void);
+void frame_end_animation(void);
+double frame_slot_interval(void);
+void frame_wake_at(double time);
+// from any thread, wakes the main loop, which takes the request before its next frame
+void frame_request_redraw(void);
+bool frame_take_redraw_request(void);
+bool frame_due(void);
+void frame_begin(void);
+void frame_end(void);
+void frame_wait(bool busy);
+void frame_stats(struct FrameStats* out);
+void frame_reset_stats(void);
+
+#endif
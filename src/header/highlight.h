@@ -0,0 +1,54 @@
+#ifndef HIGHLIGHT_H
+#define HIGHLIGHT_H
+#include <text_buffer.h>
+#include <types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Highlighter* Highlighter;
+
+enum HighlightKind {
+    HIGHLIGHT_PLAIN, HIGHLIGHT_KEYWORD, HIGHLIGHT_NUMBER, HIGHLIGHT_STRING,
+    HIGHLIGHT_COMMENT, HIGHLIGHT_DIRECTIVE, HIGHLIGHT_KIND_COUNT
+};
+
+// byte range of a line, the gaps between spans are plain
+typedef struct HighlightSpan {
+    uint16_t start, length;
+    uint8_t kind;
+} HighlightSpan;
+
+#define HIGHLIGHT_RING 128 // lines in flight to the worker
+#define HIGHLIGHT_MAX_LINE 4096 // the rest of a longer line is plain and keeps the state
+#define HIGHLIGHT_SHORT_LINE 256 // read first, most lines end within it
+#define HIGHLIGHT_MAX_SPANS 512
+#define HIGHLIGHT_CHAIN_BATCH 64 // most lines sent at once while catching up below an edit
+#define HIGHLIGHT_LOOKAHEAD 1000 // lines kept settled past the bottom of the view
+
+struct HighlightStats {
+    unsigned long lines_tokenized; // by the worker
+    unsigned long lines_reused; // sent, but found to still hold for their state
+    unsigned long results_dropped; // outdated by an edit before they arrived
+    size_t lines_settled; // from the top, correct for their state
+    size_t lines_tracked;
+};
+
+/*
+ * Tokenizes a buffer as C on a worker thread. The buffer is only touched on
+ * the calling thread, which hands line text over and takes spans back
+ * through single producer rings. notify is called from the worker when
+ * results are waiting, it may be NULL.
+ */
+Highlighter highlight_create(TextBuffer buffer, void (*notify)(void* user_data), void* user_data);
+void highlight_free(Highlighter highlighter);
+
+// takes the results in and sends more work, true when a visible line changed
+bool highlight_update(Highlighter highlighter);
+bool highlight_idle(Highlighter highlighter);
+void highlight_set_visible(Highlighter highlighter, size_t first_line, size_t count);
+// -1 until the line was tokenized once
+int highlight_line(Highlighter highlighter, size_t line, const HighlightSpan** spans);
+color32 highlight_color(enum HighlightKind kind);
+void highlight_stats(Highlighter highlighter, struct HighlightStats* out);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef INPUT_H
+#define INPUT_H
+#include <ui.h>
+#include <stdbool.h>
+
+typedef struct GLFWwindow GLFWwindow;
+
+enum InputEventType {
+    INPUT_MOUSE_MOVE, INPUT_MOUSE_DOWN, INPUT_MOUSE_UP, INPUT_SCROLL, INPUT_EVENT_TYPE_COUNT
+};
+
+typedef struct InputEvent {
+    enum InputEventType type;
+    double time; // glfwGetTime() of the first event folded into this one
+    int coalesced; // number of raw events folded into this one
+    int button;
+    int x, y; // ui coordinates, origin at the bottom left
+    double dx, dy; // summed wheel offsets of a scroll
+} InputEvent;
+
+enum InputCursor {
+    INPUT_CURSOR_ARROW, INPUT_CURSOR_RESIZE_EW, INPUT_CURSOR_RESIZE_NS, INPUT_CURSOR_COUNT
+};
+
+#define INPUT_QUEUE_SIZE 256
+
+void input_init(GLFWwindow* window);
+void input_release(void);
+
+// called from the GLFW callbacks, these only record the event
+void input_window_resized(int width, int height);
+void input_mouse_moved(double x, double y);
+void input_mouse_button(int button, bool pressed);
+void input_scroll(double dx, double dy);
+
+bool input_pending(void);
+int input_dispatch(UIElement* roots, int root_count);
+void input_request_cursor(enum InputCursor cursor);
+void input_stats(unsigned long* received, unsigned long* dispatched);
+
+#endif
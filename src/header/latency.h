@@ -0,0 +1,27 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+#include <input.h>
+#include <ui.h>
+#include <stdbool.h>
+
+// input-to-present histograms, one per input event type
+#define LATENCY_BIN_MS 0.25
+#define LATENCY_BINS 1024 // slower samples land in the last bin
+#define LATENCY_PENDING_MAX INPUT_QUEUE_SIZE
+
+struct LatencySummary {
+    unsigned long count;
+    double avg_ms, p50_ms, p95_ms, p99_ms, max_ms;
+};
+
+void latency_dispatched(enum InputEventType type, double event_time);
+void latency_discard(void);
+bool latency_presented(double present_time);
+void latency_summary(enum InputEventType type, struct LatencySummary* out);
+void latency_reset(void);
+
+UIRect latency_overlay_rect(int frame_w, int frame_h);
+void latency_draw_overlay(int frame_w, int frame_h);
+bool latency_dump(const char* path);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+#include <ui.h>
+
+typedef struct UILayout* UILayout;
+
+UILayout layout_load(const char* path, int window_w, int window_h);
+bool layout_compile(const char* source, const char* target);
+UIElement layout_find(UILayout layout, const char* name);
+int layout_root_count(UILayout layout);
+UIElement layout_root(UILayout layout, int index);
+void layout_free(UILayout layout);
+
+#endif
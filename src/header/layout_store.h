@@ -0,0 +1,40 @@
+#ifndef LAYOUT_STORE_H
+#define LAYOUT_STORE_H
+#include <ui.h>
+
+typedef struct UILayoutStore {
+    int count;
+    int capacity;
+    double* x;
+    double* y;
+    double* w;
+    double* h;
+    int* off_x;
+    int* off_y;
+    int* min_w;
+    int* max_w;
+    int* min_h;
+    int* max_h;
+    int* out_x;
+    int* out_y;
+    int* out_w;
+    int* out_h;
+    UIElement* elements;
+    int* level_start; // level i spans [level_start[i], level_start[i + 1])
+    int level_count;
+    int level_capacity;
+}* UILayoutStore;
+
+UILayoutStore layout_store_create(void);
+void layout_store_clear(UILayoutStore store);
+void layout_store_reserve(UILayoutStore store, int capacity);
+int layout_store_push(UILayoutStore store, UIElement element, UITransform transform);
+void layout_store_begin_level(UILayoutStore store);
+void layout_store_compute(UILayoutStore store, int first, int count,
+                          int window_w, int window_h);
+void layout_store_compute_scalar(UILayoutStore store, int first, int count,
+                                 int window_w, int window_h);
+const char* layout_store_kernel_name(void);
+void layout_store_free(UILayoutStore store);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef POOL_H
+#define POOL_H
+#include <stddef.h>
+
+struct PoolChunk;
+
+typedef struct Pool {
+    size_t block_size;
+    size_t chunk_blocks;
+    void* free_list;
+    struct PoolChunk* chunks;
+    size_t live_blocks;
+    size_t reserved_bytes;
+}* Pool;
+
+void pool_init(Pool pool, size_t block_size);
+void* pool_alloc(Pool pool);
+void pool_free(Pool pool, void* block);
+void pool_release(Pool pool);
+size_t pool_live_bytes(Pool pool);
+
+#endif
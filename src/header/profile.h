@@ -0,0 +1,35 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdbool.h>
+
+// scoped timers, compiled out unless PROFILE is defined (see the makefile)
+#ifdef PROFILE
+
+struct ProfileScope {
+    const char* name;
+    long long start_ns;
+};
+
+struct ProfileScope profile_scope_begin(const char* name);
+void profile_scope_end(struct ProfileScope* scope);
+void profile_thread_name(const char* name);
+bool profile_dump(const char* path);
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// name has to outlive the trace, string literals are the usual choice
+#define PROFILE_SCOPE(name) \
+    struct ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__) \
+    __attribute__((cleanup(profile_scope_end))) = profile_scope_begin(name)
+#define PROFILE_THREAD_NAME(name) profile_thread_name(name)
+#define PROFILE_DUMP(path) profile_dump(path)
+
+#else
+
+#define PROFILE_SCOPE(name) (void) 0
+#define PROFILE_THREAD_NAME(name) (void) 0
+#define PROFILE_DUMP(path) (void) 0
+
+#endif
+
+#endif
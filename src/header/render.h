@@ -0,0 +1,70 @@
+#ifndef RENDER_H
+#define RENDER_H
+#include <types.h>
+#include <stdbool.h>
+
+typedef struct RenderTarget* RenderTarget;
+
+// coordinates are in window pixels with the origin at the bottom left
+struct RenderBackend {
+    const char* name;
+    void (*begin_frame)(int width, int height);
+    void (*end_frame)(void);
+    void (*fill_rect)(int x1, int y1, int x2, int y2, color32 color);
+    // optional, emulated with fill_rect when missing
+    void (*draw_box)(int x, int y, int w, int h, color32 fill,
+                     color32 border, int border_width);
+    void (*set_clip)(int x, int y, int w, int h);
+    void (*disable_clip)(void);
+    void (*clear)(color32 color);
+    void (*flush)(void);
+    void (*release)(void);
+    // optional offscreen targets holding premultiplied color; while one is
+    // bound, window position (x, y) lands on its bottom left texel
+    RenderTarget (*create_target)(int width, int height);
+    void (*free_target)(RenderTarget target);
+    void (*begin_target)(RenderTarget target, int x, int y);
+    void (*end_target)(void);
+    void (*draw_target)(RenderTarget target, int x, int y);
+    // optional text support; update_atlas mirrors a changed region of the
+    // alpha8 glyph atlas, draw_glyph blends color by the coverage of the
+    // w x h texels at (u, v), one texel per pixel
+    void (*update_atlas)(const uint8_t* alpha, int width, int height, int x, int y, int w, int h);
+    void (*draw_glyph)(int x, int y, int w, int h, int u, int v, color32 color);
+};
+
+extern const struct RenderBackend render_gl_backend;
+extern const struct RenderBackend render_soft_backend;
+extern const struct RenderBackend render_core_backend;
+
+void render_use_backend(const struct RenderBackend* backend);
+const struct RenderBackend* render_current_backend(void);
+
+void render_begin_frame(int width, int height);
+void render_end_frame(void);
+void render_rect(int x1, int y1, int x2, int y2, color32 color);
+void render_box(int x, int y, int w, int h, color32 fill, color32 border, int border_width);
+void render_set_clip(int x, int y, int w, int h);
+void render_disable_clip(void);
+void render_clear(color32 color);
+void render_flush(void);
+void render_release(void);
+
+bool render_supports_targets(void);
+RenderTarget render_create_target(int width, int height);
+void render_free_target(RenderTarget target);
+void render_begin_target(RenderTarget target, int x, int y);
+void render_end_target(void);
+void render_draw_target(RenderTarget target, int x, int y);
+
+// the atlas stays owned by the caller, row 0 is the bottom and texel (0, 0)
+// must be fully covered
+bool render_supports_text(void);
+void render_set_atlas(const uint8_t* alpha, int width, int height);
+void render_atlas_changed(int x, int y, int w, int h);
+void render_glyph(int x, int y, int w, int h, int u, int v, color32 color);
+
+const color32* render_soft_pixels(int* width, int* height);
+bool render_soft_write_ppm(const char* path);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+typedef struct TaskPool* TaskPool;
+
+// a range of items under some object, whoever runs it may split it further
+typedef struct TaskPoolTask {
+    void (*run)(const struct TaskPoolTask* task, int worker);
+    const void* context;
+    void* item;
+    long begin, end;
+} TaskPoolTask;
+
+#define TASK_POOL_DEQUE 1024 // tasks a worker holds, past that it runs new ones itself
+
+/*
+ * Worker threads with a deque each. A worker pushes and pops its own deque
+ * at the bottom, idle workers steal from the top of another one, which for
+ * tasks that split in halves is the biggest piece left. threads counts the
+ * calling thread, 0 uses one per core.
+ */
+TaskPool task_pool_create(int threads);
+void task_pool_free(TaskPool pool);
+int task_pool_threads(TaskPool pool);
+
+// runs task on the calling thread as worker 0 and returns once everything it spawned is done
+void task_pool_run(TaskPool pool, const TaskPoolTask* task);
+// only from inside a running task, worker is the one that task was given
+void task_pool_spawn(TaskPool pool, int worker, const TaskPoolTask* task);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TEXT_H
+#define TEXT_H
+#include <types.h>
+#include <stdbool.h>
+
+typedef struct TextFont* TextFont;
+
+// one alpha8 texture shared by every font and size
+#define TEXT_ATLAS_SIZE 512
+#define TEXT_GLYPH_BUCKETS 1024
+#define TEXT_SHAPE_BUCKETS 1024
+#define TEXT_SHAPE_CACHE_MAX 4096 // shaped strings kept before the least recently used goes
+
+struct TextStats {
+    unsigned long glyph_hits, glyph_misses;
+    unsigned long shape_hits, shape_misses;
+    unsigned long shelf_evictions, atlas_resets;
+    int glyphs_cached, shapes_cached;
+};
+
+TextFont text_default_font(void);
+
+// size is the line height in pixels, (x, y) the bottom left of the line
+int text_line_height(TextFont font, int size);
+int text_width(TextFont font, int size, const char* text);
+void text_draw(TextFont font, int size, int x, int y, const char* text, color32 color);
+
+void text_stats(struct TextStats* out);
+void text_reset_stats(void);
+void text_release(void);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef TEXT_BUFFER_H
+#define TEXT_BUFFER_H
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct TextBuffer* TextBuffer;
+
+// a mapped file starts out as one piece per chunk, newlines are only counted
+// in the chunks a line lookup walks over
+#define TEXT_BUFFER_CHUNK (1 << 18)
+
+TextBuffer text_buffer_open(const char* path);
+TextBuffer text_buffer_create(const char* text, size_t length);
+void text_buffer_close(TextBuffer buffer);
+bool text_buffer_save(TextBuffer buffer, const char* path);
+
+size_t text_buffer_length(TextBuffer buffer);
+unsigned long text_buffer_version(TextBuffer buffer); // bumped by every edit
+bool text_buffer_insert(TextBuffer buffer, size_t offset, const char* text, size_t length);
+bool text_buffer_delete(TextBuffer buffer, size_t offset, size_t length);
+size_t text_buffer_read(TextBuffer buffer, size_t offset, char* out, size_t length);
+
+// lines are numbered from 0, the last one has no newline
+bool text_buffer_line_start(TextBuffer buffer, size_t line, size_t* offset);
+size_t text_buffer_line_of(TextBuffer buffer, size_t offset);
+// never scans, the part not counted yet is estimated when exact is false
+size_t text_buffer_line_count(TextBuffer buffer, bool* exact);
+size_t text_buffer_count_lines(TextBuffer buffer);
+
+void text_buffer_memory(TextBuffer buffer, size_t* pieces, size_t* added_bytes);
+
+// told about every edit: line was changed, the removed lines after it are
+// gone and the added ones follow it
+typedef struct TextBufferListener {
+    void (*on_edit)(void* user_data, size_t line, size_t removed, size_t added);
+    void* user_data;
+} TextBufferListener;
+
+void text_buffer_set_listener(TextBuffer buffer, TextBufferListener listener);
+
+#endif
@@ -1,9 +1,13 @@
 #ifndef UI_H
 #define UI_H
 #include <types.h>
+#include <text_buffer.h>
+#include <highlight.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 enum UIType {
-    UI_NO_TYPE, UI_CANVAS, UI_RESIZER, UI_BUTTON
+    UI_NO_TYPE, UI_CANVAS, UI_RESIZER, UI_BUTTON, UI_SCROLL_VIEW, UI_TEXT_AREA, UI_TYPE_COUNT
 };
 
 typedef struct UIStyleSheet {
@@ -13,7 +17,23 @@ typedef struct UIStyleSheet {
     int border_strengh;
 }* UIStyleSheet;
 
+// fields of a sheet an element overrides on top of its class
+enum UIStyleField {
+    UI_STYLE_COLOR = 1 << 0,
+    UI_STYLE_BACKGROUND_COLOR = 1 << 1,
+    UI_STYLE_BORDER_COLOR = 1 << 2,
+    UI_STYLE_BORDER_STRENGH = 1 << 3,
+    UI_STYLE_ALL = (1 << 4) - 1
+};
+
 typedef struct UIElement* UIElement;
+typedef struct UIStyleClass* UIStyleClass;
+
+typedef struct UIRect {
+    int x, y, w, h;
+} UIRect;
+
+#define UI_MAX_DAMAGE_RECTS 4
 
 typedef struct UITransform {
     int min_w, min_h, max_w, max_h, off_x, off_y;
@@ -49,22 +69,84 @@ void ui_resizer_set_curser_func(UIElement ui_element, void (*curser_func)
                                 void* user_data);
 UIElement ui_button(int window_w, int window_h,
                     void (*on_click)(void* user_data), void* user_data);
+void ui_button_set_label(UIElement ui_element, const char* label);
+const char* ui_button_get_label(UIElement ui_element);
+
+// rows of a scroll view are pulled from here as they come into view
+typedef struct UIListSource {
+    // fills a row for the item at index, rows are recycled so it must reset what it sets
+    void (*bind_row)(void* user_data, UIElement row, long index);
+    // optional, rows are plain canvases without it
+    UIElement (*create_row)(void* user_data, int window_w, int window_h);
+    void* user_data;
+} UIListSource;
+
+UIElement ui_scroll_view(int window_w, int window_h, int row_height, UIListSource source);
+void ui_scroll_view_set_count(UIElement ui_element, long item_count);
+long ui_scroll_view_get_count(UIElement ui_element);
+void ui_scroll_view_set_offset(UIElement ui_element, double offset);
+double ui_scroll_view_get_offset(UIElement ui_element);
+void ui_scroll_view_refresh(UIElement ui_element);
+
+// shows the lines of a buffer it does not own, from top_line down
+UIElement ui_text_area(int window_w, int window_h, TextBuffer buffer);
+void ui_text_area_set_buffer(UIElement ui_element, TextBuffer buffer);
+void ui_text_area_set_highlighter(UIElement ui_element, Highlighter highlighter);
+TextBuffer ui_text_area_get_buffer(UIElement ui_element);
+void ui_text_area_scroll_to_line(UIElement ui_element, size_t line);
+size_t ui_text_area_get_line(UIElement ui_element);
+void ui_text_area_refresh(UIElement ui_element);
 
 void ui_free(UIElement ui_element);
+void ui_release_all(void);
+void ui_memory_stats(size_t* live, size_t* peak, size_t* reserved);
 
 void ui_draw(UIElement ui_element);
+void ui_draw_region(UIElement ui_element, UIRect region);
 void ui_resize(UIElement ui_element, int window_w, int window_h);
+void ui_relayout(UIElement ui_element);
+// 1 lays out on the calling thread only, 0 splits big trees over one thread per core
+void ui_set_layout_threads(int threads);
+int ui_take_layout_count(void);
+struct UILayoutStore;
+void ui_layout_store_gather(UIElement ui_element, struct UILayoutStore* store);
+void ui_layout_store_apply(struct UILayoutStore* store, int window_w, int window_h);
 void ui_mouse_down(UIElement ui_element, int button, int x, int y);
 void ui_mouse_up(UIElement ui_element, int button, int x, int y);
 void ui_mouse_moved(UIElement ui_element, int x, int y);
+void ui_scroll(UIElement ui_element, double dx, double dy, int x, int y);
+UIElement ui_hit_test(UIElement ui_element, int x, int y);
+void ui_capture_pointer(UIElement ui_element);
+void ui_release_pointer(UIElement ui_element);
+UIElement ui_pointer_capture(void);
 
 void ui_set_i(UIElement ui_element, int param, int val);
 int ui_get_i(UIElement ui_element, int param);
 void ui_set_d(UIElement ui_element, int param, double val);
 double ui_get_d(UIElement ui_element, int param);
 void ui_set_parent(UIElement ui_element, UIElement parent);
+UIElement ui_get_parent(UIElement ui_element);
+void ui_set_transform(UIElement ui_element, UITransform transform);
+UIRect ui_get_rect(UIElement ui_element);
 void ui_parse_style(UIElement ui_element, const char* style);
+void ui_parse_style_batch(UIElement* ui_elements, const char* const* styles, int count);
 
+// pins every field to its current value, later class updates no longer reach the element
 UIStyleSheet ui_access_stylesheet(UIElement ui_element);
+// only the given UIStyleField bits are taken from values, the rest keep following the class
+void ui_override_style(UIElement ui_element, UIStyleSheet values, int fields);
+struct UIStyleSheet ui_get_style(UIElement ui_element);
+UIStyleClass ui_style_class(const char* name);
+void ui_style_class_update(UIStyleClass style_class, UIStyleSheet sheet);
+struct UIStyleSheet ui_style_class_get(UIStyleClass style_class);
+void ui_style_class_remove(UIStyleClass style_class);
+void ui_set_style_class(UIElement ui_element, UIStyleClass style_class);
+UIStyleClass ui_get_style_class(UIElement ui_element);
+
+void ui_set_cached(UIElement ui_element, bool cached);
+void ui_invalidate(UIElement ui_element);
+void ui_damage(int x, int y, int w, int h);
+bool ui_has_damage(void);
+int ui_take_damage(UIRect out[UI_MAX_DAMAGE_RECTS]);
 
 #endif
\ No newline at end of file
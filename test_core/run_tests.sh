@@ -0,0 +1,44 @@
+#!/bin/bash
+# Runs the given test binaries in parallel, one per core (override with JOBS),
+# and prints each test's output together with its wall time once all are done.
+
+jobs=${JOBS:-$(nproc)}
+results=$(mktemp -d)
+trap 'rm -rf "$results"' EXIT
+
+run_one() {
+    local index=$1 target=$2
+    local start=$(date +%s%N)
+    "./$target" > "$results/$index.out" 2>&1
+    local status=$?
+    local end=$(date +%s%N)
+    echo "$status $(( (end - start) / 1000000 ))" > "$results/$index.status"
+}
+
+suite_start=$(date +%s%N)
+index=0
+for target in "$@"; do
+    while (( $(jobs -rp | wc -l) >= jobs )); do
+        wait -n
+    done
+    run_one $index "$target" &
+    index=$((index + 1))
+done
+wait
+suite_end=$(date +%s%N)
+
+failed=0
+index=0
+for target in "$@"; do
+    read status ms < "$results/$index.status"
+    echo "=== $target (${ms} ms)"
+    cat "$results/$index.out"
+    if [ "$status" != 0 ]; then
+        echo -e "\033[91m$target exited with status $status\033[0m"
+        failed=$((failed + 1))
+    fi
+    index=$((index + 1))
+done
+
+echo "$# tests, $failed failed, $(( (suite_end - suite_start) / 1000000 )) ms wall time on $jobs jobs"
+[ $failed = 0 ]
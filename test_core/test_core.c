@@ -28,6 +28,8 @@ void start() {
     unsigned int* memp = mmap(NULL, sizeof(int) * 2, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
     assert_counter = memp;
     pass_counter = memp + 1;
+    // output is redirected to a file by the test runner, don't duplicate buffers
+    fflush(stdout);
     pid_t pid = fork();
     if (pid < 0) {
         fprintf(stderr, "failed to fork\n");
@@ -35,8 +37,9 @@ void start() {
     }
     if (pid == 0) return; // inside new subprocess
     else {
-        _test_wait();
-        exit(0);
+        int crashed = _test_wait();
+        // a failing exit status lets the test runner count failures
+        exit(crashed || *assert_counter > *pass_counter);
     }
 }
 
@@ -68,23 +71,26 @@ void _assert(bool condition, size_t line, const char* file, const char* function
         vprintf(format, l);
         printf("\n");
         va_end(l);
+        free(format);
     }
 }
 
-static unsigned char hex_lookup[16] = "123456789ABCDEF";
+static const char hex_lookup[16] = "0123456789ABCDEF";
 char* _makehexstr(void* data, size_t memb) {
-    if (data) {
+    if (!data) {
         char* out = malloc(sizeof("NULL"));
         strcpy(out, "NULL");
         return out;
     }
     else {
-        char* out_str = malloc(memb * 2);
+        char* out_str = malloc(memb * 2 + 1);
         for (size_t i = 0; i < memb; i++) {
             unsigned char c = ((unsigned char*) data)[i];
-            out_str[i * 2 + 0] = hex_lookup[c && 0xf];
-            out_str[i * 2 + 1] = hex_lookup[c >> 0x4];
+            out_str[i * 2 + 0] = hex_lookup[c >> 0x4];
+            out_str[i * 2 + 1] = hex_lookup[c & 0xf];
         }
+        out_str[memb * 2] = '\0';
         return out_str;
     }
-}
\ No newline at end of file
+}
+
@@ -18,6 +18,7 @@ int _test_wait();
 
 #define launch(code) do { \
     printf("start section %s\n", STR(code)); \
+    fflush(stdout); \
     pid_t pid = fork(); \
     if (pid == 0) {code;} \
     else { \
@@ -0,0 +1,133 @@
+#include <test_core.h>
+#include <highlight.h>
+#include <sched.h>
+
+#define SOURCE_LINES 400
+#define RANDOM_EDITS 600
+#define EDITS_PER_CHECK 7
+#define BIG_LINES 100000
+#define VIEW_FIRST 50000
+#define VIEW_LINES 60
+#define KEYSTROKES 20
+
+static unsigned seed = 1;
+
+static int random_below(int n) {
+    seed = seed * 1103515245 + 12345;
+    return (int) ((seed >> 8) % (unsigned) n);
+}
+
+static TextBuffer make_source(int lines) {
+    static const char* const templates[] = {
+        "static int value_%d = 0x1F + 3.5e2; // a counter\n",
+        "    if (count > %d && flags & 4) return \"done\";\n",
+        "/* a block comment that opens on line %d\n",
+        "   and closes on the next */ struct item items[%d];\n",
+        "#define LIMIT_%d 64\n",
+        "    for (int i = 0; i < %d; i++) total += i * 'a';\n"
+    };
+    char* text = malloc((size_t) lines * 64);
+    size_t length = 0;
+    for (int i = 0; i < lines; i++)
+        length += sprintf(text + length, templates[i % 6], i);
+    TextBuffer buffer = text_buffer_create(text, length);
+    free(text);
+    return buffer;
+}
+
+static void wait_idle(Highlighter highlighter) {
+    for (highlight_update(highlighter); !highlight_idle(highlighter); highlight_update(highlighter))
+        sched_yield();
+}
+
+static void view_all(Highlighter highlighter, TextBuffer buffer) {
+    highlight_set_visible(highlighter, 0, text_buffer_count_lines(buffer));
+    wait_idle(highlighter);
+}
+
+// lines whose spans differ from the ones a new highlighter finds for the same text
+static int stale_lines(Highlighter highlighter, TextBuffer buffer) {
+    size_t length = text_buffer_length(buffer);
+    char* text = malloc(length + 1);
+    text_buffer_read(buffer, 0, text, length);
+    TextBuffer copy = text_buffer_create(text, length);
+    free(text);
+    Highlighter fresh = highlight_create(copy, NULL, NULL);
+    view_all(fresh, copy);
+    view_all(highlighter, buffer);
+    int stale = 0;
+    size_t lines = text_buffer_count_lines(buffer);
+    for (size_t line = 0; line < lines; line++) {
+        const HighlightSpan *spans, *expected;
+        int count = highlight_line(highlighter, line, &spans);
+        int expected_count = highlight_line(fresh, line, &expected);
+        bool same = count == expected_count && count >= 0;
+        for (int i = 0; same && i < count; i++)
+            same = spans[i].start == expected[i].start && spans[i].length == expected[i].length &&
+                   spans[i].kind == expected[i].kind;
+        stale += !same;
+    }
+    highlight_free(fresh);
+    text_buffer_close(copy);
+    return stale;
+}
+
+// edits pile up between checks, some open or close comments over everything below them
+static void random_edits(void) {
+    static const char* const snippets[] = {
+        "/*", "*/", "\n", "x", "// note", "\"", "'a'", "42", "#include <x.h>\n", " */\n/* ", "int ", "\n\n"
+    };
+    TextBuffer buffer = make_source(SOURCE_LINES);
+    Highlighter highlighter = highlight_create(buffer, NULL, NULL);
+    assert_equal(stale_lines(highlighter, buffer), 0);
+    for (int i = 1; i <= RANDOM_EDITS; i++) {
+        size_t length = text_buffer_length(buffer);
+        size_t offset = random_below(length + 1);
+        if (random_below(3)) {
+            const char* snippet = snippets[random_below(sizeof(snippets) / sizeof(*snippets))];
+            text_buffer_insert(buffer, offset, snippet, strlen(snippet));
+        }
+        else {
+            text_buffer_delete(buffer, offset, random_below(40));
+        }
+        // results of the edits before are still on their way back now and then
+        highlight_update(highlighter);
+        if (i % EDITS_PER_CHECK == 0)
+            assert_equal(stale_lines(highlighter, buffer), 0);
+    }
+    highlight_free(highlighter);
+    text_buffer_close(buffer);
+}
+
+// lines tokenized again for each keystroke at the start of a visible line
+static double tokenized_per_keystroke(const char* text) {
+    TextBuffer buffer = make_source(BIG_LINES);
+    Highlighter highlighter = highlight_create(buffer, NULL, NULL);
+    highlight_set_visible(highlighter, VIEW_FIRST, VIEW_LINES);
+    wait_idle(highlighter);
+    struct HighlightStats before, after;
+    highlight_stats(highlighter, &before);
+    for (int i = 0; i < KEYSTROKES; i++) {
+        size_t offset;
+        text_buffer_line_start(buffer, VIEW_FIRST + i % VIEW_LINES, &offset);
+        text_buffer_insert(buffer, offset, text, strlen(text));
+        wait_idle(highlighter);
+    }
+    highlight_stats(highlighter, &after);
+    highlight_free(highlighter);
+    text_buffer_close(buffer);
+    return (double) (after.lines_tokenized - before.lines_tokenized) / KEYSTROKES;
+}
+
+static void keystroke_bound(void) {
+    assert_true(tokenized_per_keystroke("x") <= 2);
+    assert_true(tokenized_per_keystroke("\n") <= 3);
+}
+
+int main() {
+    start();
+    random_edits();
+    keystroke_bound();
+    end();
+    return 0;
+}
@@ -0,0 +1,264 @@
+#include <test_core.h>
+#include <ui.h>
+
+#define WINDOW_W 800
+#define WINDOW_H 600
+#define MAX_NODES 1600
+#define ELEMENTS 1200
+#define SCROLL_VIEWS 3
+#define ROW_HEIGHT 17
+#define POINTS 1500
+
+// the tree as the test built it, hit tests are checked against a walk over this
+struct Node {
+    UIElement element;
+    int parent; // -1 for the root
+    int stamp; // children are drawn in the order they were attached
+    int view; // for rows, the node of their scroll view, -1 otherwise
+};
+
+static struct Node nodes[MAX_NODES];
+static int node_count;
+static int next_stamp;
+static int order[MAX_NODES]; // draw order of the nodes
+static UIRect rects[MAX_NODES]; // as laid out for the hit tests being checked
+static int views[SCROLL_VIEWS];
+static unsigned seed;
+
+static int random_below(int n) {
+    seed = seed * 1103515245 + 12345;
+    return (int) ((seed >> 8) % (unsigned) n);
+}
+
+static double random_unit(void) {
+    return random_below(1 << 16) / 65536.0;
+}
+
+static int add_node(UIElement element, int parent, int view) {
+    nodes[node_count] = (struct Node) {element, parent, next_stamp++, view};
+    if (parent >= 0 && view < 0)
+        ui_set_parent(element, nodes[parent].element);
+    return node_count++;
+}
+
+static bool is_ancestor(int ancestor, int node) {
+    for (; node >= 0; node = nodes[node].parent)
+        if (node == ancestor)
+            return true;
+    return false;
+}
+
+// rows are not created by the test, they are picked up as the views bind them
+static void bind_row(void* user_data, UIElement row, long index) {
+    (void) index;
+    int view = (int) (long) user_data;
+    for (int i = 0; i < node_count; i++)
+        if (nodes[i].element == row)
+            return;
+    add_node(row, view, view);
+}
+
+static void noop(void* user_data) {
+    (void) user_data;
+}
+
+// mostly inside the parent, but parts stick out on purpose, drawing clips those away
+static void place(UIElement element, UIElement parent) {
+    double x = ui_get_d(parent, UI_X), y = ui_get_d(parent, UI_Y);
+    double w = ui_get_d(parent, UI_WIDTH), h = ui_get_d(parent, UI_HEIGHT);
+    ui_set_d(element, UI_X, x + (random_unit() * 1.2 - 0.1) * w);
+    ui_set_d(element, UI_Y, y + (random_unit() * 1.2 - 0.1) * h);
+    ui_set_d(element, UI_WIDTH, random_unit() * 0.7 * w);
+    ui_set_d(element, UI_HEIGHT, random_unit() * 0.7 * h);
+    ui_set_i(element, UI_MIN_WIDTH, random_below(6));
+    ui_set_i(element, UI_MIN_HEIGHT, random_below(6));
+}
+
+static UIElement build(unsigned tree_seed) {
+    seed = tree_seed;
+    node_count = next_stamp = 0;
+    UIElement root = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_set_d(root, UI_WIDTH, 1);
+    ui_set_d(root, UI_HEIGHT, 1);
+    add_node(root, -1, -1);
+    for (int i = 1; i < ELEMENTS; i++) {
+        UIElement element = random_below(3) ? ui_canvas(WINDOW_W, WINDOW_H) :
+                            ui_button(WINDOW_W, WINDOW_H, noop, NULL);
+        // parents are drawn from the first nodes, so the tree gets deep and bushy
+        int parent = random_below(MIN(i, 1 + i / 4));
+        place(element, nodes[parent].element);
+        add_node(element, parent, -1);
+    }
+    // a fixed height keeps the number of rows, so every row stays a child of its view
+    for (int i = 0; i < SCROLL_VIEWS; i++) {
+        int view = views[i] = node_count;
+        UIListSource source = {.bind_row = bind_row, .user_data = (void*) (long) view};
+        UIElement element = ui_scroll_view(WINDOW_W, WINDOW_H, ROW_HEIGHT, source);
+        ui_set_d(element, UI_X, 0.1 + 0.3 * i);
+        ui_set_d(element, UI_Y, 0.2);
+        ui_set_d(element, UI_WIDTH, 0.25);
+        ui_set_i(element, UI_MIN_HEIGHT, 180);
+        ui_set_i(element, UI_MAX_HEIGHT, 180);
+        add_node(element, i == 0 ? 0 : 1 + random_below(ELEMENTS - 1), -1);
+        ui_scroll_view_set_count(element, 500);
+    }
+    ui_relayout(root);
+    return root;
+}
+
+static int compare_stamps(const void* a, const void* b) {
+    return nodes[*(const int*) a].stamp - nodes[*(const int*) b].stamp;
+}
+
+static int sort_children(int node, int at) {
+    order[at++] = node;
+    int children[MAX_NODES], count = 0;
+    for (int i = 0; i < node_count; i++)
+        if (nodes[i].parent == node)
+            children[count++] = i;
+    qsort(children, count, sizeof(int), compare_stamps);
+    for (int i = 0; i < count; i++)
+        at = sort_children(children[i], at);
+    return at;
+}
+
+// visible at the point when neither the element nor any ancestor leaves it out
+static bool visible(int node, int x, int y) {
+    for (; node >= 0; node = nodes[node].parent) {
+        UIRect r = rects[node];
+        if (x < r.x || y < r.y || x > r.x + r.w || y > r.y + r.h)
+            return false;
+    }
+    return true;
+}
+
+static int find_node(UIElement element) {
+    for (int i = 0; i < node_count; i++)
+        if (nodes[i].element == element)
+            return i;
+    return -1;
+}
+
+// points where ui_hit_test disagrees with the topmost visible node, hits counts the ones that hit anything
+static int wrong_hits(UIElement root, int* hits) {
+    ui_relayout(root);
+    sort_children(0, 0);
+    for (int i = 0; i < node_count; i++)
+        rects[i] = ui_get_rect(nodes[i].element);
+    int wrong = 0;
+    *hits = 0;
+    for (int p = 0; p < POINTS; p++) {
+        int x = random_below(WINDOW_W + 40) - 20, y = random_below(WINDOW_H + 40) - 20;
+        int expected = -1;
+        for (int i = node_count - 1; i >= 0 && expected < 0; i--)
+            if (visible(order[i], x, y))
+                expected = order[i];
+        UIElement hit = ui_hit_test(root, x, y);
+        int got = hit ? find_node(hit) : -1;
+        *hits += got >= 0;
+        // rows of a view touch, on the shared edge either one is fine
+        if (got != expected && !(got >= 0 && expected >= 0 && nodes[expected].view >= 0 &&
+                                 nodes[got].view == nodes[expected].view && visible(got, x, y)))
+            wrong++;
+    }
+    return wrong;
+}
+
+static void check(UIElement root) {
+    int hits;
+    assert_equal(wrong_hits(root, &hits), 0);
+    assert_true(hits > POINTS / 2);
+}
+
+static int random_leaf(void) {
+    int node;
+    do
+        node = 1 + random_below(node_count - 1);
+    while (nodes[node].view >= 0 || ui_get_i(nodes[node].element, UI_CHILD_COUNT));
+    return node;
+}
+
+// a few leaves moving between hit tests are moved in their cells, the grid is not rebuilt
+static void moves_in_place(void) {
+    UIElement root = build(1);
+    check(root);
+    for (int round = 0; round < 8; round++) {
+        for (int i = 0; i < 3; i++)
+            ui_set_i(nodes[random_leaf()].element, UI_OFFSET_X, random_below(61) - 30);
+        check(root);
+    }
+    ui_free(root);
+}
+
+// more leaves piling into one spot than a cell has room for, and leaves leaving the bounds
+static void fallbacks(void) {
+    UIElement root = build(2);
+    check(root);
+    for (int i = 0; i < 60; i++) {
+        UIElement leaf = nodes[random_leaf()].element;
+        ui_set_d(leaf, UI_X, 0.5);
+        ui_set_d(leaf, UI_Y, 0.5);
+        ui_set_d(leaf, UI_WIDTH, 0.01);
+        ui_set_d(leaf, UI_HEIGHT, 0.01);
+    }
+    check(root);
+    ui_set_i(nodes[random_leaf()].element, UI_OFFSET_X, 5000);
+    ui_set_i(nodes[random_leaf()].element, UI_OFFSET_Y, -5000);
+    check(root);
+    // most of the tree moving at once takes a rebuild
+    for (int i = 1; i < node_count; i++)
+        if (nodes[i].view < 0)
+            ui_set_i(nodes[i].element, UI_OFFSET_Y, 7);
+    check(root);
+    ui_free(root);
+}
+
+// parents moving take their children, and the clips of the children, with them
+static void parents_and_reparenting(void) {
+    UIElement root = build(3);
+    check(root);
+    for (int round = 0; round < 6; round++) {
+        // the first nodes have the most children
+        int node = 1 + random_below(8);
+        assert_true(ui_get_i(nodes[node].element, UI_CHILD_COUNT) > 0);
+        ui_set_i(nodes[node].element, UI_OFFSET_X, random_below(201) - 100);
+        check(root);
+        int child, parent;
+        do {
+            child = 1 + random_below(ELEMENTS - 1);
+            parent = random_below(ELEMENTS);
+        } while (is_ancestor(child, parent));
+        ui_set_parent(nodes[child].element, nodes[parent].element);
+        nodes[child].parent = parent;
+        nodes[child].stamp = next_stamp++;
+        check(root);
+    }
+    ui_resize(root, WINDOW_W / 2, WINDOW_H);
+    ui_resize(root, WINDOW_W, WINDOW_H);
+    check(root);
+    ui_free(root);
+}
+
+// overscan rows hang out of their view and only the visible part of them is hit
+static void scroll_views(void) {
+    UIElement root = build(4);
+    check(root);
+    double offsets[] = {3, 40, 41, 500, 20, 8000, 0};
+    for (unsigned i = 0; i < sizeof(offsets) / sizeof(*offsets); i++) {
+        for (int v = 0; v < SCROLL_VIEWS; v++)
+            ui_scroll_view_set_offset(nodes[views[v]].element, offsets[i] * (v + 1));
+        check(root);
+    }
+    ui_free(root);
+}
+
+int main() {
+    start();
+    moves_in_place();
+    fallbacks();
+    parents_and_reparenting();
+    scroll_views();
+    ui_release_all();
+    end();
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <test_core.h>
+#include <ui.h>
+#include <stdlib.h>
+
+#define WINDOW_W 1280
+#define WINDOW_H 720
+#define MAX_ELEMENTS 40000 // past UI_PARALLEL_LAYOUT_MIN so the pool splits the tree
+
+struct Tree {
+    UIElement root;
+    UIElement* all;
+    int count;
+};
+
+static double random_unit(unsigned* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return ((*seed >> 8) & 0xffff) / 65536.0;
+}
+
+// the same seed builds the same tree, a resizer follows some of the panels of a level
+static void build(struct Tree* tree, UIElement parent, int depth, unsigned* seed) {
+    int children = 2 + (int) (random_unit(seed) * 12);
+    UIElement first = NULL, last = NULL;
+    for (int i = 0; i < children && tree->count < MAX_ELEMENTS; i++) {
+        UIElement panel = tree->all[tree->count++] = ui_canvas(WINDOW_W, WINDOW_H);
+        ui_set_d(panel, UI_X, random_unit(seed));
+        ui_set_d(panel, UI_Y, random_unit(seed));
+        ui_set_d(panel, UI_WIDTH, random_unit(seed) - 0.25);
+        ui_set_d(panel, UI_HEIGHT, random_unit(seed));
+        ui_set_i(panel, UI_MIN_WIDTH, (int) (random_unit(seed) * 40));
+        ui_set_i(panel, UI_MAX_HEIGHT, 100 + (int) (random_unit(seed) * 400));
+        ui_set_i(panel, UI_OFFSET_X, (int) (random_unit(seed) * 20) - 10);
+        ui_set_parent(panel, parent);
+        if (depth < 6 && random_unit(seed) < 0.6)
+            build(tree, panel, depth + 1, seed);
+        first = first ? first : panel;
+        last = panel;
+    }
+    if (last && tree->count < MAX_ELEMENTS && random_unit(seed) < 0.5) {
+        enum UIDirection direction = random_unit(seed) < 0.5 ? HORIZONTAL : VERTICAL;
+        UIElement item2 = first != last && random_unit(seed) < 0.5 ? first : NULL;
+        UIElement resizer = tree->all[tree->count++] =
+            ui_resizer(WINDOW_W, WINDOW_H, direction, last, item2, random_unit(seed));
+        ui_set_parent(resizer, parent);
+    }
+}
+
+static struct Tree random_tree(unsigned seed) {
+    struct Tree tree = {.all = malloc(sizeof(UIElement) * (MAX_ELEMENTS + 1))};
+    tree.root = tree.all[tree.count++] = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_set_d(tree.root, UI_WIDTH, 1);
+    ui_set_d(tree.root, UI_HEIGHT, 1);
+    while (tree.count < MAX_ELEMENTS / 2)
+        build(&tree, tree.root, 0, &seed);
+    return tree;
+}
+
+static void free_tree(struct Tree* tree) {
+    ui_free(tree->root);
+    free(tree->all);
+}
+
+static int differing_rects(struct Tree* a, struct Tree* b) {
+    int differing = 0;
+    for (int i = 0; i < a->count; i++) {
+        UIRect ra = ui_get_rect(a->all[i]), rb = ui_get_rect(b->all[i]);
+        differing += ra.x != rb.x || ra.y != rb.y || ra.w != rb.w || ra.h != rb.h;
+    }
+    return differing;
+}
+
+// lays out tree with the given number of threads, returns how many elements that took
+static int resize(struct Tree* tree, int threads, int w, int h) {
+    ui_set_layout_threads(threads);
+    ui_take_layout_count();
+    ui_resize(tree->root, w, h);
+    return ui_take_layout_count();
+}
+
+static int edit(struct Tree* tree, int threads, unsigned seed) {
+    ui_set_layout_threads(threads);
+    ui_take_layout_count();
+    for (int i = 0; i < 50; i++) {
+        UIElement e = tree->all[1 + (int) (random_unit(&seed) * (tree->count - 1))];
+        ui_set_i(e, UI_OFFSET_Y, (int) (random_unit(&seed) * 30));
+        ui_set_d(e, UI_WIDTH, random_unit(&seed));
+    }
+    ui_relayout(tree->root);
+    return ui_take_layout_count();
+}
+
+// every element is laid out once per pass, whether or not the pool splits it
+static void serial_against_parallel(unsigned seed) {
+    struct Tree serial = random_tree(seed), parallel = random_tree(seed);
+    assert_equal(serial.count, parallel.count);
+    assert_true(serial.count > 16384);
+    resize(&serial, 1, WINDOW_W, WINDOW_H);
+    resize(&parallel, 4, WINDOW_W, WINDOW_H);
+    assert_equal(differing_rects(&serial, &parallel), 0);
+    int sizes[][2] = {{640, 360}, {1920, 1080}, {333, 977}, {WINDOW_W, WINDOW_H}};
+    for (int i = 0; i < 4; i++) {
+        assert_equal(resize(&serial, 1, sizes[i][0], sizes[i][1]), serial.count);
+        assert_equal(resize(&parallel, 4, sizes[i][0], sizes[i][1]), parallel.count);
+        assert_equal(differing_rects(&serial, &parallel), 0);
+    }
+    int serial_edited = edit(&serial, 1, seed);
+    int parallel_edited = edit(&parallel, 4, seed);
+    assert_true(serial_edited < serial.count);
+    assert_equal(serial_edited, parallel_edited);
+    assert_equal(differing_rects(&serial, &parallel), 0);
+    free_tree(&serial);
+    free_tree(&parallel);
+}
+
+int main() {
+    start();
+    serial_against_parallel(1);
+    serial_against_parallel(2024);
+    serial_against_parallel(77777);
+    ui_set_layout_threads(1);
+    ui_release_all();
+    end();
+    return 0;
+}
@@ -0,0 +1,20 @@
+#include <test_core.h>
+
+static void hex_equals(void* data, size_t memb, const char* expected) {
+    char* hex = _makehexstr(data, memb);
+    assert_str_equal(hex, expected);
+    free(hex);
+}
+
+int main() {
+    start();
+    hex_equals(NULL, 4, "NULL");
+    hex_equals("", 0, "");
+    // every nibble value once, the high one comes first
+    unsigned char bytes[] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+    hex_equals(bytes, sizeof(bytes), "0123456789ABCDEF");
+    unsigned char edges[] = {0x00, 0x0f, 0xf0, 0xff};
+    hex_equals(edges, sizeof(edges), "000FF0FF");
+    end();
+    return 0;
+}
@@ -0,0 +1,137 @@
+#define GL_GLEXT_PROTOTYPES
+#include <test_core.h>
+#include <render.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+/*
+ * The core profile and the legacy GL renderers against the software one on
+ * the same scene, drawn into a framebuffer object of an offscreen EGL
+ * context, on Mesa llvmpipe for example. GL blends in fixed point with its
+ * own rounding, so every channel may differ by one. Machines without a
+ * usable EGL driver skip the comparison.
+ */
+
+#define SCENE_W 96
+#define SCENE_H 64
+#define TOLERANCE 1
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLConfig config;
+
+static bool open_display(void) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!get_display)
+        return false;
+    display = get_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API))
+        return false;
+    EGLint attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLint configs = 0;
+    return eglChooseConfig(display, attributes, &config, 1, &configs) && configs > 0;
+}
+
+static bool make_context(int major, int minor, EGLint profile) {
+    EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, profile,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, attributes);
+    return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+static void scene(void) {
+    static uint8_t atlas[8 * 4];
+    for (int i = 0; i < 8 * 4; i++)
+        atlas[i] = i * 37 % 256;
+    atlas[0] = 0xff;
+    render_set_atlas(atlas, 8, 4);
+    render_begin_frame(SCENE_W, SCENE_H);
+    render_clear(color32(0x20, 0x20, 0x20, 0xff));
+    render_rect(4, 4, 60, 40, color32(0xff, 0x40, 0x00, 0xff));
+    render_rect(30, 20, 90, 60, color32(0x00, 0x80, 0xff, 0x80));
+    render_rect(50, 2, 70, 62, color32(0x10, 0xff, 0x10, 0x21));
+    render_box(8, 44, 40, 16, color32(0x20, 0x20, 0x20, 0x80), color32(0xff, 0xff, 0xff, 0xc0), 2);
+    render_set_clip(10, 10, 20, 20);
+    render_box(0, 0, SCENE_W, SCENE_H, color32(0x80, 0, 0x80, 0x7f), color32(0, 0, 0, 0xff), 3);
+    render_disable_clip();
+    render_glyph(70, 10, 8, 4, 0, 0, color32(0xff, 0xe0, 0x10, 0xc0));
+    render_glyph(80, 30, 8, 4, 0, 0, color32(0x00, 0x00, 0x00, 0xff));
+    render_end_frame();
+}
+
+// rows come back bottom first, like the software frame
+static color32* draw_with(const struct RenderBackend* backend) {
+    GLuint framebuffer, color;
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCENE_W, SCENE_H);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    assert_true(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    render_use_backend(backend);
+    scene();
+    render_flush();
+    color32* pixels = malloc(sizeof(color32) * SCENE_W * SCENE_H);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, SCENE_W, SCENE_H, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    assert_equal(glGetError(), (GLenum) GL_NO_ERROR);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &color);
+    return pixels;
+}
+
+static void compare(const char* name, const color32* pixels) {
+    render_use_backend(&render_soft_backend);
+    scene();
+    int width, height;
+    const color32* soft = render_soft_pixels(&width, &height);
+    assert_equal(width, SCENE_W);
+    assert_equal(height, SCENE_H);
+    int max = 0;
+    for (int i = 0; i < SCENE_W * SCENE_H; i++)
+        for (int c = 0; c < 4; c++)
+            max = MAX(max, abs(pixels[i].rgba[c] - soft[i].rgba[c]));
+    printf("%s: largest channel difference %d\n", name, max);
+    assert_true(max <= TOLERANCE);
+}
+
+int main() {
+    start();
+    if (!open_display() || !make_context(3, 3, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT)) {
+        printf("no offscreen GL 3.3 core context, skipping the comparison\n");
+        end();
+        return 0;
+    }
+    printf("comparing on %s\n", glGetString(GL_RENDERER));
+    color32* core = draw_with(&render_core_backend);
+    compare("core", core);
+    free(core);
+    render_release();
+
+    // the legacy backend relies on the projection and blending the app sets up
+    if (!make_context(2, 1, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT)) {
+        printf("no offscreen GL compatibility context, skipping the legacy comparison\n");
+        end();
+        return 0;
+    }
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, SCENE_W, 0, SCENE_H, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glViewport(0, 0, SCENE_W, SCENE_H);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_BLEND);
+    color32* legacy = draw_with(&render_gl_backend);
+    compare("legacy", legacy);
+    free(legacy);
+    render_release();
+    end();
+    return 0;
+}
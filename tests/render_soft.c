@@ -0,0 +1,188 @@
+#include <test_core.h>
+#include <render.h>
+
+/*
+ * The software backend against a per-pixel model of the GL blend functions
+ * that rounds exactly. Wide spans go through the SSE2 loops where those are
+ * compiled in, spans of a single pixel always take the scalar div255 path,
+ * so both have to match the model on every value.
+ */
+
+#define SCENE_W 16
+#define SCENE_H 8
+#define SIDE 256
+
+static color32 model[SIDE * SIDE];
+
+static unsigned exact_div255(unsigned v) {
+    return (v * 2 + 255) / 510;
+}
+
+static color32 model_blend(color32 dst, color32 src, unsigned a) {
+    for (int c = 0; c < 4; c++)
+        dst.rgba[c] = exact_div255(src.rgba[c] * a + dst.rgba[c] * (255 - a));
+    return dst;
+}
+
+static color32 model_composite(color32 dst, color32 src) {
+    for (int c = 0; c < 4; c++)
+        dst.rgba[c] = MIN(src.rgba[c] + exact_div255(dst.rgba[c] * (255 - src.a)), 255u);
+    return dst;
+}
+
+static void model_rect(int w, int x0, int y0, int x1, int y1, color32 color) {
+    for (int y = y0; y < y1; y++)
+        for (int x = x0; x < x1; x++)
+            model[y * w + x] = color.a == 0xff ? color : model_blend(model[y * w + x], color, color.a);
+}
+
+static int differing_pixels(int w, int h) {
+    int width, height;
+    const color32* pixels = render_soft_pixels(&width, &height);
+    if (width != w || height != h)
+        return -1;
+    int bad = 0;
+    for (int i = 0; i < w * h; i++)
+        bad += pixels[i].i != model[i].i;
+    return bad;
+}
+
+static color32 pixel(int x, int y) {
+    int width;
+    return render_soft_pixels(&width, NULL)[y * width + x];
+}
+
+static void div255_rounds(void) {
+    // the scalar helper is static, a one pixel blend of every product shows it
+    render_begin_frame(1, 1);
+    int bad = 0;
+    for (unsigned a = 1; a < 255; a++)
+        for (unsigned d = 0; d < 256; d += 15) {
+            render_rect(0, 0, 1, 1, color32(d, d, d, 0xff));
+            render_rect(0, 0, 1, 1, color32(0, 0xff, 0x80, a));
+            color32 want = model_blend(color32(d, d, d, 0xff), color32(0, 0xff, 0x80, a), a);
+            bad += pixel(0, 0).i != want.i;
+        }
+    assert_equal(bad, 0);
+}
+
+// clears, opaque and translucent rects and a clip, with a few values worked out by hand
+static void fixed_scene(void) {
+    color32 background = color32(0x10, 0x20, 0x30, 0xff);
+    color32 red = color32(0xff, 0, 0, 0xff);
+    color32 half_blue = color32(0, 0, 0xff, 0x80);
+    color32 green = color32(0, 0xff, 0, 0x40);
+    render_begin_frame(SCENE_W, SCENE_H);
+    render_clear(background);
+    render_rect(2, 1, 9, 5, red);
+    render_rect(12, 7, 5, 3, half_blue);
+    render_set_clip(0, 0, 4, 4);
+    render_rect(0, 0, SCENE_W, SCENE_H, green);
+    render_disable_clip();
+    render_rect(-3, -3, 1, 1, red);
+    render_rect(7, 0, 7, SCENE_H, red);
+
+    model_rect(SCENE_W, 0, 0, SCENE_W, SCENE_H, background);
+    model_rect(SCENE_W, 2, 1, 9, 5, red);
+    model_rect(SCENE_W, 5, 3, 12, 7, half_blue);
+    model_rect(SCENE_W, 0, 0, 4, 4, green);
+    model_rect(SCENE_W, 0, 0, 1, 1, red);
+    assert_equal(differing_pixels(SCENE_W, SCENE_H), 0);
+
+    assert_equal(pixel(0, 0).i, red.i);
+    assert_equal(pixel(15, 7).i, background.i);
+    // half blue over red: 255 * 127 / 255, 255 * 128 / 255 and the alpha blended like the rest
+    assert_equal(pixel(6, 4).i, color32(0x7f, 0, 0x80, 0xbf).i);
+    // quarter green over the background, then nothing over (4, 4)
+    assert_equal(pixel(1, 3).i, color32(0x0c, 0x58, 0x24, 0xcf).i);
+    assert_equal(pixel(4, 4).i, red.i);
+}
+
+// every alpha over every destination value, in wide spans and in single pixels
+static void blend_spans(void) {
+    render_begin_frame(SIDE, SIDE);
+    int wide = 0, single = 0;
+    for (unsigned a = 1; a < 255; a++) {
+        for (int x = 0; x < SIDE; x++) {
+            color32 dst = color32(x, 255 - x, x * 7, 0xff);
+            render_rect(x, 0, x + 1, SIDE, dst);
+            model_rect(SIDE, x, 0, x + 1, SIDE, dst);
+        }
+        // odd widths leave a scalar tail behind the vector loop
+        for (int y = 0; y < SIDE; y++) {
+            color32 src = color32(y, y * 3, 255 - y, a);
+            render_rect(y % 4, y, SIDE - 1, y + 1, src);
+            model_rect(SIDE, y % 4, y, SIDE - 1, y + 1, src);
+        }
+        wide += differing_pixels(SIDE, SIDE);
+    }
+    render_begin_frame(SIDE, 1);
+    for (unsigned a = 1; a < 255; a++)
+        for (int x = 0; x < SIDE; x++) {
+            color32 dst = color32(x, 255 - x, x * 7, 0xff);
+            color32 src = color32(a, a * 3, 255 - a, a);
+            render_rect(x, 0, x + 1, 1, dst);
+            render_rect(x, 0, x + 1, 1, src);
+            single += pixel(x, 0).i != model_blend(dst, src, a).i;
+        }
+    assert_equal(wide, 0);
+    assert_equal(single, 0);
+}
+
+// premultiplied targets composited over the frame, wide and narrow enough for the scalar path only
+static void composite_spans(void) {
+    int widths[] = {SIDE, 3};
+    for (int w = 0; w < 2; w++) {
+        int width = widths[w];
+        RenderTarget target = render_create_target(width, SIDE);
+        render_begin_frame(SIDE, SIDE);
+        render_begin_target(target, 0, 0);
+        color32 layer[SIDE];
+        for (int x = 0; x < width; x++) {
+            // a translucent rect on a cleared target keeps its alpha and premultiplies its color
+            color32 color = color32(x * 5, 255 - x, x, x);
+            render_rect(x, 0, x + 1, SIDE, color);
+            layer[x] = model_blend(color32(0, 0, 0, 0), color32(x * 5, 255 - x, x, 0xff), x);
+        }
+        render_end_target();
+        for (int y = 0; y < SIDE; y++) {
+            color32 dst = color32(y, 255 - y, y * 11, 0xff);
+            render_rect(0, y, SIDE, y + 1, dst);
+            model_rect(SIDE, 0, y, SIDE, y + 1, dst);
+            for (int x = 0; x < width; x++)
+                model[y * SIDE + x] = model_composite(model[y * SIDE + x], layer[x]);
+        }
+        render_draw_target(target, 0, 0);
+        assert_equal(differing_pixels(SIDE, SIDE), 0);
+        render_free_target(target);
+    }
+}
+
+// glyph coverage scales the color's alpha before the same blend, alpha included
+static void glyph_coverage(void) {
+    uint8_t atlas[4 * 2] = {0xff, 0, 0x40, 0x80, 0x01, 0xfe, 0xff, 0xc0};
+    render_set_atlas(atlas, 4, 2);
+    render_begin_frame(4, 2);
+    render_clear(color32(0, 0, 0, 0xff));
+    color32 text = color32(0xff, 0xe0, 0x10, 0xc0);
+    render_glyph(0, 0, 4, 2, 0, 0, text);
+    for (int i = 0; i < 8; i++) {
+        unsigned a = exact_div255(atlas[i] * text.a);
+        color32 covered = color32(text.r, text.g, text.b, a);
+        model[i] = a ? model_blend(color32(0, 0, 0, 0xff), covered, a) : color32(0, 0, 0, 0xff);
+    }
+    assert_equal(differing_pixels(4, 2), 0);
+}
+
+int main() {
+    start();
+    render_use_backend(&render_soft_backend);
+    div255_rounds();
+    fixed_scene();
+    blend_spans();
+    composite_spans();
+    glyph_coverage();
+    render_release();
+    end();
+    return 0;
+}
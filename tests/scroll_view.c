@@ -0,0 +1,158 @@
+#include <test_core.h>
+#include <ui.h>
+
+#define WINDOW_W 640
+#define WINDOW_H 480
+#define ROW_HEIGHT 20
+#define MAX_ROWS 256
+
+// every row the view ever asked for, with the item it was bound to last
+static UIElement rows[MAX_ROWS];
+static long bound[MAX_ROWS];
+static int row_count = 0;
+static long binds = 0;
+
+static UIElement create_row(void* user_data, int window_w, int window_h) {
+    (void) user_data;
+    UIElement row = ui_canvas(window_w, window_h);
+    if (row_count < MAX_ROWS) {
+        rows[row_count] = row;
+        bound[row_count++] = -1;
+    }
+    return row;
+}
+
+static void bind_row(void* user_data, UIElement row, long index) {
+    (void) user_data;
+    binds++;
+    for (int i = 0; i < row_count; i++)
+        if (rows[i] == row)
+            bound[i] = index;
+}
+
+/*
+ * Rows that are children of the view show the item they were bound to: the
+ * top of the row is index rows down from the top edge, less the offset.
+ * Together they cover every item that is at least partly in view.
+ */
+static bool rows_match(UIElement view) {
+    UIElement root = view;
+    while (ui_get_parent(root))
+        root = ui_get_parent(root);
+    ui_relayout(root);
+    UIRect rect = ui_get_rect(view);
+    long count = ui_scroll_view_get_count(view);
+    long offset = (long) ui_scroll_view_get_offset(view);
+    long first_visible = offset / ROW_HEIGHT;
+    long last_visible = MIN((offset + rect.h - 1) / ROW_HEIGHT, count - 1);
+    int active = 0;
+    long covered = 0;
+    for (int i = 0; i < row_count; i++) {
+        if (ui_get_parent(rows[i]) != view)
+            continue;
+        active++;
+        UIRect r = ui_get_rect(rows[i]);
+        long top = rect.y + rect.h - (bound[i] * ROW_HEIGHT - offset);
+        if (bound[i] < 0 || bound[i] >= count || r.y + r.h != top || r.h != ROW_HEIGHT)
+            return false;
+        covered += bound[i] >= first_visible && bound[i] <= last_visible;
+    }
+    // bindings are distinct, so covering the visible range means one row for each of its items
+    return active == ui_get_i(view, UI_CHILD_COUNT) &&
+           covered == MAX(last_visible - first_visible + 1, 0L);
+}
+
+static UIElement make_view(UIElement* root, long count) {
+    *root = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_set_d(*root, UI_WIDTH, 1);
+    ui_set_d(*root, UI_HEIGHT, 1);
+    UIListSource source = {.bind_row = bind_row, .create_row = create_row};
+    UIElement view = ui_scroll_view(WINDOW_W, WINDOW_H, ROW_HEIGHT, source);
+    ui_set_d(view, UI_X, 0.1);
+    ui_set_d(view, UI_Y, 0.1);
+    ui_set_d(view, UI_WIDTH, 0.5);
+    ui_set_d(view, UI_HEIGHT, 0.6);
+    ui_set_parent(view, *root);
+    ui_relayout(*root);
+    ui_scroll_view_set_count(view, count);
+    return view;
+}
+
+// scrolling less than the window of rows only binds the rows that came into view
+static void small_scrolls(void) {
+    UIElement root;
+    UIElement view = make_view(&root, 1000);
+    assert_true(rows_match(view));
+    int steps[] = {7, 13, 20, 45, 1, 99, 3};
+    double offset = 0;
+    for (int i = 0; i < 40; i++) {
+        offset += steps[i % 7];
+        binds = 0;
+        ui_scroll_view_set_offset(view, offset);
+        assert_true(rows_match(view));
+        assert_true(binds <= steps[i % 7] / ROW_HEIGHT + 1);
+    }
+    for (int i = 0; i < 40; i++) {
+        offset -= steps[i % 7];
+        ui_scroll_view_set_offset(view, offset);
+        assert_true(rows_match(view));
+    }
+    ui_free(root);
+}
+
+// jumps past the window of rows bind every row again
+static void jumps(void) {
+    UIElement root;
+    UIElement view = make_view(&root, 100000);
+    double offsets[] = {5000, 12345, 0, 1e9, 777, 1999990, 40, 0};
+    for (unsigned i = 0; i < sizeof(offsets) / sizeof(*offsets); i++) {
+        ui_scroll_view_set_offset(view, offsets[i]);
+        assert_true(rows_match(view));
+    }
+    ui_free(root);
+}
+
+// rows are recycled when the count drops below the window and taken back when it grows
+static void counts(void) {
+    UIElement root;
+    UIElement view = make_view(&root, 500);
+    ui_scroll_view_set_offset(view, 9000);
+    assert_true(rows_match(view));
+    long sizes[] = {480, 30, 10, 3, 0, 1, 12, 2000, 499};
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+        ui_scroll_view_set_count(view, sizes[i]);
+        assert_true(rows_match(view));
+        ui_scroll_view_set_offset(view, ui_scroll_view_get_offset(view) + 35);
+        assert_true(rows_match(view));
+    }
+    ui_free(root);
+}
+
+// a taller view needs more rows, a shorter one gives some back
+static void resizes(void) {
+    UIElement root;
+    UIElement view = make_view(&root, 1000);
+    ui_scroll_view_set_offset(view, 4321);
+    int sizes[][2] = {{WINDOW_W, WINDOW_H * 2}, {WINDOW_W, WINDOW_H / 3}, {300, 40}, {WINDOW_W, WINDOW_H}};
+    for (int i = 0; i < 4; i++) {
+        ui_resize(root, sizes[i][0], sizes[i][1]);
+        assert_true(rows_match(view));
+        ui_scroll_view_set_offset(view, ui_scroll_view_get_offset(view) - 57);
+        assert_true(rows_match(view));
+    }
+    ui_free(root);
+}
+
+int main() {
+    start();
+    small_scrolls();
+    row_count = 0;
+    jumps();
+    row_count = 0;
+    counts();
+    row_count = 0;
+    resizes();
+    ui_release_all();
+    end();
+    return 0;
+}
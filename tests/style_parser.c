@@ -0,0 +1,110 @@
+#include <test_core.h>
+#include <ui.h>
+
+#define WINDOW_W 640
+#define WINDOW_H 480
+
+static void color_equals(color32 color, unsigned r, unsigned g, unsigned b, unsigned a) {
+    assert_equal((unsigned) color.r, r);
+    assert_equal((unsigned) color.g, g);
+    assert_equal((unsigned) color.b, b);
+    assert_equal((unsigned) color.a, a);
+}
+
+static void transform_keys(void) {
+    UIElement e = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_parse_style(e, "x = 0.25; y=0.5;w = 1e-1 ;h = 2; min_w = 10; max_w = 300; "
+                      "min_h = -4; max_h = +7; off_x = 3; off_y = -2");
+    assert_equal(ui_get_d(e, UI_X), 0.25);
+    assert_equal(ui_get_d(e, UI_Y), 0.5);
+    assert_equal(ui_get_d(e, UI_WIDTH), 0.1);
+    assert_equal(ui_get_d(e, UI_HEIGHT), 2.0);
+    assert_equal(ui_get_i(e, UI_MIN_WIDTH), 10);
+    assert_equal(ui_get_i(e, UI_MAX_WIDTH), 300);
+    assert_equal(ui_get_i(e, UI_MIN_HEIGHT), -4);
+    assert_equal(ui_get_i(e, UI_MAX_HEIGHT), 7);
+    assert_equal(ui_get_i(e, UI_OFFSET_X), 3);
+    assert_equal(ui_get_i(e, UI_OFFSET_Y), -2);
+    ui_free(e);
+}
+
+static void colors(void) {
+    UIElement e = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_parse_style(e, "color = #11223344; background_color = A0B0C0; border_color = #ff8000; "
+                      "border_strength = 5");
+    struct UIStyleSheet style = ui_get_style(e);
+    color_equals(style.color, 0x11, 0x22, 0x33, 0x44);
+    color_equals(style.background_color, 0xa0, 0xb0, 0xc0, 0xff);
+    color_equals(style.border_color, 0xff, 0x80, 0x00, 0xff);
+    assert_equal(style.border_strengh, 5);
+    ui_parse_style(e, "border_strengh = 1");
+    assert_equal(ui_get_style(e).border_strengh, 1);
+    ui_free(e);
+}
+
+// broken declarations are skipped, the ones around them still apply
+static void invalid_input(void) {
+    UIElement e = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_parse_style(e, "x = 0.5; y = 0.75");
+    ui_parse_style(e, "");
+    ui_parse_style(e, ";;  ;");
+    ui_parse_style(e, "x = abc; colour = #000000; w 0.5; min_w = 99999999999; off_x = 1.5; "
+                      "color = #12345; border_color = #gg0000; y = 0.125");
+    assert_equal(ui_get_d(e, UI_X), 0.5);
+    assert_equal(ui_get_d(e, UI_Y), 0.125);
+    assert_equal(ui_get_d(e, UI_WIDTH), 0.0);
+    assert_equal(ui_get_i(e, UI_MIN_WIDTH), 0);
+    assert_equal(ui_get_i(e, UI_OFFSET_X), 0);
+    struct UIStyleSheet style = ui_get_style(e);
+    struct UIStyleSheet fallback = ui_style_class_get(ui_get_style_class(e));
+    assert_equal(style.color.i, fallback.color.i);
+    assert_equal(style.border_color.i, fallback.border_color.i);
+    ui_free(e);
+}
+
+// a shared style string is parsed once and applied to every element in the run
+static void batch(void) {
+    UIElement elements[4];
+    for (int i = 0; i < 4; i++)
+        elements[i] = ui_canvas(WINDOW_W, WINDOW_H);
+    const char* shared = "x = 0.5; color = #010203";
+    const char* styles[] = {shared, shared, "x = 0.25", shared};
+    ui_parse_style_batch(elements, styles, 4);
+    assert_equal(ui_get_d(elements[0], UI_X), 0.5);
+    assert_equal(ui_get_d(elements[1], UI_X), 0.5);
+    assert_equal(ui_get_d(elements[2], UI_X), 0.25);
+    assert_equal(ui_get_d(elements[3], UI_X), 0.5);
+    color_equals(ui_get_style(elements[3]).color, 0x01, 0x02, 0x03, 0xff);
+    for (int i = 0; i < 4; i++)
+        ui_free(elements[i]);
+}
+
+// fields set by a style follow the element, the rest keep following its class
+static void class_overrides(void) {
+    UIStyleClass panel = ui_style_class("panel");
+    UIElement e = ui_canvas(WINDOW_W, WINDOW_H);
+    ui_set_style_class(e, panel);
+    ui_parse_style(e, "color = #ff0000");
+    struct UIStyleSheet sheet = ui_style_class_get(panel);
+    sheet.border_strengh = 7;
+    sheet.color = color32(0, 0, 0xff, 0xff);
+    ui_style_class_update(panel, &sheet);
+    struct UIStyleSheet style = ui_get_style(e);
+    assert_equal(style.border_strengh, 7);
+    color_equals(style.color, 0xff, 0, 0, 0xff);
+    assert_true(ui_get_style_class(e) == panel);
+    ui_free(e);
+    ui_style_class_remove(panel);
+}
+
+int main() {
+    start();
+    transform_keys();
+    colors();
+    invalid_input();
+    batch();
+    class_overrides();
+    ui_release_all();
+    end();
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <test_core.h>
+#include <text_buffer.h>
+
+#define RANDOM_EDITS 2000
+#define MAPPED_LINE_STRIDE 4999
+
+// the buffer against a plain string holding the same text
+struct Model {
+    char* text;
+    size_t length;
+};
+
+static void model_insert(struct Model* m, size_t offset, const char* text, size_t length) {
+    m->text = realloc(m->text, m->length + length + 1);
+    memmove(m->text + offset + length, m->text + offset, m->length - offset);
+    memcpy(m->text + offset, text, length);
+    m->length += length;
+}
+
+static void model_delete(struct Model* m, size_t offset, size_t length) {
+    memmove(m->text + offset, m->text + offset + length, m->length - offset - length);
+    m->length -= length;
+}
+
+static bool same_text(TextBuffer buffer, struct Model* m) {
+    char* read = malloc(m->length + 1);
+    bool same = text_buffer_length(buffer) == m->length &&
+                text_buffer_read(buffer, 0, read, m->length) == m->length &&
+                memcmp(read, m->text, m->length) == 0;
+    free(read);
+    return same;
+}
+
+/*
+ * The start of every stride-th line and of the last one, and the line of
+ * their first and last offset, worked out from the model. Lookups scan
+ * inside a piece, so big files are only sampled.
+ */
+static bool sampled_lines(TextBuffer buffer, struct Model* m, size_t stride) {
+    size_t line = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= m->length; i++) {
+        if (i == m->length || m->text[i] == '\n') {
+            size_t offset;
+            if ((line % stride == 0 || i == m->length) &&
+                (!text_buffer_line_start(buffer, line, &offset) || offset != start ||
+                 text_buffer_line_of(buffer, start) != line || text_buffer_line_of(buffer, i) != line))
+                return false;
+            line++;
+            start = i + 1;
+        }
+    }
+    size_t past;
+    return text_buffer_count_lines(buffer) == line && !text_buffer_line_start(buffer, line, &past);
+}
+
+static bool same_lines(TextBuffer buffer, struct Model* m) {
+    return sampled_lines(buffer, m, 1);
+}
+
+static void small_edits(void) {
+    TextBuffer buffer = text_buffer_create("one\ntwo\nthree", 13);
+    struct Model m = {NULL, 0};
+    model_insert(&m, 0, "one\ntwo\nthree", 13);
+    assert_equal(text_buffer_count_lines(buffer), 3ul);
+    assert_true(text_buffer_insert(buffer, 4, "new\n", 4));
+    model_insert(&m, 4, "new\n", 4);
+    assert_true(same_text(buffer, &m));
+    assert_true(same_lines(buffer, &m));
+    // across the join of the original text and the added piece
+    assert_true(text_buffer_delete(buffer, 2, 5));
+    model_delete(&m, 2, 5);
+    assert_true(same_text(buffer, &m));
+    assert_true(same_lines(buffer, &m));
+    assert_true(text_buffer_insert(buffer, text_buffer_length(buffer), "\n", 1));
+    model_insert(&m, m.length, "\n", 1);
+    assert_true(same_lines(buffer, &m));
+    assert_true(!text_buffer_insert(buffer, m.length + 1, "x", 1));
+    assert_true(!text_buffer_delete(buffer, m.length + 1, 1));
+    // a delete running past the end stops there
+    assert_true(text_buffer_delete(buffer, m.length - 2, 10));
+    model_delete(&m, m.length - 2, 2);
+    assert_true(same_text(buffer, &m));
+    assert_true(same_lines(buffer, &m));
+    free(m.text);
+    text_buffer_close(buffer);
+}
+
+static void typing(void) {
+    TextBuffer buffer = text_buffer_create("", 0);
+    struct Model m = {NULL, 0};
+    const char* typed = "int main() {\n    return 0;\n}\n";
+    for (size_t i = 0; typed[i]; i++) {
+        assert_true(text_buffer_insert(buffer, i, typed + i, 1));
+        model_insert(&m, i, typed + i, 1);
+    }
+    assert_true(same_text(buffer, &m));
+    assert_true(same_lines(buffer, &m));
+    // consecutive keys grow one piece
+    size_t pieces, added;
+    text_buffer_memory(buffer, &pieces, &added);
+    assert_equal(pieces, 1ul);
+    assert_equal(added, m.length);
+    free(m.text);
+    text_buffer_close(buffer);
+}
+
+static void random_edits(void) {
+    TextBuffer buffer = text_buffer_create("", 0);
+    struct Model m = {NULL, 0};
+    const char* words[] = {"a", "bc\n", "\n", "def", "\n\n", "ghij\nk"};
+    srand(RANDOM_EDITS);
+    bool same = true;
+    for (int i = 0; i < RANDOM_EDITS && same; i++) {
+        size_t offset = rand() % (m.length + 1);
+        if (m.length && rand() % 3 == 0) {
+            size_t length = rand() % (m.length - offset + 1);
+            same = text_buffer_delete(buffer, offset, length);
+            model_delete(&m, offset, length);
+        }
+        else {
+            const char* word = words[rand() % 6];
+            same = text_buffer_insert(buffer, offset, word, strlen(word));
+            model_insert(&m, offset, word, strlen(word));
+        }
+        same = same && same_text(buffer, &m) && (i % 50 || same_lines(buffer, &m));
+    }
+    assert_true(same);
+    assert_true(same_lines(buffer, &m));
+    free(m.text);
+    text_buffer_close(buffer);
+}
+
+// a mapped file counts the lines of a chunk only once a lookup walks over it
+static void mapped_file(void) {
+    char path[] = "/tmp/text_buffer_testXXXXXX";
+    int fd = mkstemp(path);
+    struct Model m = {NULL, 0};
+    char line[32];
+    for (int i = 0; m.length < 3 * TEXT_BUFFER_CHUNK; i++) {
+        int length = snprintf(line, sizeof(line), "line %d\n", i);
+        model_insert(&m, m.length, line, length);
+    }
+    assert_equal(write(fd, m.text, m.length), (ssize_t) m.length);
+    close(fd);
+    TextBuffer buffer = text_buffer_open(path);
+    assert_true(buffer != NULL);
+    bool exact = true;
+    text_buffer_line_count(buffer, &exact);
+    assert_true(!exact);
+    assert_true(same_text(buffer, &m));
+    size_t middle = TEXT_BUFFER_CHUNK + TEXT_BUFFER_CHUNK / 2;
+    assert_true(text_buffer_insert(buffer, middle, "x\ny", 3));
+    model_insert(&m, middle, "x\ny", 3);
+    assert_true(text_buffer_delete(buffer, TEXT_BUFFER_CHUNK - 5, 10));
+    model_delete(&m, TEXT_BUFFER_CHUNK - 5, 10);
+    assert_true(same_text(buffer, &m));
+    assert_true(sampled_lines(buffer, &m, MAPPED_LINE_STRIDE));
+    text_buffer_line_count(buffer, &exact);
+    assert_true(exact);
+    text_buffer_close(buffer);
+    unlink(path);
+    free(m.text);
+}
+
+int main() {
+    start();
+    small_edits();
+    typing();
+    random_edits();
+    mapped_file();
+    end();
+    return 0;
+}